@@ -491,6 +491,12 @@ namespace Evernus
 
     void AssetModel::fillAssets(const std::shared_ptr<AssetList> &assets)
     {
+        EveDataProvider::LocationList locationIds;
+        for (const auto &item : *assets)
+            locationIds.emplace(item->getLocationId().value_or(LocationId{}));
+
+        mDataProvider.precacheLocations(locationIds);
+
         for (const auto &item : *assets)
         {
             auto id = item->getLocationId();
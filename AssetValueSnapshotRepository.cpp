@@ -68,16 +68,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     AssetValueSnapshotRepository::EntityList AssetValueSnapshotRepository
@@ -92,16 +83,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     QStringList AssetValueSnapshotRepository::getColumns() const
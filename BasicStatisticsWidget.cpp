@@ -13,6 +13,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <unordered_map>
+#include <optional>
 #include <memory>
 
 #include <QVBoxLayout>
@@ -33,6 +34,7 @@
 #include "WalletTransactionRepository.h"
 #include "WalletSnapshotRepository.h"
 #include "DateFilteredPlotWidget.h"
+#include "DatabaseWorkerPool.h"
 #include "CharacterRepository.h"
 #include "RepositoryProvider.h"
 #include "StatisticsSettings.h"
@@ -457,158 +459,180 @@ namespace Evernus
     void BasicStatisticsWidget::updateJournalData()
     {
         const auto combineStats = mCombineStatsBtn->isChecked();
-        const auto entries = (combineStats) ?
-                             (mJournalRepository.fetchInRange(QDateTime{mJournalPlot->getFrom()},
-                                                              QDateTime{mJournalPlot->getTo().addDays(1)},
-                                                              WalletJournalEntryRepository::EntryType::All)) :
-                             (mJournalRepository.fetchForCharacterInRange(mCharacterId,
-                                                                          QDateTime{mJournalPlot->getFrom()},
-                                                                          QDateTime{mJournalPlot->getTo().addDays(1)},
-                                                                          WalletJournalEntryRepository::EntryType::All));
-
-        auto totalIncome = 0., totalOutcome = 0.;
-
-        QHash<QDate, std::pair<double, double>> values;
-        const auto valueAdder = [&values, &totalIncome, &totalOutcome](const auto &entries) {
-            for (const auto &entry : entries)
-            {
-                if (entry->isIgnored())
-                    continue;
-
-                auto &value = values[entry->getTimestamp().toLocalTime().date()];
-
-                const auto amount = entry->getAmount();
-                if (Q_UNLIKELY(!amount))
-                    continue;
-
-                if (*amount < 0.)
-                {
-                    totalOutcome -= *amount;
-                    value.first -= *amount;
-                }
-                else
-                {
-                    totalIncome += *amount;
-                    value.second += *amount;
-                }
-            }
-        };
+        const auto characterId = mCharacterId;
+        const QDateTime from{mJournalPlot->getFrom()};
+        const QDateTime to{mJournalPlot->getTo().addDays(1)};
 
-        valueAdder(entries);
+        std::optional<quint64> corpId;
 
         QSettings settings;
         if (settings.value(StatisticsSettings::combineCorpAndCharPlotsKey, StatisticsSettings::combineCorpAndCharPlotsDefault).toBool())
         {
             try
             {
-                const auto corpId = mCharacterRepository.getCorporationId(mCharacterId);
-                const auto entries = (combineStats) ?
-                                     (mCorpJournalRepository.fetchInRange(QDateTime{mJournalPlot->getFrom()},
-                                                                          QDateTime{mJournalPlot->getTo().addDays(1)},
-                                                                          WalletJournalEntryRepository::EntryType::All)) :
-                                     (mCorpJournalRepository.fetchForCorporationInRange(corpId,
-                                                                                        QDateTime{mJournalPlot->getFrom()},
-                                                                                        QDateTime{mJournalPlot->getTo().addDays(1)},
-                                                                                        WalletJournalEntryRepository::EntryType::All));
-
-                valueAdder(entries);
+                corpId = mCharacterRepository.getCorporationId(characterId);
             }
             catch (const CharacterRepository::NotFoundException &)
             {
             }
         }
 
-        QVector<double> ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues;
-        createBarTicks(ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues, values);
+        const auto request = ++mJournalRequest;
+        const auto future = DatabaseWorkerPool::run([=, &repo = mJournalRepository, &corpRepo = mCorpJournalRepository] {
+            auto entries = (combineStats) ?
+                           (repo.fetchInRange(from, to, WalletJournalEntryRepository::EntryType::All)) :
+                           (repo.fetchForCharacterInRange(characterId, from, to, WalletJournalEntryRepository::EntryType::All));
 
-        mIncomingPlot->setData(incomingTicks, incomingValues);
-        mOutgoingPlot->setData(outgoingTicks, outgoingValues);
+            if (corpId)
+            {
+                const auto corpEntries = (combineStats) ?
+                                         (corpRepo.fetchInRange(from, to, WalletJournalEntryRepository::EntryType::All)) :
+                                         (corpRepo.fetchForCorporationInRange(*corpId, from, to, WalletJournalEntryRepository::EntryType::All));
 
-        mJournalPlot->getPlot().rescaleAxes();
-        mJournalPlot->getPlot().replot();
+                entries.insert(std::end(entries), std::begin(corpEntries), std::end(corpEntries));
+            }
 
-        const auto loc = locale();
+            return entries;
+        });
+
+        DatabaseWorkerPool::onFinished(future, this, [=](const auto &entries) {
+            // a newer request was made in the meantime
+            if (request != mJournalRequest)
+                return;
+
+            auto totalIncome = 0., totalOutcome = 0.;
+
+            QHash<QDate, std::pair<double, double>> values;
+            const auto valueAdder = [&values, &totalIncome, &totalOutcome](const auto &entries) {
+                for (const auto &entry : entries)
+                {
+                    if (entry->isIgnored())
+                        continue;
+
+                    auto &value = values[entry->getTimestamp().toLocalTime().date()];
+
+                    const auto amount = entry->getAmount();
+                    if (Q_UNLIKELY(!amount))
+                        continue;
+
+                    if (*amount < 0.)
+                    {
+                        totalOutcome -= *amount;
+                        value.first -= *amount;
+                    }
+                    else
+                    {
+                        totalIncome += *amount;
+                        value.second += *amount;
+                    }
+                }
+            };
+
+            valueAdder(entries);
+
+            QVector<double> ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues;
+            createBarTicks(ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues, values);
+
+            mIncomingPlot->setData(incomingTicks, incomingValues);
+            mOutgoingPlot->setData(outgoingTicks, outgoingValues);
+
+            mJournalPlot->getPlot().rescaleAxes();
+            mJournalPlot->getPlot().replot();
+
+            const auto loc = locale();
 
-        mJournalIncomeLabel->setText(TextUtils::currencyToString(totalIncome, loc));
-        mJournalOutcomeLabel->setText(TextUtils::currencyToString(totalOutcome, loc));
-        mJournalBalanceLabel->setText(TextUtils::currencyToString(totalIncome - totalOutcome, loc));
+            mJournalIncomeLabel->setText(TextUtils::currencyToString(totalIncome, loc));
+            mJournalOutcomeLabel->setText(TextUtils::currencyToString(totalOutcome, loc));
+            mJournalBalanceLabel->setText(TextUtils::currencyToString(totalIncome - totalOutcome, loc));
+        });
     }
 
     void BasicStatisticsWidget::updateTransactionData()
     {
         const auto combineStats = mCombineStatsBtn->isChecked();
-        const auto entries = (combineStats) ?
-                             (mTransactionRepository.fetchInRange(QDateTime{mTransactionPlot->getFrom()},
-                                                                  QDateTime{mTransactionPlot->getTo().addDays(1)},
-                                                                  WalletTransactionRepository::EntryType::All)) :
-                             (mTransactionRepository.fetchForCharacterInRange(mCharacterId,
-                                                                              QDateTime{mTransactionPlot->getFrom()},
-                                                                              QDateTime{mTransactionPlot->getTo().addDays(1)},
-                                                                              WalletTransactionRepository::EntryType::All));
-
-        auto totalIncome = 0., totalOutcome = 0.;
-
-        QHash<QDate, std::pair<double, double>> values;
-        const auto valueAdder = [&values, &totalIncome, &totalOutcome](const auto &entries) {
-            for (const auto &entry : entries)
-            {
-                if (entry->isIgnored())
-                    continue;
-
-                auto &value = values[entry->getTimestamp().toLocalTime().date()];
-
-                const auto amount = entry->getPrice() * entry->getQuantity();
-                if (entry->getType() == Evernus::WalletTransaction::Type::Buy)
-                {
-                    totalOutcome += amount;
-                    value.first += amount;
-                }
-                else
-                {
-                    totalIncome += amount;
-                    value.second += amount;
-                }
-            }
-        };
+        const auto characterId = mCharacterId;
+        const QDateTime from{mTransactionPlot->getFrom()};
+        const QDateTime to{mTransactionPlot->getTo().addDays(1)};
 
-        valueAdder(entries);
+        std::optional<quint64> corpId;
 
         QSettings settings;
         if (settings.value(StatisticsSettings::combineCorpAndCharPlotsKey, StatisticsSettings::combineCorpAndCharPlotsDefault).toBool())
         {
             try
             {
-                const auto corpId = mCharacterRepository.getCorporationId(mCharacterId);
-                const auto entries = (combineStats) ?
-                                     (mCorpTransactionRepository.fetchInRange(QDateTime{mJournalPlot->getFrom()},
-                                                                              QDateTime{mJournalPlot->getTo().addDays(1)},
-                                                                              WalletTransactionRepository::EntryType::All)) :
-                                     (mCorpTransactionRepository.fetchForCorporationInRange(corpId,
-                                                                                            QDateTime{mJournalPlot->getFrom()},
-                                                                                            QDateTime{mJournalPlot->getTo().addDays(1)},
-                                                                                            WalletTransactionRepository::EntryType::All));
-
-                valueAdder(entries);
+                corpId = mCharacterRepository.getCorporationId(characterId);
             }
             catch (const CharacterRepository::NotFoundException &)
             {
             }
         }
 
-        QVector<double> ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues;
-        createBarTicks(ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues, values);
+        const auto request = ++mTransactionRequest;
+        const auto future = DatabaseWorkerPool::run([=, &repo = mTransactionRepository, &corpRepo = mCorpTransactionRepository] {
+            auto entries = (combineStats) ?
+                           (repo.fetchInRange(from, to, WalletTransactionRepository::EntryType::All)) :
+                           (repo.fetchForCharacterInRange(characterId, from, to, WalletTransactionRepository::EntryType::All));
 
-        mSellPlot->setData(incomingTicks, incomingValues);
-        mBuyPlot->setData(outgoingTicks, outgoingValues);
+            if (corpId)
+            {
+                const auto corpEntries = (combineStats) ?
+                                         (corpRepo.fetchInRange(from, to, WalletTransactionRepository::EntryType::All)) :
+                                         (corpRepo.fetchForCorporationInRange(*corpId, from, to, WalletTransactionRepository::EntryType::All));
 
-        mTransactionPlot->getPlot().rescaleAxes();
-        mTransactionPlot->getPlot().replot();
+                entries.insert(std::end(entries), std::begin(corpEntries), std::end(corpEntries));
+            }
 
-        const auto loc = locale();
+            return entries;
+        });
+
+        DatabaseWorkerPool::onFinished(future, this, [=](const auto &entries) {
+            // a newer request was made in the meantime
+            if (request != mTransactionRequest)
+                return;
 
-        mTransactionsIncomeLabel->setText(TextUtils::currencyToString(totalIncome, loc));
-        mTransactionsOutcomeLabel->setText(TextUtils::currencyToString(totalOutcome, loc));
-        mTransactionsBalanceLabel->setText(TextUtils::currencyToString(totalIncome - totalOutcome, loc));
+            auto totalIncome = 0., totalOutcome = 0.;
+
+            QHash<QDate, std::pair<double, double>> values;
+            const auto valueAdder = [&values, &totalIncome, &totalOutcome](const auto &entries) {
+                for (const auto &entry : entries)
+                {
+                    if (entry->isIgnored())
+                        continue;
+
+                    auto &value = values[entry->getTimestamp().toLocalTime().date()];
+
+                    const auto amount = entry->getPrice() * entry->getQuantity();
+                    if (entry->getType() == Evernus::WalletTransaction::Type::Buy)
+                    {
+                        totalOutcome += amount;
+                        value.first += amount;
+                    }
+                    else
+                    {
+                        totalIncome += amount;
+                        value.second += amount;
+                    }
+                }
+            };
+
+            valueAdder(entries);
+
+            QVector<double> ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues;
+            createBarTicks(ticks, incomingTicks, outgoingTicks, incomingValues, outgoingValues, values);
+
+            mSellPlot->setData(incomingTicks, incomingValues);
+            mBuyPlot->setData(outgoingTicks, outgoingValues);
+
+            mTransactionPlot->getPlot().rescaleAxes();
+            mTransactionPlot->getPlot().replot();
+
+            const auto loc = locale();
+
+            mTransactionsIncomeLabel->setText(TextUtils::currencyToString(totalIncome, loc));
+            mTransactionsOutcomeLabel->setText(TextUtils::currencyToString(totalOutcome, loc));
+            mTransactionsBalanceLabel->setText(TextUtils::currencyToString(totalIncome - totalOutcome, loc));
+        });
     }
 
     void BasicStatisticsWidget::updateData()
@@ -105,6 +105,9 @@ namespace Evernus
 
         Character::IdType mCharacterId = Character::invalidId;
 
+        uint mJournalRequest = 0;
+        uint mTransactionRequest = 0;
+
         void updateGraphAndLegend();
         void updateGraphColors();
 
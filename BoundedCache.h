@@ -0,0 +1,109 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <list>
+
+#include "CacheStats.h"
+
+namespace Evernus
+{
+    // map which evicts least recently used entries once their total weight exceeds the budget
+    // not thread safe
+    template<class Key, class Value, class Hash = std::hash<Key>>
+    class BoundedCache final
+    {
+    public:
+        // approximate memory taken by a value, including sizeof(Value)
+        using Weigher = std::function<std::size_t (const Value &)>;
+
+        static const std::size_t unbounded = 0;
+
+        explicit BoundedCache(Weigher weigher = Weigher{}, std::size_t budget = unbounded);
+        BoundedCache(const BoundedCache &) = delete;
+        BoundedCache(BoundedCache &&) = default;
+        ~BoundedCache() = default;
+
+        // marks the entry as most recently used; null if missing
+        Value *find(const Key &key);
+        // doesn't affect recency or statistics
+        const Value *peek(const Key &key) const;
+        bool contains(const Key &key) const;
+
+        // replaces an existing value; the inserted entry itself is never evicted
+        Value &insert(const Key &key, Value value);
+        void erase(const Key &key);
+        template<class Predicate>
+        void eraseIf(const Predicate &predicate);
+        void clear();
+
+        // needed after a value is modified in place
+        void updateWeight(const Key &key);
+
+        // doesn't affect recency
+        template<class Function>
+        void forEach(const Function &function);
+        template<class Function>
+        void forEach(const Function &function) const;
+
+        // in bytes; shrinking evicts immediately
+        void setBudget(std::size_t budget);
+
+        CacheStats getStats() const noexcept;
+
+        BoundedCache &operator =(const BoundedCache &) = delete;
+        BoundedCache &operator =(BoundedCache &&) = default;
+
+    private:
+        struct Entry
+        {
+            Key mKey;
+            Value mValue;
+            std::size_t mWeight;
+        };
+
+        using EntryList = std::list<Entry>;
+
+        Weigher mWeigher;
+        std::size_t mBudget = unbounded;
+        std::size_t mBytes = 0;
+
+        // most recently used first
+        EntryList mEntries;
+        std::unordered_map<Key, typename EntryList::iterator, Hash> mIndex;
+
+        quint64 mHits = 0;
+        quint64 mMisses = 0;
+        quint64 mEvictions = 0;
+
+        void evict();
+
+        std::size_t getWeight(const Value &value) const;
+    };
+
+    // weight of a list of shared entities, not counting data owned by the entities themselves
+    template<class T>
+    std::size_t getSharedListWeight(const std::vector<std::shared_ptr<T>> &list) noexcept
+    {
+        // make_shared keeps the control block next to the entity
+        return sizeof(list) + list.capacity() * sizeof(std::shared_ptr<T>) + list.size() * (sizeof(T) + 2 * sizeof(void *));
+    }
+}
+
+#include "BoundedCache.inl"
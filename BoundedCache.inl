@@ -0,0 +1,198 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Evernus
+{
+    template<class Key, class Value, class Hash>
+    BoundedCache<Key, Value, Hash>::BoundedCache(Weigher weigher, std::size_t budget)
+        : mWeigher{std::move(weigher)}
+        , mBudget{budget}
+    {
+    }
+
+    template<class Key, class Value, class Hash>
+    Value *BoundedCache<Key, Value, Hash>::find(const Key &key)
+    {
+        const auto it = mIndex.find(key);
+        if (it == std::end(mIndex))
+        {
+            ++mMisses;
+            return nullptr;
+        }
+
+        ++mHits;
+
+        mEntries.splice(std::begin(mEntries), mEntries, it->second);
+        return &it->second->mValue;
+    }
+
+    template<class Key, class Value, class Hash>
+    const Value *BoundedCache<Key, Value, Hash>::peek(const Key &key) const
+    {
+        const auto it = mIndex.find(key);
+        return (it == std::end(mIndex)) ? (nullptr) : (&it->second->mValue);
+    }
+
+    template<class Key, class Value, class Hash>
+    bool BoundedCache<Key, Value, Hash>::contains(const Key &key) const
+    {
+        return mIndex.find(key) != std::end(mIndex);
+    }
+
+    template<class Key, class Value, class Hash>
+    Value &BoundedCache<Key, Value, Hash>::insert(const Key &key, Value value)
+    {
+        const auto weight = getWeight(value);
+
+        const auto it = mIndex.find(key);
+        if (it != std::end(mIndex))
+        {
+            mBytes -= it->second->mWeight;
+
+            it->second->mValue = std::move(value);
+            it->second->mWeight = weight;
+
+            mEntries.splice(std::begin(mEntries), mEntries, it->second);
+        }
+        else
+        {
+            mEntries.emplace_front(Entry{key, std::move(value), weight});
+            mIndex.emplace(key, std::begin(mEntries));
+        }
+
+        mBytes += weight;
+        evict();
+
+        return mEntries.front().mValue;
+    }
+
+    template<class Key, class Value, class Hash>
+    void BoundedCache<Key, Value, Hash>::erase(const Key &key)
+    {
+        const auto it = mIndex.find(key);
+        if (it == std::end(mIndex))
+            return;
+
+        mBytes -= it->second->mWeight;
+        mEntries.erase(it->second);
+        mIndex.erase(it);
+    }
+
+    template<class Key, class Value, class Hash>
+    template<class Predicate>
+    void BoundedCache<Key, Value, Hash>::eraseIf(const Predicate &predicate)
+    {
+        for (auto it = std::begin(mEntries); it != std::end(mEntries);)
+        {
+            if (predicate(it->mKey, it->mValue))
+            {
+                mBytes -= it->mWeight;
+                mIndex.erase(it->mKey);
+                it = mEntries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    template<class Key, class Value, class Hash>
+    void BoundedCache<Key, Value, Hash>::clear()
+    {
+        mEntries.clear();
+        mIndex.clear();
+        mBytes = 0;
+    }
+
+    template<class Key, class Value, class Hash>
+    void BoundedCache<Key, Value, Hash>::updateWeight(const Key &key)
+    {
+        const auto it = mIndex.find(key);
+        if (it == std::end(mIndex))
+            return;
+
+        const auto weight = getWeight(it->second->mValue);
+
+        mBytes = mBytes - it->second->mWeight + weight;
+        it->second->mWeight = weight;
+
+        mEntries.splice(std::begin(mEntries), mEntries, it->second);
+        evict();
+    }
+
+    template<class Key, class Value, class Hash>
+    template<class Function>
+    void BoundedCache<Key, Value, Hash>::forEach(const Function &function)
+    {
+        for (auto &entry : mEntries)
+            function(entry.mKey, entry.mValue);
+    }
+
+    template<class Key, class Value, class Hash>
+    template<class Function>
+    void BoundedCache<Key, Value, Hash>::forEach(const Function &function) const
+    {
+        for (const auto &entry : mEntries)
+            function(entry.mKey, entry.mValue);
+    }
+
+    template<class Key, class Value, class Hash>
+    void BoundedCache<Key, Value, Hash>::setBudget(std::size_t budget)
+    {
+        mBudget = budget;
+        evict();
+    }
+
+    template<class Key, class Value, class Hash>
+    CacheStats BoundedCache<Key, Value, Hash>::getStats() const noexcept
+    {
+        CacheStats stats;
+        stats.mHits = mHits;
+        stats.mMisses = mMisses;
+        stats.mEvictions = mEvictions;
+        stats.mEntries = mIndex.size();
+        stats.mBytes = mBytes;
+        stats.mBudget = mBudget;
+
+        return stats;
+    }
+
+    template<class Key, class Value, class Hash>
+    void BoundedCache<Key, Value, Hash>::evict()
+    {
+        if (mBudget == unbounded)
+            return;
+
+        // the most recent entry stays, even if it alone is over budget
+        while (mBytes > mBudget && mEntries.size() > 1)
+        {
+            const auto &entry = mEntries.back();
+
+            mBytes -= entry.mWeight;
+            mIndex.erase(entry.mKey);
+            mEntries.pop_back();
+
+            ++mEvictions;
+        }
+    }
+
+    template<class Key, class Value, class Hash>
+    std::size_t BoundedCache<Key, Value, Hash>::getWeight(const Value &value) const
+    {
+        // list node, index node and bookkeeping
+        const auto overhead = 2 * sizeof(Key) + sizeof(Entry) - sizeof(Value) + 6 * sizeof(void *);
+        return overhead + ((mWeigher) ? (mWeigher(value)) : (sizeof(Value)));
+    }
+}
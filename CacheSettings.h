@@ -0,0 +1,36 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+namespace Evernus
+{
+    namespace CacheSettings
+    {
+        // budgets are in MiB, 0 disables the limit
+        const auto externalOrderBudgetDefault = 256u;
+        const auto locationNameBudgetDefault = 16u;
+        const auto marketOrderBudgetDefault = 64u;
+        const auto assetBudgetDefault = 128u;
+        const auto contractBudgetDefault = 32u;
+        const auto esiResponseBudgetDefault = 128u;
+
+        const auto externalOrderBudgetKey = "cache/budget/externalOrders";
+        const auto locationNameBudgetKey = "cache/budget/locationNames";
+        const auto marketOrderBudgetKey = "cache/budget/marketOrders";
+        const auto assetBudgetKey = "cache/budget/assets";
+        const auto contractBudgetKey = "cache/budget/contracts";
+        const auto esiResponseBudgetKey = "cache/budget/esiResponses";
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <vector>
+
+#include <QString>
+
+namespace Evernus
+{
+    struct CacheStats
+    {
+        quint64 mHits = 0;
+        quint64 mMisses = 0;
+        // lock acquisitions which had to wait for another thread
+        quint64 mContentions = 0;
+        quint64 mEvictions = 0;
+        quint64 mEntries = 0;
+        quint64 mBytes = 0;
+        // 0 means unbounded
+        quint64 mBudget = 0;
+
+        inline double getHitRatio() const noexcept
+        {
+            const auto total = mHits + mMisses;
+            return (total == 0) ? (0.) : (static_cast<double>(mHits) / total);
+        }
+    };
+
+    struct CacheStatisticsEntry
+    {
+        QString mName;
+        CacheStats mStats;
+    };
+
+    using CacheStatistics = std::vector<CacheStatisticsEntry>;
+}
@@ -14,8 +14,11 @@
  */
 #include <functional>
 
+#include <QSettings>
+
 #include "CharacterRepository.h"
 #include "ItemRepository.h"
+#include "CacheSettings.h"
 
 #include "CachingAssetProvider.h"
 
@@ -28,7 +31,10 @@ namespace Evernus
         , mCharacterRepository{characterRepository}
         , mAssetRepository{assetRepository}
         , mItemRepository{itemRepository}
+        , mAssets{&CachingAssetProvider::getAssetWeight}
     {
+        QSettings settings;
+        mAssets.setBudget(settings.value(CacheSettings::assetBudgetKey, CacheSettings::assetBudgetDefault).toULongLong() * 1024 * 1024);
     }
 
     CachingAssetProvider::AssetPtr CachingAssetProvider::fetchAssetsForCharacter(Character::IdType id) const
@@ -36,9 +42,9 @@ namespace Evernus
         if (id == Character::invalidId)
            return std::make_shared<AssetList>();
 
-        const auto it = mAssets.find(id);
-        if (it != std::end(mAssets))
-           return it->second;
+        const auto cached = mAssets.find(id);
+        if (cached != nullptr)
+           return *cached;
 
         AssetListRepository::EntityPtr assets;
 
@@ -52,7 +58,7 @@ namespace Evernus
            assets->setCharacterId(id);
         }
 
-        mAssets.emplace(id, assets);
+        mAssets.insert(id, assets);
         return assets;
     }
 
@@ -89,9 +95,17 @@ namespace Evernus
 
     void CachingAssetProvider::setForCharacter(Character::IdType id, const AssetList &assets)
     {
-        const auto it = mAssets.find(id);
-        if (it != std::end(mAssets))
-            *it->second = assets;
+        const auto cached = mAssets.find(id);
+        if (cached != nullptr)
+        {
+            **cached = assets;
+            mAssets.updateWeight(id);
+        }
+    }
+
+    CacheStats CachingAssetProvider::getCacheStats() const noexcept
+    {
+        return mAssets.getStats();
     }
 
     Item *CachingAssetProvider::findItem(Item::IdType id) const
@@ -110,16 +124,38 @@ namespace Evernus
             return nullptr;
         };
 
-        for (const auto &assets : mAssets)
-        {
-            for (const auto &item : *assets.second)
+        Item *found = nullptr;
+
+        // evicted lists are reloaded from the database, which already has the change
+        mAssets.forEach([&](const auto &characterId, const auto &assets) {
+            Q_UNUSED(characterId);
+
+            for (const auto &item : *assets)
             {
-                const auto found = lookForItem(*item);
                 if (found != nullptr)
-                    return found;
+                    return;
+
+                found = lookForItem(*item);
             }
-        }
+        });
+
+        return found;
+    }
+
+    std::size_t CachingAssetProvider::getAssetWeight(const AssetListRepository::EntityPtr &assets)
+    {
+        const std::function<std::size_t (const Item &)> getItemWeight = [&](const Item &item) {
+            auto weight = sizeof(Item) + sizeof(AssetList::ItemType);
+            for (const auto &child : item)
+                weight += getItemWeight(*child);
+
+            return weight;
+        };
+
+        auto weight = sizeof(AssetList) + 2 * sizeof(void *);
+        for (const auto &item : *assets)
+            weight += getItemWeight(*item);
 
-        return nullptr;
+        return weight;
     }
 }
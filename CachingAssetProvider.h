@@ -14,10 +14,9 @@
  */
 #pragma once
 
-#include <unordered_map>
-
 #include "AssetListRepository.h"
 #include "AssetProvider.h"
+#include "BoundedCache.h"
 #include "Item.h"
 
 namespace Evernus
@@ -42,8 +41,10 @@ namespace Evernus
 
         void setForCharacter(Character::IdType id, const AssetList &assets);
 
+        CacheStats getCacheStats() const noexcept;
+
     private:
-        using CharacterAssetMap = std::unordered_map<Character::IdType, AssetListRepository::EntityPtr>;
+        using CharacterAssetMap = BoundedCache<Character::IdType, AssetListRepository::EntityPtr>;
 
         const CharacterRepository &mCharacterRepository;
         const AssetListRepository &mAssetRepository;
@@ -52,5 +53,7 @@ namespace Evernus
         mutable CharacterAssetMap mAssets;
 
         Item *findItem(Item::IdType id) const;
+
+        static std::size_t getAssetWeight(const AssetListRepository::EntityPtr &assets);
     };
 }
@@ -12,7 +12,10 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <QSettings>
+
 #include "ContractRepository.h"
+#include "CacheSettings.h"
 
 #include "CachingContractProvider.h"
 
@@ -21,54 +24,71 @@ namespace Evernus
     CachingContractProvider::CachingContractProvider(const ContractRepository &contractRepo)
         : ContractProvider{}
         , mContractRepo{contractRepo}
+        , mContracts{&getSharedListWeight<Contract>}
     {
+        QSettings settings;
+        mContracts.setBudget(settings.value(CacheSettings::contractBudgetKey, CacheSettings::contractBudgetDefault).toULongLong() * 1024 * 1024);
     }
 
     ContractProvider::ContractList CachingContractProvider::getIssuedContracts(Character::IdType characterId) const
     {
-        const auto it = mIssuedContracts.find(characterId);
-        if (it != std::end(mIssuedContracts))
-            return it->second;
-
-        return mIssuedContracts.emplace(characterId, mContractRepo.fetchIssuedForCharacter(characterId)).first->second;
+        return getContracts(ContractSet::Issued, characterId, [=] {
+            return mContractRepo.fetchIssuedForCharacter(characterId);
+        });
     }
 
     ContractProvider::ContractList CachingContractProvider::getAssignedContracts(Character::IdType characterId) const
     {
-        const auto it = mAssignedContracts.find(characterId);
-        if (it != std::end(mAssignedContracts))
-            return it->second;
-
-        return mAssignedContracts.emplace(characterId, mContractRepo.fetchAssignedForCharacter(characterId)).first->second;
+        return getContracts(ContractSet::Assigned, characterId, [=] {
+            return mContractRepo.fetchAssignedForCharacter(characterId);
+        });
     }
 
     ContractProvider::ContractList CachingContractProvider::getIssuedContractsForCorporation(quint64 corporationId) const
     {
-        const auto it = mIssuedCorpContracts.find(corporationId);
-        if (it != std::end(mIssuedCorpContracts))
-            return it->second;
-
-        return mIssuedCorpContracts.emplace(corporationId, mContractRepo.fetchIssuedForCorporation(corporationId)).first->second;
+        return getContracts(ContractSet::CorpIssued, corporationId, [=] {
+            return mContractRepo.fetchIssuedForCorporation(corporationId);
+        });
     }
 
     ContractProvider::ContractList CachingContractProvider::getAssignedContractsForCorporation(quint64 corporationId) const
     {
-        const auto it = mAssignedCorpContracts.find(corporationId);
-        if (it != std::end(mAssignedCorpContracts))
-            return it->second;
-
-        return mAssignedCorpContracts.emplace(corporationId, mContractRepo.fetchAssignedForCorporation(corporationId)).first->second;
+        return getContracts(ContractSet::CorpAssigned, corporationId, [=] {
+            return mContractRepo.fetchAssignedForCorporation(corporationId);
+        });
     }
 
     void CachingContractProvider::clearForCharacter(Character::IdType id) const
     {
-        mIssuedContracts.erase(id);
-        mAssignedContracts.erase(id);
+        mContracts.erase(getKey(ContractSet::Issued, id));
+        mContracts.erase(getKey(ContractSet::Assigned, id));
     }
 
     void CachingContractProvider::clearForCorporation(uint id) const
     {
-        mIssuedCorpContracts.erase(id);
-        mAssignedCorpContracts.erase(id);
+        mContracts.erase(getKey(ContractSet::CorpIssued, id));
+        mContracts.erase(getKey(ContractSet::CorpAssigned, id));
+    }
+
+    CacheStats CachingContractProvider::getCacheStats() const noexcept
+    {
+        return mContracts.getStats();
+    }
+
+    template<class Fetcher>
+    ContractProvider::ContractList CachingContractProvider::getContracts(ContractSet set, quint64 ownerId, const Fetcher &fetcher) const
+    {
+        const auto key = getKey(set, ownerId);
+
+        const auto contracts = mContracts.find(key);
+        if (contracts != nullptr)
+            return *contracts;
+
+        return mContracts.insert(key, fetcher());
+    }
+
+    CachingContractProvider::ContractSetKey CachingContractProvider::getKey(ContractSet set, quint64 ownerId) noexcept
+    {
+        return std::make_pair(static_cast<int>(set), ownerId);
     }
 }
@@ -14,9 +14,12 @@
  */
 #pragma once
 
-#include <unordered_map>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
 
 #include "ContractProvider.h"
+#include "BoundedCache.h"
 
 namespace Evernus
 {
@@ -37,10 +40,26 @@ namespace Evernus
         void clearForCharacter(Character::IdType id) const;
         void clearForCorporation(uint id) const;
 
+        CacheStats getCacheStats() const noexcept;
+
     private:
+        enum class ContractSet
+        {
+            Issued,
+            Assigned,
+            CorpIssued,
+            CorpAssigned
+        };
+
+        using ContractSetKey = std::pair<int, quint64>;
+
         const ContractRepository &mContractRepo;
 
-        mutable std::unordered_map<Character::IdType, ContractList> mIssuedContracts, mAssignedContracts;
-        mutable std::unordered_map<quint64, ContractList> mIssuedCorpContracts, mAssignedCorpContracts;
+        mutable BoundedCache<ContractSetKey, ContractList, boost::hash<ContractSetKey>> mContracts;
+
+        template<class Fetcher>
+        ContractList getContracts(ContractSet set, quint64 ownerId, const Fetcher &fetcher) const;
+
+        static ContractSetKey getKey(ContractSet set, quint64 ownerId) noexcept;
     };
 }
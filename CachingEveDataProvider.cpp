@@ -12,7 +12,10 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <queue>
+#include <algorithm>
+#include <iterator>
+
+#include <boost/throw_exception.hpp>
 
 #include <QtDebug>
 
@@ -27,6 +30,8 @@
 #include "DatabaseConnectionProvider.h"
 #include "EveDataManagerProvider.h"
 #include "MarketOrderRepository.h"
+#include "UpdaterSettings.h"
+#include "CacheSettings.h"
 #include "UISettings.h"
 
 #include "CachingEveDataProvider.h"
@@ -34,11 +39,12 @@
 namespace Evernus
 {
     const QString CachingEveDataProvider::nameCacheFileName = "generic_names";
+    const QString CachingEveDataProvider::nameLogFileName = "generic_names_log";
     const QString CachingEveDataProvider::raceCacheFileName = "race_names";
     const QString CachingEveDataProvider::bloodlineCacheFileName = "bloodline_names";
     const QString CachingEveDataProvider::ancestryCacheFileName = "ancestry_names";
 
-    const QString CachingEveDataProvider::systemDistanceCacheFileName = "system_distances";
+    const QString CachingEveDataProvider::systemDistanceCacheFileName = "system_distance_tables";
 
     const QStringList CachingEveDataProvider::oreGroupNames = {
         QStringLiteral("Veldspar"),
@@ -61,30 +67,32 @@ namespace Evernus
     };
 
     CachingEveDataProvider::CachingEveDataProvider(const EveTypeRepository &eveTypeRepository,
-                                                   const MetaGroupRepository &metaGroupRepository,
                                                    const ExternalOrderRepository &externalOrderRepository,
                                                    const MarketOrderRepository &marketOrderRepository,
                                                    const MarketOrderRepository &corpMarketOrderRepository,
-                                                   const MarketGroupRepository &marketGroupRepository,
                                                    const CitadelRepository &citadelRepository,
                                                    const EveDataManagerProvider &dataManagerProvider,
                                                    const DatabaseConnectionProvider &connectionProvider,
                                                    QObject *parent)
         : EveDataProvider{parent}
         , mEveTypeRepository{eveTypeRepository}
-        , mMetaGroupRepository{metaGroupRepository}
         , mExternalOrderRepository{externalOrderRepository}
         , mMarketOrderRepository{marketOrderRepository}
         , mCorpMarketOrderRepository{corpMarketOrderRepository}
-        , mMarketGroupRepository{marketGroupRepository}
         , mCitadelRepository{citadelRepository}
         , mDataManagerProvider{dataManagerProvider}
         , mConnectionProvider{connectionProvider}
+        , mOrderBooks{[](const auto &book) { return sizeof(*book) + book->mBook.getMemoryUsage(); }}
+        , mBuyPriceTables{[](const auto &table) { return sizeof(*table) + table->mTable.getMemoryUsage(); }}
+        , mLocationNameCache{[](const auto &name) { return sizeof(name) + name.capacity() * sizeof(QChar); }}
     {
-        readCache(nameCacheFileName, mGenericNameCache);
-        findManufaturingActivity();
+        readGenericNameCache();
         handleNewPreferences();
 
+        mGenericNameBatchTimer.setSingleShot(true);
+        mGenericNameBatchTimer.setInterval(genericNameBatchDelay);
+
+        connect(&mGenericNameBatchTimer, &QTimer::timeout, this, &CachingEveDataProvider::fetchQueuedGenericNames);
         connect(this, &CachingEveDataProvider::genericNameRequested, this, &CachingEveDataProvider::fetchGenericName);
     }
 
@@ -95,8 +103,6 @@ namespace Evernus
             const auto dataCacheDir = getCacheDir();
             if (dataCacheDir.mkpath(QStringLiteral(".")))
             {
-                cacheWrite(nameCacheFileName, mGenericNameCache);
-                cacheWrite(systemDistanceCacheFileName, mSystemDistances);
                 cacheWrite(raceCacheFileName, mRaceNameCache);
                 cacheWrite(bloodlineCacheFileName, mBloodlineNameCache);
                 cacheWrite(ancestryCacheFileName, mAncestryNameCache);
@@ -109,32 +115,28 @@ namespace Evernus
 
     QString CachingEveDataProvider::getTypeName(EveType::IdType id) const
     {
-        return getEveType(id)->getName();
+        return mTypeMetadata.getName(mTypeMetadata.getOrdinal(id));
     }
 
     QString CachingEveDataProvider::getTypeMarketGroupParentName(EveType::IdType id) const
     {
-        const auto type = getEveType(id);
-        const auto marketGroupId = type->getMarketGroupId();
-        return (marketGroupId) ? (getMarketGroupParent(*marketGroupId)->getName()) : (QString{});
+        return mTypeMetadata.getMarketGroupParentName(mTypeMetadata.getOrdinal(id));
     }
 
     QString CachingEveDataProvider::getTypeMarketGroupName(EveType::IdType id) const
     {
-        const auto type = getEveType(id);
-        const auto marketGroupId = type->getMarketGroupId();
-        return (marketGroupId) ? (getMarketGroup(*marketGroupId)->getName()) : (QString{});
+        return mTypeMetadata.getMarketGroupName(mTypeMetadata.getOrdinal(id));
     }
 
     MarketGroup::IdType CachingEveDataProvider::getTypeMarketGroupParentId(EveType::IdType id) const
     {
-        const auto type = getEveType(id);
-        const auto marketGroupId = type->getMarketGroupId();
-        return (marketGroupId) ? (getMarketGroupParent(*marketGroupId)->getId()) : (MarketGroup::invalidId);
+        return mTypeMetadata.getMarketGroupParentId(mTypeMetadata.getOrdinal(id));
     }
 
     const std::unordered_map<EveType::IdType, QString> &CachingEveDataProvider::getAllTradeableTypeNames() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (!mTradeableTypeNameCache.empty())
             return mTradeableTypeNameCache;
 
@@ -144,6 +146,8 @@ namespace Evernus
 
     const CachingEveDataProvider::TypeList &CachingEveDataProvider::getAllTradeableTypeIds() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (!mTradeableTypeCache.empty())
             return mTradeableTypeCache;
 
@@ -153,6 +157,8 @@ namespace Evernus
 
     const CachingEveDataProvider::TypeList &CachingEveDataProvider::getCitadelTypeIds() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (!mCitadelTypeCache.empty())
             return mCitadelTypeCache;
 
@@ -162,23 +168,7 @@ namespace Evernus
 
     QString CachingEveDataProvider::getTypeMetaGroupName(EveType::IdType id) const
     {
-        const auto it = mTypeMetaGroupCache.find(id);
-        if (it != std::end(mTypeMetaGroupCache))
-            return it->second->getName();
-
-        MetaGroupRepository::EntityPtr result;
-
-        try
-        {
-            result = mMetaGroupRepository.fetchForType(id);
-        }
-        catch (const MetaGroupRepository::NotFoundException &)
-        {
-            result = std::make_shared<MetaGroup>();
-        }
-
-        mTypeMetaGroupCache.emplace(id, result);
-        return result->getName();
+        return mTypeMetadata.getMetaGroupName(mTypeMetadata.getOrdinal(id));
     }
 
     QString CachingEveDataProvider::getGenericName(quint64 id) const
@@ -186,16 +176,19 @@ namespace Evernus
         if (Q_UNLIKELY(id == 0))
             return tr("(unknown)");
 
-        std::lock_guard<std::recursive_mutex> lock{mGenericNameCacheMutex};
+        {
+            std::lock_guard<std::mutex> lock{mGenericNameCacheMutex};
 
-        if (mGenericNameCache.contains(id))
-            return mGenericNameCache[id];
+            if (mGenericNameCache.contains(id))
+                return mGenericNameCache[id];
 
-        if (mPendingNameRequests.find(id) == std::end(mPendingNameRequests))
-        {
-            emit genericNameRequested(id);
+            // mark as pending here, so concurrent callers don't request the same name again
+            if (!mPendingNameRequests.emplace(id).second)
+                return tr("(unknown)");
         }
 
+        // emitted without the lock - the slot may run synchronously and needs it
+        emit genericNameRequested(id);
         return tr("(unknown)");
     }
 
@@ -204,31 +197,16 @@ namespace Evernus
         if (Q_UNLIKELY(id == 0))
             return true;
 
-        std::lock_guard<std::recursive_mutex> lock{mGenericNameCacheMutex};
+        std::lock_guard<std::mutex> lock{mGenericNameCacheMutex};
         return mGenericNameCache.contains(id);
     }
 
     double CachingEveDataProvider::getTypeVolume(EveType::IdType id) const
     {
-        std::lock_guard<std::mutex> lock{mTypeCacheMutex};
-
-        const auto it = mTypeCache.find(id);
-        if (it != std::end(mTypeCache))
-            return (mUsePackagedVolume) ? (getPackagedVolume(*it->second)) : (it->second->getVolume());
+        const auto ordinal = mTypeMetadata.getOrdinal(id);
+        const auto volume = mTypeMetadata.getVolume(ordinal);
 
-        EveTypeRepository::EntityPtr result;
-
-        try
-        {
-            result = mEveTypeRepository.find(id);
-        }
-        catch (const EveTypeRepository::NotFoundException &)
-        {
-            result = std::make_shared<EveType>();
-        }
-
-        mTypeCache.emplace(id, result);
-        return (mUsePackagedVolume) ? (getPackagedVolume(*result)) : (result->getVolume());
+        return (mUsePackagedVolume) ? (getPackagedVolume(mTypeMetadata.getGroupId(ordinal), volume)) : (volume);
     }
 
     std::shared_ptr<ExternalOrder> CachingEveDataProvider::getTypeStationSellPrice(EveType::IdType id, quint64 stationId) const
@@ -238,201 +216,226 @@ namespace Evernus
 
     std::shared_ptr<ExternalOrder> CachingEveDataProvider::getTypeRegionSellPrice(EveType::IdType id, uint regionId) const
     {
-        const auto key = std::make_pair(id, regionId);
-        const auto it = mRegionSellPrices.find(key);
-        if (it != std::end(mRegionSellPrices))
-            return it->second;
+        const auto book = getOrderBook(id, regionId);
 
-        std::shared_ptr<ExternalOrder> result;
-
-        try
-        {
-            result = mExternalOrderRepository.findSellByTypeAndRegion(id, regionId, mMarketOrderRepository, mCorpMarketOrderRepository);
-        }
-        catch (const ExternalOrderRepository::NotFoundException &)
-        {
-            result = std::make_shared<ExternalOrder>();
-        }
-
-        mRegionSellPrices.emplace(key, result);
-        return result;
+        const auto result = book->mBook.getBestOrder(ExternalOrder::Type::Sell, getOwnActiveOrderIds()->mIds);
+        return (result) ? (result) : (std::make_shared<ExternalOrder>());
     }
 
     std::shared_ptr<ExternalOrder> CachingEveDataProvider::getTypeBuyPrice(EveType::IdType id, quint64 stationId, int range) const
     {
-        std::lock_guard<std::recursive_mutex> lock{mExternalOrderCacheMutex};
-
-        const auto key = std::make_pair(id, stationId);
-        const auto it = mBuyPrices.find(key);
-        if (it != std::end(mBuyPrices))
-            return it->second;
-
-        auto result = std::make_shared<ExternalOrder>();
-        mBuyPrices.emplace(key, result);
-
         const auto solarSystemId = getStationSolarSystemId(stationId);
         if (solarSystemId == 0)
-            return result;
+            return std::make_shared<ExternalOrder>();
 
         const auto regionId = getSolarSystemRegionId(solarSystemId);
         if (regionId == 0)
-            return result;
+            return std::make_shared<ExternalOrder>();
 
-        const uint realRange = (range < 0) ? (0) : (range);
-        const auto &orders = getExternalOrders(id, regionId);
-        for (const auto &order : orders)
+        // resolve all stations in the region at once, so repeated lookups don't rescan orders
+        const auto key = std::make_pair(id, regionId);
+        const auto generation = getExternalOrderGeneration(id, regionId);
+
+        std::shared_ptr<const BuyPriceTableSnapshot> table;
+
+        const auto cached = mBuyPriceTables.find(key);
+        if (cached && (*cached)->mGeneration >= generation)
         {
-            if (order->getPrice() <= result->getPrice())
-                continue;
+            table = *cached;
+        }
+        else
+        {
+            const auto orders = getOrderBook(id, regionId)->mBook.getOrders(ExternalOrder::Type::Buy, getOwnActiveOrderIds()->mIds);
+            table = std::make_shared<const BuyPriceTableSnapshot>(generation, orders, mSystemDistances.getRegionSystems(regionId), mSystemDistances);
 
-            if (order->getRange() == -1)
-            {
-                if (range == -1)
-                {
-                    if (order->getStationId() != stationId)
-                        continue;
-                }
-                else
-                {
-                    if (getDistance(solarSystemId, order->getSolarSystemId()) > realRange)
-                        continue;
-                }
-            }
-            else if (getDistance(solarSystemId, order->getSolarSystemId()) > order->getRange() + realRange)
+            // orders changed while building - keep the table to answer this lookup only
+            if (getExternalOrderGeneration(id, regionId) == generation)
             {
-                continue;
+                mBuyPriceTables.insert(key, table, [=](const auto &existing) {
+                    return existing->mGeneration < generation;
+                });
             }
-
-            result = order;
         }
 
-        mBuyPrices[key] = result;
-        return result;
+        const auto newRange = !table->mTable.hasRange(range);
+        const auto result = table->mTable.getBestOrder(stationId, solarSystemId, range);
+
+        // the lookup has built a table for a new range
+        if (newRange)
+            mBuyPriceTables.updateWeight(key);
+
+        return (result) ? (result) : (std::make_shared<ExternalOrder>());
+    }
+
+    quint64 CachingEveDataProvider::getExternalOrderGeneration(EveType::IdType id, uint regionId) const
+    {
+        const auto slot = boost::hash<TypeRegionPair>{}(std::make_pair(id, regionId)) % orderGenerationSlots;
+        return mGlobalOrderGeneration.load(std::memory_order_acquire) + mOrderGenerations[slot].load(std::memory_order_acquire);
     }
 
     void CachingEveDataProvider::updateExternalOrders(const std::vector<ExternalOrder> &orders)
     {
         TypeLocationPairs affectedOrders;
 
-        std::vector<std::reference_wrapper<const ExternalOrder>> toStore;
+        ExternalOrderRepository::OrderRefList toStore;
         for (const auto &order : orders)
         {
             toStore.emplace_back(std::cref(order));
             affectedOrders.emplace(std::make_pair(order.getTypeId(), order.getRegionId()));
         }
 
-        clearExternalOrderCaches();
+        const auto result = mExternalOrderRepository.applyDelta(toStore, affectedOrders);
+        qDebug() << "External orders updated - inserted:" << result.mInserted
+                 << "updated:" << result.mUpdated
+                 << "deleted:" << result.mDeleted
+                 << "unchanged:" << result.mUnchanged
+                 << "write time:" << result.mWriteTime << "ms"
+                 << "index rebuild time:" << result.mIndexRebuildTime << "ms";
+
+        // the update holds the complete order set of each affected type and region, so loaded books can be replaced
+        // instead of reloaded
+        std::unordered_map<TypeRegionPair, ExternalOrderRepository::EntityList, boost::hash<TypeRegionPair>> updatedBooks;
+        for (const auto &order : orders)
+        {
+            const auto key = std::make_pair(order.getTypeId(), order.getRegionId());
+            if (mOrderBooks.contains(key))
+                updatedBooks[key].emplace_back(std::make_shared<ExternalOrder>(order));
+        }
+
+        for (const auto &affected : affectedOrders)
+        {
+            const auto key = std::make_pair(affected.first, static_cast<uint>(affected.second));
+
+            // only the affected keys go stale; everything else stays cached
+            bumpOrderGeneration(key.first, key.second);
+
+            if (!mOrderBooks.contains(key))
+                continue;
 
-        mExternalOrderRepository.removeObsolete(affectedOrders);
-        mExternalOrderRepository.batchStore(toStore, true);
+            const auto generation = getExternalOrderGeneration(key.first, key.second);
+            auto book = std::make_shared<const OrderBookSnapshot>(OrderBookSnapshot{generation, ExternalOrderBook{updatedBooks[key]}});
+
+            mOrderBooks.insert(key, std::move(book), [=](const auto &existing) {
+                return existing->mGeneration < generation;
+            });
+        }
     }
 
     void CachingEveDataProvider::clearExternalOrders()
     {
-        clearExternalOrderCaches();
+        // clear the database first, so a concurrent reader cannot reload stale orders into the book
         mExternalOrderRepository.removeAll();
+
+        // bump first, so whatever a concurrent load publishes after the clear is already stale
+        mGlobalOrderGeneration.fetch_add(1, std::memory_order_release);
+
+        mOrderBooks.clear();
+        mBuyPriceTables.clear();
     }
 
     void CachingEveDataProvider::clearExternalOrdersForType(EveType::IdType id)
     {
-        clearExternalOrderCaches();
         mExternalOrderRepository.removeForType(id);
+
+        // regions of this type are not known here, so everything gets a global bump; stale snapshots are replaced on
+        // their next lookup or evicted
+        mGlobalOrderGeneration.fetch_add(1, std::memory_order_release);
     }
 
     QString CachingEveDataProvider::getLocationName(quint64 id) const
     {
-        const auto it = mLocationNameCache.find(id);
-        if (it != std::end(mLocationNameCache))
-            return it->second;
+        return mLocationNameCache.get(id, [&] {
+            // office ids map onto station ids
+            const auto station = mSnapshot.findStation((id >= 66000000 && id <= 66014933) ? (id - 6000001) : (id));
+            auto result = (station != nullptr) ? (mSnapshot.getString(station->mName)) : (QString{});
 
-        QString result;
-        if (id >= 66000000 && id <= 66014933)
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT stationName FROM staStations WHERE stationID = ?"));
-            query.bindValue(0, id - 6000001);
+            if (result.isEmpty())   // citadel?
+            {
+                result = getCitadelName(id);
+                if (result.isEmpty())   // still nothing? give some feedback
+                    result = tr("- unknown location -");
+            }
 
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                result = query.value(0).toString();
-        }
-        else if (id > 60000000 && id <= 61000000)
+            return result;
+        });
+    }
+
+    void CachingEveDataProvider::precacheLocations(const LocationList &ids) const
+    {
+        std::vector<quint64> missing;
+        for (const auto id : ids)
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT stationName FROM staStations WHERE stationID = ?"));
-            query.bindValue(0, id);
+            if (!mLocationNameCache.contains(id) || !mLocationSolarSystemCache.contains(id) || !mStationRegionCache.contains(id))
+                missing.emplace_back(id);
+        }
 
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                result = query.value(0).toString();
+        if (missing.empty())
+            return;
+
+        // SDE locations come from the snapshot, and citadels not cached yet are fetched here in chunked queries instead
+        // of one query per id
+        std::vector<Citadel::IdType> citadelIds;
+        {
+            std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
+            for (const auto id : missing)
+            {
+                const auto station = mSnapshot.findStation((id >= 66000000 && id <= 66014933) ? (id - 6000001) : (id));
+                if (station == nullptr && mCitadelCache.find(id) == std::end(mCitadelCache))
+                    citadelIds.emplace_back(id);
+            }
         }
-        else
+
+        if (!citadelIds.empty())
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT itemName FROM mapDenormalize WHERE itemID = ?"));
-            query.bindValue(0, id);
+            const auto citadels = mCitadelRepository.findMany(citadelIds);
 
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                result = query.value(0).toString();
+            std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
+
+            for (const auto &citadel : citadels)
+                mCitadelCache.emplace(citadel->getId(), citadel);
+
+            // remember unknown ones too, so they don't get queried again
+            for (const auto id : citadelIds)
+                mCitadelCache.emplace(id, std::make_shared<Citadel>(id));
         }
 
-        if (result.isEmpty())   // citadel?
+        for (const auto id : missing)
         {
-            result = getCitadelName(id);
-            if (result.isEmpty())   // still nothing? give some feedback
-                result = tr("- unknown location -");
+            getLocationName(id);
+            getStationSolarSystemId(id);
+            getStationRegionId(id);
         }
-
-        mLocationNameCache.emplace(id, result);
-        return result;
     }
 
     QString CachingEveDataProvider::getRegionName(uint id) const
     {
-        const auto it = mRegionNameCache.find(id);
-        if (it != std::end(mRegionNameCache))
-            return it->second;
-
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT regionName FROM mapRegions WHERE regionID = ?"));
-        query.bindValue(0, id);
-
-        DatabaseUtils::execQuery(query);
-        query.next();
-
-        return mRegionNameCache.emplace(id, query.value(0).toString()).first->second;
+        return mRegionNameCache.get(id, [&] {
+            const auto region = mSnapshot.findRegion(id);
+            return (region != nullptr) ? (mSnapshot.getString(region->mName)) : (QString{});
+        });
     }
 
     QString CachingEveDataProvider::getSolarSystemName(uint id) const
     {
-        const auto it = mSolarSystemNameCache.find(id);
-        if (it != std::end(mSolarSystemNameCache))
-            return it->second;
-
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT solarSystemName FROM mapSolarSystems WHERE solarSystemID = ?"));
-        query.bindValue(0, id);
-
-        DatabaseUtils::execQuery(query);
-        if (!query.next())
-            return mSolarSystemNameCache.emplace(id, QString{}).first->second;
-
-        return mSolarSystemNameCache.emplace(id, query.value(0).toString()).first->second;
+        return mSolarSystemNameCache.get(id, [&] {
+            const auto system = mSnapshot.findSolarSystem(id);
+            return (system != nullptr) ? (mSnapshot.getString(system->mName)) : (QString{});
+        });
     }
 
     const std::vector<EveDataProvider::MapLocation> &CachingEveDataProvider::getRegions() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (mRegionCache.empty())
         {
-            auto query = mConnectionProvider.getConnection().exec(QStringLiteral("SELECT regionID, regionName FROM mapRegions ORDER BY regionName"));
+            const auto regions = mSnapshot.getRegions();
+            const auto order = mSnapshot.getRegionNameOrder();
 
-            const auto size = query.size();
-            if (size > 0)
-                mRegionCache.reserve(size);
+            mRegionCache.reserve(order.size());
 
-            while (query.next())
-                mRegionCache.emplace_back(std::make_pair(query.value(0).toUInt(), query.value(1).toString()));
+            for (const auto index : order)
+                mRegionCache.emplace_back(std::make_pair(regions[index].mId, mSnapshot.getString(regions[index].mName)));
         }
 
         return mRegionCache;
@@ -440,22 +443,19 @@ namespace Evernus
 
     const std::vector<EveDataProvider::MapLocation> &CachingEveDataProvider::getConstellations(uint regionId) const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (mConstellationCache.find(regionId) == std::end(mConstellationCache))
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT constellationID, constellationName FROM mapConstellations WHERE regionID = ? ORDER BY constellationName"));
-            query.bindValue(0, regionId);
+            const auto constellations = mSnapshot.getConstellations();
+            auto &regionConstellations = mConstellationCache[regionId];
 
-            DatabaseUtils::execQuery(query);
-
-            auto &constellations = mConstellationCache[regionId];
-
-            const auto size = query.size();
-            if (size > 0)
-                constellations.reserve(size);
-
-            while (query.next())
-                constellations.emplace_back(std::make_pair(query.value(0).toUInt(), query.value(1).toString()));
+            for (const auto index : mSnapshot.getConstellationNameOrder())
+            {
+                const auto &constellation = constellations[index];
+                if (constellation.mRegionId == regionId)
+                    regionConstellations.emplace_back(std::make_pair(constellation.mId, mSnapshot.getString(constellation.mName)));
+            }
         }
 
         return mConstellationCache[regionId];
@@ -463,25 +463,20 @@ namespace Evernus
 
     const std::vector<EveDataProvider::MapTreeLocation> &CachingEveDataProvider::getConstellations() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (BOOST_UNLIKELY(mAllConstellationsCache.empty()))
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT constellationID, constellationName, regionID FROM mapConstellations ORDER BY constellationName"));
-
-            DatabaseUtils::execQuery(query);
+            const auto constellations = mSnapshot.getConstellations();
+            const auto order = mSnapshot.getConstellationNameOrder();
 
-            const auto size = query.size();
-            if (size > 0)
-                mAllConstellationsCache.reserve(size);
+            mAllConstellationsCache.reserve(order.size());
 
-            mConstellationCache.clear();
-
-            while (query.next())
+            // per region lists are left alone - references to them might have been handed out already
+            for (const auto index : order)
             {
-                MapTreeLocation location{query.value(2).toUInt(), query.value(0).toUInt(), query.value(1).toString()};
-
-                mAllConstellationsCache.emplace_back(location);
-                mConstellationCache[location.mParent].emplace_back(std::make_pair(location.mId, location.mName));
+                const auto &constellation = constellations[index];
+                mAllConstellationsCache.emplace_back(MapTreeLocation{constellation.mRegionId, constellation.mId, mSnapshot.getString(constellation.mName)});
             }
         }
 
@@ -490,22 +485,19 @@ namespace Evernus
 
     const std::vector<EveDataProvider::MapLocation> &CachingEveDataProvider::getSolarSystemsForConstellation(uint constellationId) const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (mConstellationSolarSystemCache.find(constellationId) == std::end(mConstellationSolarSystemCache))
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT solarSystemID, solarSystemName FROM mapSolarSystems WHERE constellationID = ? ORDER BY solarSystemName"));
-            query.bindValue(0, constellationId);
-
-            DatabaseUtils::execQuery(query);
-
+            const auto solarSystems = mSnapshot.getSolarSystems();
             auto &systems = mConstellationSolarSystemCache[constellationId];
 
-            const auto size = query.size();
-            if (size > 0)
-                systems.reserve(size);
-
-            while (query.next())
-                systems.emplace_back(std::make_pair(query.value(0).toUInt(), query.value(1).toString()));
+            for (const auto index : mSnapshot.getSolarSystemNameOrder())
+            {
+                const auto &system = solarSystems[index];
+                if (system.mConstellationId == constellationId)
+                    systems.emplace_back(std::make_pair(system.mId, mSnapshot.getString(system.mName)));
+            }
         }
 
         return mConstellationSolarSystemCache[constellationId];
@@ -513,22 +505,19 @@ namespace Evernus
 
     const std::vector<EveDataProvider::MapLocation> &CachingEveDataProvider::getSolarSystemsForRegion(uint regionId) const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (mRegionSolarSystemCache.find(regionId) == std::end(mRegionSolarSystemCache))
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT solarSystemID, solarSystemName FROM mapSolarSystems WHERE regionID = ? ORDER BY solarSystemName"));
-            query.bindValue(0, regionId);
-
-            DatabaseUtils::execQuery(query);
-
+            const auto solarSystems = mSnapshot.getSolarSystems();
             auto &systems = mRegionSolarSystemCache[regionId];
 
-            const auto size = query.size();
-            if (size > 0)
-                systems.reserve(size);
-
-            while (query.next())
-                systems.emplace_back(std::make_pair(query.value(0).toUInt(), query.value(1).toString()));
+            for (const auto index : mSnapshot.getSolarSystemNameOrder())
+            {
+                const auto &system = solarSystems[index];
+                if (system.mRegionId == regionId)
+                    systems.emplace_back(std::make_pair(system.mId, mSnapshot.getString(system.mName)));
+            }
         }
 
         return mRegionSolarSystemCache[regionId];
@@ -536,25 +525,19 @@ namespace Evernus
 
     const std::vector<EveDataProvider::MapTreeLocation> &CachingEveDataProvider::getSolarSystems() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (BOOST_UNLIKELY(mAllSolarSystemsCache.empty()))
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT solarSystemID, solarSystemName, constellationID FROM mapSolarSystems ORDER BY solarSystemName"));
-
-            DatabaseUtils::execQuery(query);
+            const auto solarSystems = mSnapshot.getSolarSystems();
+            const auto order = mSnapshot.getSolarSystemNameOrder();
 
-            const auto size = query.size();
-            if (size > 0)
-                mAllSolarSystemsCache.reserve(size);
+            mAllSolarSystemsCache.reserve(order.size());
 
-            mConstellationSolarSystemCache.clear();
-
-            while (query.next())
+            for (const auto index : order)
             {
-                MapTreeLocation location{query.value(2).toUInt(), query.value(0).toUInt(), query.value(1).toString()};
-
-                mAllSolarSystemsCache.emplace_back(location);
-                mConstellationSolarSystemCache[location.mParent].emplace_back(std::make_pair(location.mId, location.mName));
+                const auto &system = solarSystems[index];
+                mAllSolarSystemsCache.emplace_back(MapTreeLocation{system.mConstellationId, system.mId, mSnapshot.getString(system.mName)});
             }
         }
 
@@ -563,178 +546,86 @@ namespace Evernus
 
     const std::vector<EveDataProvider::Station> &CachingEveDataProvider::getStations(uint solarSystemId) const
     {
-        if (mStationCache.find(solarSystemId) == std::end(mStationCache))
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral(
-                "SELECT stationID id, stationName name FROM staStations WHERE solarSystemID = ? "
-                "UNION "
-                "SELECT itemID id, itemName name FROM mapDenormalize WHERE solarSystemID = ?"));
-            query.addBindValue(solarSystemId);
-            query.addBindValue(solarSystemId);
-
-            DatabaseUtils::execQuery(query);
+        // entries are immutable once cached, so the reference stays valid until the cache is cleared
+        return *mStationCache.get(solarSystemId, [&] {
+            const auto snapshotStations = mSnapshot.getStations();
+            const auto order = mSnapshot.getSolarSystemStations(solarSystemId);
 
-            auto &stations = mStationCache[solarSystemId];
+            auto stations = std::make_shared<std::vector<Station>>();
+            stations->reserve(order.size());
 
-            const auto size = query.size();
-            if (size > 0)
-                stations.reserve(size);
-
-            while (query.next())
-                stations.emplace_back(std::make_pair(query.value(0).toUInt(), query.value(1).toString()));
+            for (const auto index : order)
+                stations->emplace_back(std::make_pair(snapshotStations[index].mId, mSnapshot.getString(snapshotStations[index].mName)));
 
             const auto citadels = mCitadelRepository.fetchForSolarSystem(solarSystemId);
             for (const auto &citadel : citadels)
-                stations.emplace_back(std::make_pair(citadel->getId(), citadel->getName()));
+                stations->emplace_back(std::make_pair(citadel->getId(), citadel->getName()));
 
-            std::sort(std::begin(stations), std::end(stations), [](const auto &a, const auto &b) {
+            std::sort(std::begin(*stations), std::end(*stations), [](const auto &a, const auto &b) {
                 return a.second < b.second;
             });
-        }
 
-        return mStationCache[solarSystemId];
+            return std::shared_ptr<const std::vector<Station>>{std::move(stations)};
+        });
     }
 
     double CachingEveDataProvider::getSolarSystemSecurityStatus(uint solarSystemId) const
     {
-        const auto it = mSecurityStatuses.find(solarSystemId);
-        if (it != std::end(mSecurityStatuses))
-            return it->second;
-
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT security FROM mapSolarSystems WHERE solarSystemID = ?"));
-        query.bindValue(0, solarSystemId);
-
-        DatabaseUtils::execQuery(query);
-
-        if (!query.next())
-            return mSecurityStatuses.emplace(solarSystemId, 0.).first->second;
-
-        return mSecurityStatuses.emplace(solarSystemId, query.value(0).toDouble()).first->second;
+        const auto system = mSnapshot.findSolarSystem(solarSystemId);
+        return (system != nullptr) ? (system->mSecurity) : (0.);
     }
 
     uint CachingEveDataProvider::getSolarSystemConstellationId(uint solarSystemId) const
     {
-        const auto it = mSolarSystemConstellationCache.find(solarSystemId);
-        if (it != std::end(mSolarSystemConstellationCache))
-            return it->second;
-
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT constellationID FROM mapSolarSystems WHERE solarSystemID = ?"));
-        query.bindValue(0, solarSystemId);
-
-        DatabaseUtils::execQuery(query);
-        query.next();
-
-        const auto constellationId = query.value(0).toUInt();
-
-        mSolarSystemConstellationCache.emplace(solarSystemId, constellationId);
-        return constellationId;
+        const auto system = mSnapshot.findSolarSystem(solarSystemId);
+        return (system != nullptr) ? (system->mConstellationId) : (0u);
     }
 
     uint CachingEveDataProvider::getStationRegionId(quint64 stationId) const
     {
-        const auto it = mStationRegionCache.find(stationId);
-        if (it != std::end(mStationRegionCache))
-            return it->second;
-
-        uint result = 0;
-        if (stationId >= 66000000 && stationId <= 66014933)
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT regionID FROM staStations WHERE stationID = ?"));
-            query.bindValue(0, stationId - 6000001);
+        return mStationRegionCache.get(stationId, [&] {
+            const auto isOffice = stationId >= 66000000 && stationId <= 66014933;
 
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                result = query.value(0).toUInt();
-        }
-        else if ((stationId >= 66014934 && stationId <= 67999999) ||
-                 (stationId >= 60014861 && stationId <= 60014928) ||
-                 (stationId > 61000000))
-        {
-            const auto systemId = getStationSolarSystemId(stationId);
-            if (systemId != 0)
-                result = getSolarSystemRegionId(systemId);
-        }
-        else if (stationId > 60000000 && stationId <= 61000000)
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT regionID FROM staStations WHERE stationID = ?"));
-            query.bindValue(0, stationId);
-
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                result = query.value(0).toUInt();
-        }
-        else
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT regionID FROM mapDenormalize WHERE itemID = ?"));
-            query.bindValue(0, stationId);
-
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                result = query.value(0).toUInt();
-        }
+            uint result = 0;
+            if (!isOffice && ((stationId >= 60014861 && stationId <= 60014928) || stationId > 61000000))
+            {
+                const auto systemId = getStationSolarSystemId(stationId);
+                if (systemId != 0)
+                    result = getSolarSystemRegionId(systemId);
+            }
+            else
+            {
+                // office ids map onto station ids
+                const auto station = mSnapshot.findStation((isOffice) ? (stationId - 6000001) : (stationId));
+                if (station != nullptr)
+                    result = station->mRegionId;
+            }
 
-        if (result == 0)   // citadel?
-            result = getCitadelRegionId(stationId);
+            if (result == 0)   // citadel?
+                result = getCitadelRegionId(stationId);
 
-        mStationRegionCache.emplace(stationId, result);
-        return result;
+            return result;
+        });
     }
 
     uint CachingEveDataProvider::getStationSolarSystemId(quint64 stationId) const
     {
-        std::lock_guard<std::mutex> lock{mLocationSolarSystemCacheMutex};
-
-        const auto it = mLocationSolarSystemCache.find(stationId);
-        if (it != std::end(mLocationSolarSystemCache))
-            return it->second;
+        return mLocationSolarSystemCache.get(stationId, [&] {
+            // office ids map onto station ids
+            const auto station = mSnapshot.findStation((stationId >= 66000000 && stationId <= 66014933) ? (stationId - 6000001) : (stationId));
+            auto systemId = (station != nullptr) ? (station->mSolarSystemId) : (0u);
 
-        uint systemId = 0;
-        if (stationId >= 66000000 && stationId <= 66014933)
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT solarSystemID FROM staStations WHERE stationID = ?"));
-            query.bindValue(0, stationId - 6000001);
-
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                systemId = query.value(0).toUInt();
-        }
-        else if (stationId > 60000000 && stationId <= 61000000)
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT solarSystemID FROM staStations WHERE stationID = ?"));
-            query.bindValue(0, stationId);
-
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                systemId = query.value(0).toUInt();
-        }
-        else
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT solarSystemID FROM mapDenormalize WHERE itemID = ?"));
-            query.bindValue(0, stationId);
+            if (systemId == 0)  // citadel?
+                systemId = getCitadelSolarSystemId(stationId);
 
-            DatabaseUtils::execQuery(query);
-            if (query.next())
-                systemId = query.value(0).toUInt();
-        }
-
-        if (systemId == 0)  // citadel?
-            systemId = getCitadelSolarSystemId(stationId);
-
-        mLocationSolarSystemCache.emplace(stationId, systemId);
-        return systemId;
+            return systemId;
+        });
     }
 
     const CitadelRepository::EntityList CachingEveDataProvider::getCitadelsForRegion(uint regionId) const
     {
+        std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
+
         const auto citadels = mRegionCitadelCache.find(regionId);
         if (citadels != std::end(mRegionCitadelCache))
             return citadels->second;
@@ -744,6 +635,8 @@ namespace Evernus
 
     const CitadelRepository::EntityList &CachingEveDataProvider::getCitadels() const
     {
+        std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
+
         if (BOOST_UNLIKELY(mAllCitadelsCache.empty()))
         {
             mAllCitadelsCache = mCitadelRepository.fetchAll();
@@ -759,93 +652,69 @@ namespace Evernus
 
     const CachingEveDataProvider::ReprocessingMap &CachingEveDataProvider::getOreReprocessingInfo() const
     {
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
+
         if (mOreReprocessingInfo.empty())
         {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral(R"(
-SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM invTypeMaterials m INNER JOIN (
-    SELECT typeID, portionSize, groupID FROM invTypes WHERE groupID IN (
-        SELECT groupID FROM invGroups WHERE groupName IN ('%1')
-    ) AND marketGroupID IS NOT NULL
-) t ON t.typeID = m.typeID
-            )").arg(oreGroupNames.join(QStringLiteral("', '"))));
-
-            DatabaseUtils::execQuery(query);
+            std::unordered_set<uint> oreGroupIds;
+            for (const auto &name : oreGroupNames)
+                oreGroupIds.emplace(getGroupId(name));
 
-            while (query.next())
+            for (const auto &material : mSnapshot.getReprocessingMaterials())
             {
-                auto &info = mOreReprocessingInfo[query.value(0).value<EveType::IdType>()];
-                info.mPortionSize = query.value(3).toUInt();
-                info.mGroupId = query.value(4).toUInt();
-                info.mMaterials.emplace_back(MaterialInfo{
-                    query.value(1).value<EveType::IdType>(),
-                    query.value(2).toUInt()
-                });
+                if (oreGroupIds.find(material.mGroupId) == std::end(oreGroupIds))
+                    continue;
+
+                auto &info = mOreReprocessingInfo[material.mTypeId];
+                info.mPortionSize = material.mPortionSize;
+                info.mGroupId = material.mGroupId;
+                info.mMaterials.emplace_back(MaterialInfo{material.mMaterialTypeId, material.mQuantity});
             }
         }
 
         return mOreReprocessingInfo;
     }
 
-    const CachingEveDataProvider::ReprocessingMap &CachingEveDataProvider::getTypeReprocessingInfo(const TypeList &requestedTypes) const
+    CachingEveDataProvider::ReprocessingMap CachingEveDataProvider::getTypeReprocessingInfo(const TypeList &requestedTypes) const
     {
-        auto reducedTypes = requestedTypes;
-        for (const auto &info : mTypeReprocessingInfo)
-            reducedTypes.erase(info.first);
+        ReprocessingMap result;
 
-        if (!reducedTypes.empty())
-        {
-            QStringList typeNames;
-            reducedTypes.reserve(reducedTypes.size());
+        std::lock_guard<std::mutex> lock{mStaticDataCacheMutex};
 
-            for (const auto id : reducedTypes)
-                typeNames << QString::number(id);
+        for (const auto id : requestedTypes)
+        {
+            auto info = mTypeReprocessingInfo.find(id);
+            if (info == std::end(mTypeReprocessingInfo))
+            {
+                const auto materials = mSnapshot.getReprocessingMaterials(id);
+                if (materials.empty())
+                    continue;
 
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral(R"(
-SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM invTypeMaterials m INNER JOIN (
-    SELECT typeID, portionSize, groupID FROM invTypes WHERE typeID IN (%1) AND marketGroupID IS NOT NULL
-) t ON t.typeID = m.typeID
-            )").arg(typeNames.join(", ")));
+                info = mTypeReprocessingInfo.emplace(id, ReprocessingInfo{}).first;
+                info->second.mPortionSize = materials[0].mPortionSize;
+                info->second.mGroupId = materials[0].mGroupId;
 
-            DatabaseUtils::execQuery(query);
-
-            while (query.next())
-            {
-                auto &info = mTypeReprocessingInfo[query.value(0).value<EveType::IdType>()];
-                info.mPortionSize = query.value(3).toUInt();
-                info.mGroupId = query.value(4).toUInt();
-                info.mMaterials.emplace_back(MaterialInfo{
-                    query.value(1).value<EveType::IdType>(),
-                    query.value(2).toUInt()
-                });
+                for (const auto &material : materials)
+                    info->second.mMaterials.emplace_back(MaterialInfo{material.mMaterialTypeId, material.mQuantity});
             }
+
+            result.emplace(*info);
         }
 
-        return mTypeReprocessingInfo;
+        return result;
     }
 
     uint CachingEveDataProvider::getGroupId(const QString &name) const
     {
-        if (mGroupIdCache.contains(name))
-            return mGroupIdCache[name];
-
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT groupID FROM invGroups WHERE groupName = ?"));
-        query.addBindValue(name);
-
-        DatabaseUtils::execQuery(query);
-
-        if (query.next())
-        {
-            const auto id = query.value(0).toUInt();
+        return mGroupIdCache.get(name, [&] {
+            QSqlQuery query{mConnectionProvider.getConnection()};
+            query.prepare(QStringLiteral("SELECT groupID FROM invGroups WHERE groupName = ?"));
+            query.addBindValue(name);
 
-            mGroupIdCache[name] = id;
-            return id;
-        }
+            DatabaseUtils::execQuery(query);
 
-        mGroupIdCache[name] = 0;
-        return 0;
+            return (query.next()) ? (query.value(0).toUInt()) : (0u);
+        });
     }
 
     void CachingEveDataProvider::precacheNames()
@@ -862,29 +731,34 @@ SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM inv
             mDataManagerProvider.getESIManager().fetchAncestries(getFillNameMapCallback(mAncestryNameCache));
     }
 
+    void CachingEveDataProvider::precacheSnapshot()
+    {
+        QSettings settings;
+        mSnapshot.load(mConnectionProvider.getConnection(), settings.value(UpdaterSettings::sdeVersionKey).toString());
+    }
+
+    void CachingEveDataProvider::precacheTypeMetadata()
+    {
+        mTypeMetadata.load(mConnectionProvider.getConnection(), mSnapshot);
+    }
+
     void CachingEveDataProvider::precacheJumpMap()
     {
-        auto query = mConnectionProvider.getConnection().exec(QStringLiteral("SELECT fromRegionID, fromSolarSystemID, toSolarSystemID FROM mapSolarSystemJumps WHERE fromRegionID = toRegionID"));
-        while (query.next())
-            mSystemJumpMap[query.value(0).toUInt()].emplace(query.value(1).toUInt(), query.value(2).toUInt());
+        SystemDistanceTable::JumpMap jumpMap;
+        for (const auto &jump : mSnapshot.getJumps())
+            jumpMap[jump.mRegionId].emplace(jump.mFromSolarSystemId, jump.mToSolarSystemId);
 
         const auto dataCacheDir = getCacheDir();
+        dataCacheDir.mkpath(QStringLiteral("."));
 
-        QFile distanceCache{dataCacheDir.filePath(systemDistanceCacheFileName)};
-        if (distanceCache.open(QIODevice::ReadOnly))
-        {
-            QDataStream cacheStream{&distanceCache};
-            cacheStream >> mSystemDistances;
-        }
+        mSystemDistances.load(dataCacheDir.filePath(systemDistanceCacheFileName), jumpMap);
     }
 
     void CachingEveDataProvider::clearExternalOrderCaches()
     {
-        std::lock_guard<std::recursive_mutex> lock{mExternalOrderCacheMutex};
-
-        mStationSellPrices.clear();
-        mBuyPrices.clear();
-        mTypeRegionOrderCache.clear();
+        // order books only hold external data; own orders are filtered at lookup time, which affects every key
+        mGlobalOrderGeneration.fetch_add(1, std::memory_order_release);
+        std::atomic_store(&mOwnActiveOrderIds, std::shared_ptr<const OwnOrderIdsSnapshot>{});
     }
 
     void CachingEveDataProvider::clearStationCache()
@@ -892,8 +766,31 @@ SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM inv
         mStationCache.clear();
     }
 
+    CacheStatistics CachingEveDataProvider::getCacheStatistics() const
+    {
+        CacheStatistics result;
+
+        const auto addCache = [&](const QString &name, const auto &cache) {
+            result.emplace_back(CacheStatisticsEntry{name, cache.getStats()});
+        };
+
+        addCache(QStringLiteral("location names"), mLocationNameCache);
+        addCache(QStringLiteral("region names"), mRegionNameCache);
+        addCache(QStringLiteral("solar system names"), mSolarSystemNameCache);
+        addCache(QStringLiteral("location solar systems"), mLocationSolarSystemCache);
+        addCache(QStringLiteral("station regions"), mStationRegionCache);
+        addCache(QStringLiteral("stations"), mStationCache);
+        addCache(QStringLiteral("group ids"), mGroupIdCache);
+        addCache(QStringLiteral("external order books"), mOrderBooks);
+        addCache(QStringLiteral("buy price tables"), mBuyPriceTables);
+
+        return result;
+    }
+
     void CachingEveDataProvider::clearCitadelCache()
     {
+        std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
+
         mCitadelCache.clear();
         mRegionCitadelCache.clear();
         mAllCitadelsCache.clear();
@@ -902,216 +799,212 @@ SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM inv
     void CachingEveDataProvider::handleNewPreferences()
     {
         QSettings settings;
-
-        std::lock_guard<std::mutex> lock{mTypeCacheMutex};
         mUsePackagedVolume = settings.value(UISettings::usePackagedVolumeKey, UISettings::usePackagedVolumeDefault).toBool();
+
+        const auto megabyte = 1024ull * 1024ull;
+
+        mLocationNameCache.setBudget(settings.value(CacheSettings::locationNameBudgetKey, CacheSettings::locationNameBudgetDefault).toULongLong() * megabyte);
+
+        // buy price tables are derived from the books, so they get a quarter of the external order budget
+        const auto externalOrderBudget = settings.value(CacheSettings::externalOrderBudgetKey, CacheSettings::externalOrderBudgetDefault).toULongLong() * megabyte;
+
+        mOrderBooks.setBudget(externalOrderBudget - externalOrderBudget / 4);
+        mBuyPriceTables.setBudget(externalOrderBudget / 4);
     }
 
     std::shared_ptr<ExternalOrder> CachingEveDataProvider::getTypeSellPrice(EveType::IdType id, quint64 stationId, bool dontThrow) const
     {
-        std::lock_guard<std::recursive_mutex> lock{mExternalOrderCacheMutex};
-
-        const auto key = std::make_pair(id, stationId);
-        const auto it = mStationSellPrices.find(key);
-        if (it != std::end(mStationSellPrices))
-            return it->second;
+        const auto solarSystemId = getStationSolarSystemId(stationId);
+        const auto regionId = (solarSystemId == 0) ? (0u) : (getSolarSystemRegionId(solarSystemId));
 
         std::shared_ptr<ExternalOrder> result;
 
-        try
-        {
-            result = mExternalOrderRepository.findSellByTypeAndStation(id, stationId, mMarketOrderRepository, mCorpMarketOrderRepository);
-        }
-        catch (const ExternalOrderRepository::NotFoundException &)
+        if (regionId == 0)
         {
-            if (!dontThrow)
-                throw;
-
-            result = std::make_shared<ExternalOrder>();
-        }
+            // unknown location - no book to look in
+            try
+            {
+                result = mExternalOrderRepository.findSellByTypeAndStation(id, stationId, mMarketOrderRepository, mCorpMarketOrderRepository);
+            }
+            catch (const ExternalOrderRepository::NotFoundException &)
+            {
+                if (!dontThrow)
+                    throw;
 
-        mStationSellPrices.emplace(key, result);
-        return result;
-    }
+                result = std::make_shared<ExternalOrder>();
+            }
 
-    void CachingEveDataProvider::fetchGenericName(quint64 id)
-    {
-        qDebug() << "Fetching generic name:" << id;
+            return result;
+        }
 
-        // potential recursive lock if sync invokation
-        std::lock_guard<std::recursive_mutex> lock{mGenericNameCacheMutex};
+        const auto book = getOrderBook(id, regionId);
 
-        mPendingNameRequests.emplace(id);
+        result = book->mBook.getBestStationOrder(ExternalOrder::Type::Sell, stationId, getOwnActiveOrderIds()->mIds);
+        if (result)
+            return result;
 
-        mDataManagerProvider.getESIManager().fetchGenericName(id, [=](auto &&data, const auto &error) {
-            qDebug() << "Got generic name:" << id << data << " (" << error << ")";
+        if (!dontThrow)
+            BOOST_THROW_EXCEPTION(ExternalOrderRepository::NotFoundException{});
 
-            std::lock_guard<std::recursive_mutex> lock{mGenericNameCacheMutex};
+        return std::make_shared<ExternalOrder>();
+    }
 
-            mPendingNameRequests.erase(id);
+    void CachingEveDataProvider::fetchGenericName(quint64 id)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mGenericNameCacheMutex};
+            mPendingNameRequests.emplace(id);
+        }
 
-            if (error.isEmpty())
-                mGenericNameCache[id] = std::move(data);
-            else
-                mGenericNameCache[id] = tr("(unknown)");
+        mQueuedNameRequests.emplace_back(id);
 
-            if (mPendingNameRequests.empty())
-                emit namesChanged();
-        });
+        if (!mGenericNameBatchTimer.isActive())
+            mGenericNameBatchTimer.start();
     }
 
-    EveTypeRepository::EntityPtr CachingEveDataProvider::getEveType(EveType::IdType id) const
+    void CachingEveDataProvider::fetchQueuedGenericNames()
     {
-        const auto it = mTypeCache.find(id);
-        if (it != std::end(mTypeCache))
-            return it->second;
+        std::vector<quint64> ids;
+        ids.swap(mQueuedNameRequests);
 
-        EveTypeRepository::EntityPtr type;
+        std::sort(std::begin(ids), std::end(ids));
+        ids.erase(std::unique(std::begin(ids), std::end(ids)), std::end(ids));
 
-        try
-        {
-            type = mEveTypeRepository.find(id);
-        }
-        catch (const EveTypeRepository::NotFoundException &)
+        qDebug() << "Fetching generic names:" << ids.size();
+
+        for (std::size_t begin = 0; begin < ids.size(); begin += genericNameBatchSize)
         {
-            type = std::make_shared<EveType>();
+            fetchGenericNames(std::vector<quint64>(std::begin(ids) + begin,
+                                                   std::begin(ids) + std::min(begin + genericNameBatchSize, ids.size())));
         }
-
-        return mTypeCache.emplace(id, type).first->second;
     }
 
-    MarketGroupRepository::EntityPtr CachingEveDataProvider::getMarketGroupParent(MarketGroup::IdType id) const
+    void CachingEveDataProvider::fetchGenericNames(std::vector<quint64> ids)
     {
-        const auto it = mTypeMarketGroupParentCache.find(id);
-        if (it != std::end(mTypeMarketGroupParentCache))
-            return it->second;
+        mDataManagerProvider.getESIManager().fetchGenericNames(ids, [=](auto &&data, const auto &error, auto invalidIds) {
+            if (!error.isEmpty())
+            {
+                // a single unresolvable id fails the whole request, so split until it's isolated
+                // other errors would fail each half the same way, so they are reported for the whole batch
+                if (invalidIds && ids.size() > 1)
+                {
+                    const auto middle = std::begin(ids) + ids.size() / 2;
 
-        MarketGroupRepository::EntityPtr result;
+                    fetchGenericNames(std::vector<quint64>(std::begin(ids), middle));
+                    fetchGenericNames(std::vector<quint64>(middle, std::end(ids)));
+                    return;
+                }
 
-        try
-        {
-            result = mMarketGroupRepository.findParent(id);
-        }
-        catch (const MarketGroupRepository::NotFoundException &)
-        {
-            result = std::make_shared<MarketGroup>();
-        }
+                qWarning() << "Error fetching generic names:" << ids.size() << error;
+            }
 
-        return mTypeMarketGroupParentCache.emplace(id, result).first->second;
+            storeGenericNames(ids, data);
+        });
     }
 
-    MarketGroupRepository::EntityPtr CachingEveDataProvider::getMarketGroup(MarketGroup::IdType id) const
+    void CachingEveDataProvider::storeGenericNames(const std::vector<quint64> &ids, const std::unordered_map<quint64, QString> &names)
     {
-        const auto it = mTypeMarketGroupCache.find(id);
-        if (it != std::end(mTypeMarketGroupCache))
-            return it->second;
+        qDebug() << "Got generic names:" << names.size() << "of" << ids.size();
 
-        MarketGroupRepository::EntityPtr result;
+        NameMap newNames;
+        bool allDone = false;
 
-        try
-        {
-            result = mMarketGroupRepository.find(id);
-        }
-        catch (const MarketGroupRepository::NotFoundException &)
         {
-            result = std::make_shared<MarketGroup>();
-        }
-
-        return mTypeMarketGroupCache.emplace(id, result).first->second;
-    }
+            std::lock_guard<std::mutex> lock{mGenericNameCacheMutex};
 
-    uint CachingEveDataProvider::getSolarSystemRegionId(uint systemId) const
-    {
-        std::lock_guard<std::mutex> lock{mSolarSystemRegionCacheMutex};
+            for (const auto id : ids)
+            {
+                mPendingNameRequests.erase(id);
 
-        const auto it = mSolarSystemRegionCache.find(systemId);
-        if (it != std::end(mSolarSystemRegionCache))
-            return it->second;
+                const auto name = names.find(id);
+                if (name != std::end(names))
+                {
+                    mGenericNameCache[id] = name->second;
+                    newNames[id] = name->second;
+                }
+                else
+                {
+                    mGenericNameCache[id] = tr("(unknown)");
+                }
+            }
 
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT regionID FROM mapSolarSystems WHERE solarSystemID = ?"));
-        query.bindValue(0, systemId);
+            allDone = mPendingNameRequests.empty();
+        }
 
-        DatabaseUtils::execQuery(query);
-        query.next();
+        appendGenericNameLog(newNames);
 
-        const auto regionId = query.value(0).toUInt();
+        if (allDone)
+            emit namesChanged();
+    }
 
-        mSolarSystemRegionCache.emplace(systemId, regionId);
-        return regionId;
+    uint CachingEveDataProvider::getSolarSystemRegionId(uint systemId) const
+    {
+        const auto system = mSnapshot.findSolarSystem(systemId);
+        return (system != nullptr) ? (system->mRegionId) : (0u);
     }
 
-    const ExternalOrderRepository::EntityList &CachingEveDataProvider::getExternalOrders(EveType::IdType typeId, uint regionId) const
+    void CachingEveDataProvider::bumpOrderGeneration(EveType::IdType typeId, uint regionId) noexcept
     {
-        std::lock_guard<std::recursive_mutex> lock{mExternalOrderCacheMutex};
+        const auto slot = boost::hash<TypeRegionPair>{}(std::make_pair(typeId, regionId)) % orderGenerationSlots;
+        mOrderGenerations[slot].fetch_add(1, std::memory_order_release);
+    }
 
+    std::shared_ptr<const CachingEveDataProvider::OrderBookSnapshot> CachingEveDataProvider::getOrderBook(EveType::IdType typeId, uint regionId) const
+    {
         const auto key = std::make_pair(typeId, regionId);
-        const auto it = mTypeRegionOrderCache.find(key);
-        if (it != std::end(mTypeRegionOrderCache))
-            return it->second;
 
-        return mTypeRegionOrderCache.emplace(
-            key, mExternalOrderRepository.findBuyByTypeAndRegion(typeId, regionId, mMarketOrderRepository, mCorpMarketOrderRepository))
-                .first->second;
-    }
+        // read before loading, so an update racing with the load leaves a book tagged as stale behind
+        const auto generation = getExternalOrderGeneration(typeId, regionId);
 
-    uint CachingEveDataProvider::getDistance(uint startSystem, uint endSystem) const
-    {
-        const auto key = qMakePair(startSystem, endSystem);
-        const auto it = mSystemDistances.find(key);
-        if (it != std::end(mSystemDistances))
-            return it.value();
+        const auto cached = mOrderBooks.find(key);
+        if (cached && (*cached)->mGeneration >= generation)
+            return *cached;
 
-        const auto makeUnreachable = [=] {
-            const auto value = std::numeric_limits<uint>::max();
-            mSystemDistances[key] = value;
-            mSystemDistances[qMakePair(endSystem, startSystem)] = value;
+        auto orders = mExternalOrderRepository.fetchBuyByTypeAndRegion(typeId, regionId);
+        auto sellOrders = mExternalOrderRepository.fetchSellByTypeAndRegion(typeId, regionId);
 
-            return value;
-        };
+        orders.insert(std::end(orders), std::make_move_iterator(std::begin(sellOrders)), std::make_move_iterator(std::end(sellOrders)));
 
-        const auto regionId = getSolarSystemRegionId(startSystem);
-        if (regionId == 0)
-            return makeUnreachable();
+        const auto book = std::make_shared<const OrderBookSnapshot>(OrderBookSnapshot{generation, ExternalOrderBook{orders}});
 
-        const auto jIt = mSystemJumpMap.find(regionId);
-        if (jIt == std::end(mSystemJumpMap))
-            return makeUnreachable();
+        if (getExternalOrderGeneration(typeId, regionId) == generation)
+        {
+            mOrderBooks.insert(key, book, [=](const auto &existing) {
+                return existing->mGeneration < generation;
+            });
+        }
 
-        const auto &jumpMap = jIt->second;
+        return book;
+    }
 
-        std::unordered_set<uint> visited;
-        std::queue<std::pair<uint, uint>> candidates;
+    std::shared_ptr<const CachingEveDataProvider::OwnOrderIdsSnapshot> CachingEveDataProvider::getOwnActiveOrderIds() const
+    {
+        const auto generation = mGlobalOrderGeneration.load(std::memory_order_acquire);
 
-        visited.emplace(startSystem);
-        candidates.emplace(std::make_pair(startSystem, 0u));
+        auto current = std::atomic_load(&mOwnActiveOrderIds);
+        if (current && current->mGeneration >= generation)
+            return current;
 
-        while (!candidates.empty())
-        {
-            const auto current = candidates.front();
-            candidates.pop();
+        auto ids = mMarketOrderRepository.fetchActiveIds();
 
-            const auto depth = current.second;
-            if (current.first == endSystem)
-            {
-                mSystemDistances[key] = depth;
-                mSystemDistances[qMakePair(endSystem, startSystem)] = depth;
+        const auto corpIds = mCorpMarketOrderRepository.fetchActiveIds();
+        ids.insert(std::begin(corpIds), std::end(corpIds));
 
-                return depth;
-            }
+        const auto loaded = std::make_shared<const OwnOrderIdsSnapshot>(OwnOrderIdsSnapshot{generation, std::move(ids)});
 
-            const auto children = jumpMap.equal_range(current.first);
-            for (auto it = children.first; it != children.second; ++it)
-            {
-                if (visited.find(it->second) == std::end(visited))
-                {
-                    visited.emplace(it->second);
-                    candidates.emplace(std::make_pair(it->second, depth + 1));
-                }
-            }
+        // publish over older sets only
+        while (!current || current->mGeneration < generation)
+        {
+            if (std::atomic_compare_exchange_weak(&mOwnActiveOrderIds, &current, loaded))
+                break;
         }
 
-        return makeUnreachable();
+        return loaded;
+    }
+
+    uint CachingEveDataProvider::getDistance(uint startSystem, uint endSystem) const
+    {
+        return mSystemDistances.getDistance(startSystem, endSystem);
     }
 
     QString CachingEveDataProvider::getRaceName(uint raceId) const
@@ -1131,122 +1024,62 @@ SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM inv
 
     const CachingEveDataProvider::ManufacturingInfo &CachingEveDataProvider::getTypeManufacturingInfo(EveType::IdType typeId) const
     {
-        auto it = mTypeManufacturingInfoCache.find(typeId);
-        if (it == std::end(mTypeManufacturingInfoCache))
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral(R"(
-SELECT m.materialTypeID, m.quantity, p.quantity, a.time, s.skillID FROM industryActivityMaterials m
-    INNER JOIN industryActivityProducts p
-        ON m.typeID = p.typeID AND m.activityID = p.activityID AND p.productTypeID = ? AND p.activityID = ?
-    INNER JOIN industryActivity a
-        ON a.typeID = p.typeID AND a.activityID = m.activityID
-    INNER JOIN industryActivitySkills s
-        ON s.typeID = p.typeID AND s.activityID = m.activityID
-            )"));
-            query.addBindValue(typeId);
-            query.addBindValue(mManufacturingActivityId);
-
-            ManufacturingInfo info{0};
-
-            DatabaseUtils::execQuery(query);
-
-            std::unordered_set<EveType::IdType> usedMaterials;
-
-            while (query.next())
-            {
-                const auto skillId = query.value(4).toUInt();
-                if (skillId != industrySkillId && skillId != advancedIndustrySkillId)
-                    info.mAdditionalsSkills.insert(skillId);
-
-                const auto materialId = query.value(0).value<EveType::IdType>();
-                if (usedMaterials.find(materialId) != std::end(usedMaterials))
-                    continue;
-
-                if (info.mQuantity == 0)
-                {
-                    info.mQuantity = query.value(2).toUInt();
-                    info.mTime = std::chrono::seconds{query.value(3).toUInt()};
-                }
-
-                usedMaterials.emplace(materialId);
-                info.mMaterials.emplace_back(MaterialInfo{materialId, query.value(1).toUInt()});
-            }
-
-            it = mTypeManufacturingInfoCache.emplace(typeId, std::move(info)).first;
-        }
-
-        return it->second;
+        return mTypeMetadata.getManufacturingInfo(mTypeMetadata.getOrdinal(typeId));
     }
 
     EveType::IdType CachingEveDataProvider::getBlueprintOutputType(EveType::IdType blueprintId) const
     {
-        auto type = mBlueprintOutputCache.find(blueprintId);
-        if (type == std::end(mBlueprintOutputCache))
-        {
-            QSqlQuery query{mConnectionProvider.getConnection()};
-            query.prepare(QStringLiteral("SELECT productTypeID FROM industryActivityProducts WHERE typeID = ? AND activityID = ?"));
-            query.addBindValue(blueprintId);
-            query.addBindValue(mManufacturingActivityId);
-
-            DatabaseUtils::execQuery(query);
-
-            if (query.next())
-                type = mBlueprintOutputCache.emplace(blueprintId, query.value(0).value<EveType::IdType>()).first;
-            else
-                type = mBlueprintOutputCache.emplace(blueprintId, EveType::invalidId).first;
-        }
-
-        return type->second;
+        return mTypeMetadata.getBlueprintOutputType(mTypeMetadata.getOrdinal(blueprintId));
     }
 
     QString CachingEveDataProvider::getCitadelName(Citadel::IdType id) const
     {
-        return getCitadel(id).getName();
+        return getCitadel(id)->getName();
     }
 
     uint CachingEveDataProvider::getCitadelRegionId(Citadel::IdType id) const
     {
-        return getCitadel(id).getRegionId();
+        return getCitadel(id)->getRegionId();
     }
 
     uint CachingEveDataProvider::getCitadelSolarSystemId(Citadel::IdType id) const
     {
-        return getCitadel(id).getSolarSystemId();
+        return getCitadel(id)->getSolarSystemId();
     }
 
-    const Citadel &CachingEveDataProvider::getCitadel(Citadel::IdType id) const
+    CitadelRepository::EntityPtr CachingEveDataProvider::getCitadel(Citadel::IdType id) const
     {
-        auto citadel = mCitadelCache.find(id);
-        if (citadel == std::end(mCitadelCache))
         {
-            if (mCitadelCache.empty())
-            {
-                auto citadels = mCitadelRepository.fetchAll();
+            std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
 
-                mCitadelCache.reserve(citadels.size());
-                for (auto &citadel : citadels)
-                    mCitadelCache.emplace(citadel->getId(), std::move(citadel));
+            const auto citadel = mCitadelCache.find(id);
+            if (citadel != std::end(mCitadelCache))
+                return citadel->second;
+        }
 
-                citadel = mCitadelCache.find(id);
-                if (citadel == std::end(mCitadelCache))
-                    citadel = mCitadelCache.emplace(id, std::make_shared<Citadel>(id)).first;
-            }
-            else
-            {
-                citadel = mCitadelCache.emplace(id, std::make_shared<Citadel>(id)).first;
-            }
+        // models batch their ids through precacheLocations(), so this is only hit by stragglers
+        CitadelRepository::EntityPtr loaded;
+        try
+        {
+            loaded = mCitadelRepository.find(id);
         }
+        catch (const CitadelRepository::NotFoundException &)
+        {
+            loaded = std::make_shared<Citadel>(id);
+        }
+
+        std::lock_guard<std::mutex> lock{mCitadelCacheMutex};
+
+        const auto citadel = mCitadelCache.emplace(id, std::move(loaded)).first;
 
         Q_ASSERT(citadel->second);
-        return *citadel->second;
+        return citadel->second;
     }
 
-    double CachingEveDataProvider::getPackagedVolume(const EveType &type)
+    double CachingEveDataProvider::getPackagedVolume(uint groupId, double volume)
     {
         // https://bitbucket.org/krojew/evernus/issue/30/utilize-packaged-size-for-total-size
         // thank you CCP for this cool and unexpected feature!
-        const auto groupId = type.getGroupId();
         switch (groupId) {
         case 29:
         case 1022:
@@ -1323,28 +1156,74 @@ SELECT m.materialTypeID, m.quantity, p.quantity, a.time, s.skillID FROM industry
         case 1199:
         case 1697:
         case 1698:
-            if (type.getVolume() > 1000.)
+            if (volume > 1000.)
                 return 1000.;
             break;
         case 60:
-            if (type.getVolume() > 2000.)
+            if (volume > 2000.)
                 return 2000.;
         }
 
-        return type.getVolume();
+        return volume;
     }
 
-    void CachingEveDataProvider::findManufaturingActivity()
+    void CachingEveDataProvider::readGenericNameCache()
     {
-        QSqlQuery query{mConnectionProvider.getConnection()};
-        query.prepare(QStringLiteral("SELECT activityID FROM ramActivities WHERE activityName = ?"));
-        query.bindValue(0, QStringLiteral("Manufacturing"));
+        readCache(nameCacheFileName, mGenericNameCache);
 
-        DatabaseUtils::execQuery(query);
-        if (query.next())
-            mManufacturingActivityId = query.value(0).toUInt();
-        else
-            qWarning() << "Manufacturing activity id not found - assuming:" << mManufacturingActivityId;
+        QFile logFile{getCacheDir().filePath(nameLogFileName)};
+        if (!logFile.open(QIODevice::ReadOnly))
+            return;
+
+        QDataStream logStream{&logFile};
+        auto records = 0;
+
+        while (!logStream.atEnd())
+        {
+            quint64 id = 0;
+            QString name;
+
+            logStream >> id >> name;
+            if (logStream.status() != QDataStream::Ok)
+            {
+                qWarning() << "Truncated generic name log after" << records << "records.";
+                break;
+            }
+
+            mGenericNameCache[id] = std::move(name);
+            ++records;
+        }
+
+        logFile.close();
+
+        if (records >= genericNameLogCompactionThreshold)
+        {
+            qDebug() << "Compacting generic name log:" << records;
+
+            cacheWrite(nameCacheFileName, mGenericNameCache);
+            logFile.remove();
+        }
+    }
+
+    void CachingEveDataProvider::appendGenericNameLog(const NameMap &names) const
+    {
+        if (names.isEmpty())
+            return;
+
+        const auto dataCacheDir = getCacheDir();
+        if (!dataCacheDir.mkpath(QStringLiteral(".")))
+            return;
+
+        QFile logFile{dataCacheDir.filePath(nameLogFileName)};
+        if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append))
+        {
+            qWarning() << "Cannot open generic name log:" << logFile.errorString();
+            return;
+        }
+
+        QDataStream logStream{&logFile};
+        for (auto name = std::begin(names); name != std::end(names); ++name)
+            logStream << name.key() << name.value();
     }
 
     void CachingEveDataProvider::readCache(const QString &cacheFileName, NameMap &cache)
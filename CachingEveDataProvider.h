@@ -15,16 +15,24 @@
 #pragma once
 
 #include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <array>
 #include <mutex>
 
 #include <QStringList>
+#include <QTimer>
 #include <QHash>
 
 #include <boost/functional/hash.hpp>
 
 #include "ExternalOrderRepository.h"
-#include "MarketGroupRepository.h"
-#include "MetaGroupRepository.h"
+#include "ExternalOrderBook.h"
+#include "ConcurrentCache.h"
+#include "SystemDistanceTable.h"
+#include "RegionBuyPriceTable.h"
+#include "TypeMetadataTable.h"
+#include "SdeSnapshot.h"
 #include "EveTypeRepository.h"
 #include "EveDataProvider.h"
 #include "ESIManager.h"
@@ -47,11 +55,9 @@ namespace Evernus
         static const QString systemDistanceCacheFileName;
 
         CachingEveDataProvider(const EveTypeRepository &eveTypeRepository,
-                               const MetaGroupRepository &metaGroupRepository,
                                const ExternalOrderRepository &externalOrderRepository,
                                const MarketOrderRepository &marketOrderRepository,
                                const MarketOrderRepository &corpMarketOrderRepository,
-                               const MarketGroupRepository &marketGroupRepository,
                                const CitadelRepository &citadelRepository,
                                const EveDataManagerProvider &dataManagerProvider,
                                const DatabaseConnectionProvider &connectionProvider,
@@ -73,12 +79,14 @@ namespace Evernus
         virtual std::shared_ptr<ExternalOrder> getTypeStationSellPrice(EveType::IdType id, quint64 stationId) const override;
         virtual std::shared_ptr<ExternalOrder> getTypeRegionSellPrice(EveType::IdType id, uint regionId) const override;
         virtual std::shared_ptr<ExternalOrder> getTypeBuyPrice(EveType::IdType id, quint64 stationId, int range = -1) const override;
+        virtual quint64 getExternalOrderGeneration(EveType::IdType id, uint regionId) const override;
 
         virtual void updateExternalOrders(const std::vector<ExternalOrder> &orders) override;
         virtual void clearExternalOrders() override;
         virtual void clearExternalOrdersForType(EveType::IdType id) override;
 
         virtual QString getLocationName(quint64 id) const override;
+        virtual void precacheLocations(const LocationList &ids) const override;
         virtual QString getRegionName(uint id) const override;
         virtual QString getSolarSystemName(uint id) const override;
 
@@ -101,7 +109,7 @@ namespace Evernus
         virtual const CitadelRepository::EntityList &getCitadels() const override;
 
         virtual const ReprocessingMap &getOreReprocessingInfo() const override;
-        virtual const ReprocessingMap &getTypeReprocessingInfo(const TypeList &requestedTypes) const override;
+        virtual ReprocessingMap getTypeReprocessingInfo(const TypeList &requestedTypes) const override;
 
         virtual uint getGroupId(const QString &name) const override;
 
@@ -114,7 +122,11 @@ namespace Evernus
         virtual const ManufacturingInfo &getTypeManufacturingInfo(EveType::IdType typeId) const override;
         virtual EveType::IdType getBlueprintOutputType(EveType::IdType blueprintId) const override;
 
+        virtual CacheStatistics getCacheStatistics() const override;
+
         void precacheNames();
+        void precacheSnapshot();
+        void precacheTypeMetadata();
         void precacheJumpMap();
         void precacheRefTypes();
 
@@ -133,6 +145,7 @@ namespace Evernus
 
     private slots:
         void fetchGenericName(quint64 id);
+        void fetchQueuedGenericNames();
 
     private:
         using TypeLocationPair = std::pair<EveType::IdType, quint64>;
@@ -140,7 +153,52 @@ namespace Evernus
 
         using NameMap = QHash<quint64, QString>;
 
+        struct QStringHash
+        {
+            inline std::size_t operator ()(const QString &value) const noexcept
+            {
+                return qHash(value);
+            }
+        };
+
+        // immutable snapshots, tagged with the order generation they were built for
+        struct OrderBookSnapshot
+        {
+            quint64 mGeneration = 0;
+            ExternalOrderBook mBook;
+        };
+
+        struct BuyPriceTableSnapshot
+        {
+            quint64 mGeneration = 0;
+            RegionBuyPriceTable mTable;
+
+            inline BuyPriceTableSnapshot(quint64 generation,
+                                         const ExternalOrderRepository::EntityList &orders,
+                                         const std::vector<uint> &regionSystems,
+                                         const SystemDistanceTable &distances)
+                : mGeneration{generation}
+                , mTable{orders, regionSystems, distances}
+            {
+            }
+        };
+
+        struct OwnOrderIdsSnapshot
+        {
+            quint64 mGeneration = 0;
+            ExternalOrderBook::OrderIdSet mIds;
+        };
+
+        static const std::size_t orderGenerationSlots = 4096;
+
+        // names requested within this window (ms) are resolved with a single bulk request
+        static const int genericNameBatchDelay = 100;
+        static const std::size_t genericNameBatchSize = 1000;
+        // appended name records are folded into the main cache file once there are this many
+        static const int genericNameLogCompactionThreshold = 10000;
+
         static const QString nameCacheFileName;
+        static const QString nameLogFileName;
         static const QString raceCacheFileName;
         static const QString bloodlineCacheFileName;
         static const QString ancestryCacheFileName;
@@ -148,10 +206,8 @@ namespace Evernus
         static const QStringList oreGroupNames;
 
         const EveTypeRepository &mEveTypeRepository;
-        const MetaGroupRepository &mMetaGroupRepository;
         const ExternalOrderRepository &mExternalOrderRepository;
         const MarketOrderRepository &mMarketOrderRepository, &mCorpMarketOrderRepository;
-        const MarketGroupRepository &mMarketGroupRepository;
         const CitadelRepository &mCitadelRepository;
 
         const EveDataManagerProvider &mDataManagerProvider;
@@ -161,44 +217,42 @@ namespace Evernus
         mutable std::unordered_map<EveType::IdType, QString> mTradeableTypeNameCache;
         mutable TypeList mTradeableTypeCache;
         mutable TypeList mCitadelTypeCache;
-        mutable std::unordered_map<EveType::IdType, MetaGroupRepository::EntityPtr> mTypeMetaGroupCache;
-        mutable std::unordered_map<EveType::IdType, EveTypeRepository::EntityPtr> mTypeCache;
 
-        mutable std::unordered_map<TypeLocationPair, ExternalOrderRepository::EntityPtr, boost::hash<TypeLocationPair>>
-        mStationSellPrices;
-        mutable std::unordered_map<TypeLocationPair, ExternalOrderRepository::EntityPtr, boost::hash<TypeLocationPair>>
-        mRegionSellPrices;
-        mutable std::unordered_map<TypeLocationPair, ExternalOrderRepository::EntityPtr, boost::hash<TypeLocationPair>>
-        mBuyPrices;
+        TypeMetadataTable mTypeMetadata;
 
-        mutable std::unordered_map<TypeRegionPair, ExternalOrderRepository::EntityList, boost::hash<TypeRegionPair>>
-        mTypeRegionOrderCache;
+        // books and tables are loaded without any lock held and rebuilt lazily once their generation changes; a
+        // snapshot is only ever published over an older one, so a slow load cannot replace fresher data
+        mutable ConcurrentCache<TypeRegionPair, std::shared_ptr<const OrderBookSnapshot>, boost::hash<TypeRegionPair>> mOrderBooks;
+        mutable ConcurrentCache<TypeRegionPair, std::shared_ptr<const BuyPriceTableSnapshot>, boost::hash<TypeRegionPair>> mBuyPriceTables;
+        // own active orders are left out of price lookups; only accessed through std::atomic_load/store
+        mutable std::shared_ptr<const OwnOrderIdsSnapshot> mOwnActiveOrderIds;
 
-        mutable std::unordered_map<quint64, QString> mLocationNameCache;
+        // (type, region) keys share slots by hash, so a bump can cause a spurious rebuild but never a missed one
+        std::array<std::atomic<quint64>, orderGenerationSlots> mOrderGenerations{};
+        std::atomic<quint64> mGlobalOrderGeneration{0};
 
-        mutable std::unordered_map<EveType::IdType, MarketGroupRepository::EntityPtr> mTypeMarketGroupParentCache;
-        mutable std::unordered_map<EveType::IdType, MarketGroupRepository::EntityPtr> mTypeMarketGroupCache;
+        mutable ConcurrentCache<quint64, QString> mLocationNameCache;
 
         mutable NameMap mGenericNameCache;
         mutable std::unordered_set<quint64> mPendingNameRequests;
+        // only touched from the provider thread
+        std::vector<quint64> mQueuedNameRequests;
+        QTimer mGenericNameBatchTimer;
 
-        std::unordered_map<uint, std::unordered_multimap<uint, uint>> mSystemJumpMap;
-
-        mutable std::unordered_map<uint, uint> mSolarSystemRegionCache;
-        mutable std::unordered_map<uint, uint> mSolarSystemConstellationCache;
-        mutable std::unordered_map<quint64, uint> mLocationSolarSystemCache;
+        SdeSnapshot mSnapshot;
+        SystemDistanceTable mSystemDistances;
 
-        mutable std::mutex mLocationSolarSystemCacheMutex;
-        mutable std::mutex mTypeCacheMutex;
-        mutable std::recursive_mutex mExternalOrderCacheMutex;
-        mutable std::mutex mSolarSystemRegionCacheMutex;
-        mutable std::recursive_mutex mGenericNameCacheMutex;
+        mutable ConcurrentCache<quint64, uint> mLocationSolarSystemCache;
 
-        mutable std::unordered_map<uint, double> mSecurityStatuses;
+        mutable std::mutex mGenericNameCacheMutex;
+        // guards the lazily built type list, map and reprocessing caches below; entries are never replaced once built
+        mutable std::mutex mStaticDataCacheMutex;
+        // guards the citadel caches, which can be filled from other cache loaders on any thread
+        mutable std::mutex mCitadelCacheMutex;
 
         mutable std::vector<MapLocation> mRegionCache;
         mutable std::unordered_map<uint, std::vector<MapLocation>> mConstellationCache, mConstellationSolarSystemCache, mRegionSolarSystemCache;
-        mutable std::unordered_map<uint, std::vector<Station>> mStationCache;
+        mutable ConcurrentCache<uint, std::shared_ptr<const std::vector<Station>>> mStationCache;
         mutable std::unordered_map<Citadel::IdType, CitadelRepository::EntityPtr> mCitadelCache;
         mutable std::unordered_map<uint, CitadelRepository::EntityList> mRegionCitadelCache;
 
@@ -206,42 +260,37 @@ namespace Evernus
         mutable std::vector<MapTreeLocation> mAllSolarSystemsCache;
         mutable CitadelRepository::EntityList mAllCitadelsCache;
 
-        mutable std::unordered_map<uint, QString> mRegionNameCache;
-        mutable std::unordered_map<uint, QString> mSolarSystemNameCache;
+        mutable ConcurrentCache<uint, QString> mRegionNameCache;
+        mutable ConcurrentCache<uint, QString> mSolarSystemNameCache;
 
-        mutable std::unordered_map<quint64, uint> mStationRegionCache;
+        mutable ConcurrentCache<quint64, uint> mStationRegionCache;
 
-        mutable QHash<QString, uint> mGroupIdCache;
+        mutable ConcurrentCache<QString, uint, QStringHash> mGroupIdCache;
 
-        bool mUsePackagedVolume = false;
-
-        mutable QHash<QPair<uint, uint>, uint> mSystemDistances;
+        std::atomic_bool mUsePackagedVolume{false};
 
         mutable ReprocessingMap mOreReprocessingInfo;
         mutable ReprocessingMap mTypeReprocessingInfo;
 
-        mutable std::unordered_map<EveType::IdType, ManufacturingInfo> mTypeManufacturingInfoCache;
-        mutable std::unordered_map<EveType::IdType, EveType::IdType> mBlueprintOutputCache;
-
         NameMap mRaceNameCache;
         NameMap mBloodlineNameCache;
         NameMap mAncestryNameCache;
 
-        uint mManufacturingActivityId = 1; // 1 - fallback id at the time of writing
-
-        EveTypeRepository::EntityPtr getEveType(EveType::IdType id) const;
-
-        MarketGroupRepository::EntityPtr getMarketGroupParent(MarketGroup::IdType id) const;
-        MarketGroupRepository::EntityPtr getMarketGroup(MarketGroup::IdType id) const;
-
-        const ExternalOrderRepository::EntityList &getExternalOrders(EveType::IdType typeId, uint regionId) const;
+        void bumpOrderGeneration(EveType::IdType typeId, uint regionId) noexcept;
+        std::shared_ptr<const OrderBookSnapshot> getOrderBook(EveType::IdType typeId, uint regionId) const;
+        std::shared_ptr<const OwnOrderIdsSnapshot> getOwnActiveOrderIds() const;
 
         QString getCitadelName(Citadel::IdType id) const;
         uint getCitadelRegionId(Citadel::IdType id) const;
         uint getCitadelSolarSystemId(Citadel::IdType id) const;
-        const Citadel &getCitadel(Citadel::IdType id) const;
+        CitadelRepository::EntityPtr getCitadel(Citadel::IdType id) const;
+
+        void fetchGenericNames(std::vector<quint64> ids);
+        void storeGenericNames(const std::vector<quint64> &ids, const std::unordered_map<quint64, QString> &names);
+
+        void readGenericNameCache();
+        void appendGenericNameLog(const NameMap &names) const;
 
-        void findManufaturingActivity();
         void readCache(const QString &cacheFileName, NameMap &cache);
 
         template<class Cache>
@@ -249,6 +298,6 @@ namespace Evernus
 
         static ESIManager::Callback<ESIManager::NameMap> getFillNameMapCallback(NameMap &target);
 
-        static double getPackagedVolume(const EveType &type);
+        static double getPackagedVolume(uint groupId, double volume);
     };
 }
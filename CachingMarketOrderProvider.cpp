@@ -12,6 +12,10 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <QSettings>
+
+#include "CacheSettings.h"
+
 #include "CachingMarketOrderProvider.h"
 
 namespace Evernus
@@ -20,81 +24,54 @@ namespace Evernus
         : QObject{}
         , MarketOrderProvider{}
         , mOrderRepo{orderRepo}
+        , mOrders{&getSharedListWeight<MarketOrder>}
     {
+        QSettings settings;
+        mOrders.setBudget(settings.value(CacheSettings::marketOrderBudgetKey, CacheSettings::marketOrderBudgetDefault).toULongLong() * 1024 * 1024);
     }
 
     MarketOrderProvider::OrderList CachingMarketOrderProvider::getSellOrders(Character::IdType characterId) const
     {
-        auto it = mSellOrders.find(characterId);
-        if (it == std::end(mSellOrders))
-            it = mSellOrders.emplace(characterId, mOrderRepo.fetchForCharacter(characterId, MarketOrder::Type::Sell)).first;
-
-        return it->second;
+        return getOrders(OrderSet::Sell, characterId, [=] {
+            return mOrderRepo.fetchForCharacter(characterId, MarketOrder::Type::Sell);
+        });
     }
 
     MarketOrderProvider::OrderList CachingMarketOrderProvider::getBuyOrders(Character::IdType characterId) const
     {
-        auto it = mBuyOrders.find(characterId);
-        if (it == std::end(mBuyOrders))
-            it = mBuyOrders.emplace(characterId, mOrderRepo.fetchForCharacter(characterId, MarketOrder::Type::Buy)).first;
-
-        return it->second;
+        return getOrders(OrderSet::Buy, characterId, [=] {
+            return mOrderRepo.fetchForCharacter(characterId, MarketOrder::Type::Buy);
+        });
     }
 
     MarketOrderProvider::OrderList CachingMarketOrderProvider
     ::getArchivedOrders(Character::IdType characterId, const QDateTime &from, const QDateTime &to) const
     {
-        auto it = mArchivedOrders.find(characterId);
-        if (it == std::end(mArchivedOrders))
-            it = mArchivedOrders.emplace(characterId, mOrderRepo.fetchArchivedForCharacter(characterId)).first;
-
-        std::vector<std::shared_ptr<MarketOrder>> result;
-        for (const auto &order : it->second)
-        {
-            const auto lastSeen = order->getLastSeen();
-
-            if (lastSeen >= from && lastSeen <= to)
-                result.emplace_back(order);
-        }
-
-        return result;
+        return filterArchived(getOrders(OrderSet::Archived, characterId, [=] {
+            return mOrderRepo.fetchArchivedForCharacter(characterId);
+        }), from, to);
     }
 
     MarketOrderProvider::OrderList CachingMarketOrderProvider::getSellOrdersForCorporation(quint64 corporationId) const
     {
-        auto it = mCorpSellOrders.find(corporationId);
-        if (it == std::end(mCorpSellOrders))
-            it = mCorpSellOrders.emplace(corporationId, mOrderRepo.fetchForCorporation(corporationId, MarketOrder::Type::Sell)).first;
-
-        return it->second;
+        return getOrders(OrderSet::CorpSell, corporationId, [=] {
+            return mOrderRepo.fetchForCorporation(corporationId, MarketOrder::Type::Sell);
+        });
     }
 
     MarketOrderProvider::OrderList CachingMarketOrderProvider::getBuyOrdersForCorporation(quint64 corporationId) const
     {
-        auto it = mCorpBuyOrders.find(corporationId);
-        if (it == std::end(mCorpBuyOrders))
-            it = mCorpBuyOrders.emplace(corporationId, mOrderRepo.fetchForCorporation(corporationId, MarketOrder::Type::Buy)).first;
-
-        return it->second;
+        return getOrders(OrderSet::CorpBuy, corporationId, [=] {
+            return mOrderRepo.fetchForCorporation(corporationId, MarketOrder::Type::Buy);
+        });
     }
 
     MarketOrderProvider::OrderList CachingMarketOrderProvider
     ::getArchivedOrdersForCorporation(quint64 corporationId, const QDateTime &from, const QDateTime &to) const
     {
-        auto it = mCorpArchivedOrders.find(corporationId);
-        if (it == std::end(mCorpArchivedOrders))
-            it = mCorpArchivedOrders.emplace(corporationId, mOrderRepo.fetchArchivedForCorporation(corporationId)).first;
-
-        std::vector<std::shared_ptr<MarketOrder>> result;
-        for (const auto &order : it->second)
-        {
-            const auto lastSeen = order->getLastSeen();
-
-            if (lastSeen >= from && lastSeen <= to)
-                result.emplace_back(order);
-        }
-
-        return result;
+        return filterArchived(getOrders(OrderSet::CorpArchived, corporationId, [=] {
+            return mOrderRepo.fetchArchivedForCorporation(corporationId);
+        }), from, to);
     }
 
     void CachingMarketOrderProvider::removeOrder(MarketOrder::IdType id)
@@ -135,31 +112,64 @@ namespace Evernus
 
     void CachingMarketOrderProvider::clearOrdersForCharacter(Character::IdType id) const
     {
-        mSellOrders.erase(id);
-        mBuyOrders.erase(id);
-        mArchivedOrders.erase(id);
+        mOrders.erase(getKey(OrderSet::Sell, id));
+        mOrders.erase(getKey(OrderSet::Buy, id));
+        mOrders.erase(getKey(OrderSet::Archived, id));
     }
 
     void CachingMarketOrderProvider::clearOrdersForCorporation(uint id) const
     {
-        mCorpSellOrders.erase(id);
-        mCorpBuyOrders.erase(id);
-        mCorpArchivedOrders.erase(id);
+        mOrders.erase(getKey(OrderSet::CorpSell, id));
+        mOrders.erase(getKey(OrderSet::CorpBuy, id));
+        mOrders.erase(getKey(OrderSet::CorpArchived, id));
     }
 
     void CachingMarketOrderProvider::clearArchived() const
     {
-        mArchivedOrders.clear();
-        mCorpArchivedOrders.clear();
+        mOrders.eraseIf([](const auto &key, const auto &orders) {
+            Q_UNUSED(orders);
+            return key.first == static_cast<int>(OrderSet::Archived) || key.first == static_cast<int>(OrderSet::CorpArchived);
+        });
+    }
+
+    CacheStats CachingMarketOrderProvider::getCacheStats() const noexcept
+    {
+        return mOrders.getStats();
+    }
+
+    template<class Fetcher>
+    const MarketOrderProvider::OrderList &CachingMarketOrderProvider::getOrders(OrderSet set, quint64 ownerId, const Fetcher &fetcher) const
+    {
+        const auto key = getKey(set, ownerId);
+
+        const auto orders = mOrders.find(key);
+        if (orders != nullptr)
+            return *orders;
+
+        return mOrders.insert(key, fetcher());
     }
 
     void CachingMarketOrderProvider::clearAll()
     {
-        mSellOrders.clear();
-        mBuyOrders.clear();
-        mArchivedOrders.clear();
-        mCorpSellOrders.clear();
-        mCorpBuyOrders.clear();
-        mCorpArchivedOrders.clear();
+        mOrders.clear();
+    }
+
+    MarketOrderProvider::OrderList CachingMarketOrderProvider::filterArchived(const OrderList &orders, const QDateTime &from, const QDateTime &to)
+    {
+        std::vector<std::shared_ptr<MarketOrder>> result;
+        for (const auto &order : orders)
+        {
+            const auto lastSeen = order->getLastSeen();
+
+            if (lastSeen >= from && lastSeen <= to)
+                result.emplace_back(order);
+        }
+
+        return result;
+    }
+
+    CachingMarketOrderProvider::OrderSetKey CachingMarketOrderProvider::getKey(OrderSet set, quint64 ownerId) noexcept
+    {
+        return std::make_pair(static_cast<int>(set), ownerId);
     }
 }
@@ -14,10 +14,13 @@
  */
 #pragma once
 
-#include <unordered_map>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
 
 #include "MarketOrderRepository.h"
 #include "MarketOrderProvider.h"
+#include "BoundedCache.h"
 
 namespace Evernus
 {
@@ -49,23 +52,35 @@ namespace Evernus
         void clearOrdersForCorporation(uint id) const;
         void clearArchived() const;
 
+        CacheStats getCacheStats() const noexcept;
+
     signals:
         void orderChanged();
 
     private:
-        typedef std::unordered_map<Character::IdType, OrderList> MarketOrderMap;
-        typedef std::unordered_map<quint64, OrderList> CorpMarketOrderMap;
+        enum class OrderSet
+        {
+            Sell,
+            Buy,
+            Archived,
+            CorpSell,
+            CorpBuy,
+            CorpArchived
+        };
+
+        using OrderSetKey = std::pair<int, quint64>;
 
         const MarketOrderRepository &mOrderRepo;
 
-        mutable MarketOrderMap mSellOrders;
-        mutable MarketOrderMap mBuyOrders;
-        mutable MarketOrderMap mArchivedOrders;
+        // all order sets share one budget
+        mutable BoundedCache<OrderSetKey, OrderList, boost::hash<OrderSetKey>> mOrders;
 
-        mutable CorpMarketOrderMap mCorpSellOrders;
-        mutable CorpMarketOrderMap mCorpBuyOrders;
-        mutable CorpMarketOrderMap mCorpArchivedOrders;
+        template<class Fetcher>
+        const OrderList &getOrders(OrderSet set, quint64 ownerId, const Fetcher &fetcher) const;
 
         void clearAll();
+
+        static OrderList filterArchived(const OrderList &orders, const QDateTime &from, const QDateTime &to);
+        static OrderSetKey getKey(OrderSet set, quint64 ownerId) noexcept;
     };
 }
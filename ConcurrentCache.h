@@ -0,0 +1,119 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <shared_mutex>
+#include <functional>
+#include <optional>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <array>
+
+#include <QtGlobal>
+
+#include "CacheStats.h"
+
+namespace Evernus
+{
+    // read-mostly map split into independently locked shards; hits only take a shared lock on one shard
+    // with a budget, entries are evicted CLOCK-wise: hits merely set a reference bit, so they never need an exclusive lock
+    template<class Key, class Value, class Hash = std::hash<Key>>
+    class ConcurrentCache final
+    {
+    public:
+        // approximate memory taken by a value, including sizeof(Value)
+        using Weigher = std::function<std::size_t (const Value &)>;
+
+        static const std::size_t unbounded = 0;
+
+        explicit ConcurrentCache(Weigher weigher = Weigher{}, std::size_t budget = unbounded);
+        ConcurrentCache(const ConcurrentCache &) = delete;
+        ConcurrentCache(ConcurrentCache &&) = delete;
+        ~ConcurrentCache() = default;
+
+        // loader runs without any lock held, so it may use other caches; if two threads miss at once, the first insert wins
+        template<class Loader>
+        Value get(const Key &key, const Loader &loader);
+
+        std::optional<Value> find(const Key &key) const;
+        bool contains(const Key &key) const;
+
+        // keeps an existing value
+        void insert(const Key &key, Value value);
+        // replaces an existing value if replace(existing) yields true
+        template<class Replace>
+        void insert(const Key &key, Value value, const Replace &replace);
+        // re-weighs a value which grew after being inserted
+        void updateWeight(const Key &key);
+        void clear();
+
+        // in bytes, split evenly between shards; shrinking takes effect on the next insert into each shard
+        void setBudget(std::size_t budget) noexcept;
+
+        CacheStats getStats() const;
+
+        ConcurrentCache &operator =(const ConcurrentCache &) = delete;
+        ConcurrentCache &operator =(ConcurrentCache &&) = delete;
+
+    private:
+        static const std::size_t shardCount = 16;
+
+        struct Slot
+        {
+            Value mValue;
+            std::size_t mWeight = 0;
+            std::size_t mClockIndex = 0;
+            mutable std::atomic_bool mReferenced{false};
+
+            Slot(Value value, std::size_t weight, std::size_t clockIndex);
+        };
+
+        struct Shard
+        {
+            mutable std::shared_mutex mMutex;
+            std::unordered_map<Key, Slot, Hash> mValues;
+            // keys in insertion order, swept by mHand
+            std::vector<Key> mClock;
+            std::size_t mHand = 0;
+            std::size_t mBytes = 0;
+        };
+
+        std::array<Shard, shardCount> mShards;
+
+        Weigher mWeigher;
+        std::atomic<std::size_t> mBudget{unbounded};
+
+        mutable std::atomic<quint64> mHits{0};
+        mutable std::atomic<quint64> mMisses{0};
+        mutable std::atomic<quint64> mContentions{0};
+        std::atomic<quint64> mEvictions{0};
+
+        Shard &getShard(const Key &key);
+        const Shard &getShard(const Key &key) const;
+
+        // require an exclusive lock on the shard
+        const Value &insert(Shard &shard, const Key &key, Value value);
+        void evict(Shard &shard, const Key &keep);
+
+        std::size_t getWeight(const Value &value) const;
+
+        std::shared_lock<std::shared_mutex> lockShared(const Shard &shard) const;
+        std::unique_lock<std::shared_mutex> lockExclusive(const Shard &shard) const;
+    };
+}
+
+#include "ConcurrentCache.inl"
@@ -0,0 +1,283 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Evernus
+{
+    template<class Key, class Value, class Hash>
+    ConcurrentCache<Key, Value, Hash>::Slot::Slot(Value value, std::size_t weight, std::size_t clockIndex)
+        : mValue{std::move(value)}
+        , mWeight{weight}
+        , mClockIndex{clockIndex}
+    {
+    }
+
+    template<class Key, class Value, class Hash>
+    ConcurrentCache<Key, Value, Hash>::ConcurrentCache(Weigher weigher, std::size_t budget)
+        : mWeigher{std::move(weigher)}
+        , mBudget{budget}
+    {
+    }
+
+    template<class Key, class Value, class Hash>
+    template<class Loader>
+    Value ConcurrentCache<Key, Value, Hash>::get(const Key &key, const Loader &loader)
+    {
+        auto &shard = getShard(key);
+
+        {
+            const auto lock = lockShared(shard);
+
+            const auto it = shard.mValues.find(key);
+            if (it != std::end(shard.mValues))
+            {
+                mHits.fetch_add(1, std::memory_order_relaxed);
+                it->second.mReferenced.store(true, std::memory_order_relaxed);
+                return it->second.mValue;
+            }
+        }
+
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+
+        auto value = loader();
+
+        const auto lock = lockExclusive(shard);
+        return insert(shard, key, std::move(value));
+    }
+
+    template<class Key, class Value, class Hash>
+    std::optional<Value> ConcurrentCache<Key, Value, Hash>::find(const Key &key) const
+    {
+        const auto &shard = getShard(key);
+        const auto lock = lockShared(shard);
+
+        const auto it = shard.mValues.find(key);
+        if (it == std::end(shard.mValues))
+        {
+            mMisses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        mHits.fetch_add(1, std::memory_order_relaxed);
+        it->second.mReferenced.store(true, std::memory_order_relaxed);
+        return it->second.mValue;
+    }
+
+    template<class Key, class Value, class Hash>
+    bool ConcurrentCache<Key, Value, Hash>::contains(const Key &key) const
+    {
+        const auto &shard = getShard(key);
+        const auto lock = lockShared(shard);
+
+        return shard.mValues.find(key) != std::end(shard.mValues);
+    }
+
+    template<class Key, class Value, class Hash>
+    void ConcurrentCache<Key, Value, Hash>::insert(const Key &key, Value value)
+    {
+        auto &shard = getShard(key);
+        const auto lock = lockExclusive(shard);
+
+        insert(shard, key, std::move(value));
+    }
+
+    template<class Key, class Value, class Hash>
+    template<class Replace>
+    void ConcurrentCache<Key, Value, Hash>::insert(const Key &key, Value value, const Replace &replace)
+    {
+        auto &shard = getShard(key);
+        const auto lock = lockExclusive(shard);
+
+        const auto it = shard.mValues.find(key);
+        if (it == std::end(shard.mValues))
+        {
+            insert(shard, key, std::move(value));
+            return;
+        }
+
+        if (!replace(it->second.mValue))
+            return;
+
+        const auto weight = getWeight(value);
+
+        shard.mBytes = shard.mBytes - it->second.mWeight + weight;
+
+        it->second.mValue = std::move(value);
+        it->second.mWeight = weight;
+
+        evict(shard, key);
+    }
+
+    template<class Key, class Value, class Hash>
+    void ConcurrentCache<Key, Value, Hash>::updateWeight(const Key &key)
+    {
+        auto &shard = getShard(key);
+        const auto lock = lockExclusive(shard);
+
+        const auto it = shard.mValues.find(key);
+        if (it == std::end(shard.mValues))
+            return;
+
+        const auto weight = getWeight(it->second.mValue);
+
+        shard.mBytes = shard.mBytes - it->second.mWeight + weight;
+        it->second.mWeight = weight;
+
+        evict(shard, key);
+    }
+
+    template<class Key, class Value, class Hash>
+    void ConcurrentCache<Key, Value, Hash>::clear()
+    {
+        for (auto &shard : mShards)
+        {
+            const auto lock = lockExclusive(shard);
+
+            shard.mValues.clear();
+            shard.mClock.clear();
+            shard.mHand = 0;
+            shard.mBytes = 0;
+        }
+    }
+
+    template<class Key, class Value, class Hash>
+    void ConcurrentCache<Key, Value, Hash>::setBudget(std::size_t budget) noexcept
+    {
+        mBudget.store(budget, std::memory_order_relaxed);
+    }
+
+    template<class Key, class Value, class Hash>
+    CacheStats ConcurrentCache<Key, Value, Hash>::getStats() const
+    {
+        CacheStats stats;
+        stats.mHits = mHits.load(std::memory_order_relaxed);
+        stats.mMisses = mMisses.load(std::memory_order_relaxed);
+        stats.mContentions = mContentions.load(std::memory_order_relaxed);
+        stats.mEvictions = mEvictions.load(std::memory_order_relaxed);
+        stats.mBudget = mBudget.load(std::memory_order_relaxed);
+
+        for (const auto &shard : mShards)
+        {
+            const auto lock = lockShared(shard);
+
+            stats.mEntries += shard.mValues.size();
+            stats.mBytes += shard.mBytes;
+        }
+
+        return stats;
+    }
+
+    template<class Key, class Value, class Hash>
+    typename ConcurrentCache<Key, Value, Hash>::Shard &ConcurrentCache<Key, Value, Hash>::getShard(const Key &key)
+    {
+        return mShards[Hash{}(key) % shardCount];
+    }
+
+    template<class Key, class Value, class Hash>
+    const typename ConcurrentCache<Key, Value, Hash>::Shard &ConcurrentCache<Key, Value, Hash>::getShard(const Key &key) const
+    {
+        return mShards[Hash{}(key) % shardCount];
+    }
+
+    template<class Key, class Value, class Hash>
+    const Value &ConcurrentCache<Key, Value, Hash>::insert(Shard &shard, const Key &key, Value value)
+    {
+        const auto weight = getWeight(value);
+        const auto result = shard.mValues.try_emplace(key, std::move(value), weight, shard.mClock.size());
+        if (!result.second)
+            return result.first->second.mValue;
+
+        shard.mClock.emplace_back(key);
+        shard.mBytes += weight;
+
+        evict(shard, key);
+
+        return result.first->second.mValue;
+    }
+
+    template<class Key, class Value, class Hash>
+    void ConcurrentCache<Key, Value, Hash>::evict(Shard &shard, const Key &keep)
+    {
+        const auto budget = mBudget.load(std::memory_order_relaxed) / shardCount;
+        if (budget == unbounded)
+            return;
+
+        const auto equal = shard.mValues.key_eq();
+
+        while (shard.mBytes > budget && shard.mClock.size() > 1)
+        {
+            if (shard.mHand >= shard.mClock.size())
+                shard.mHand = 0;
+
+            const auto slot = shard.mValues.find(shard.mClock[shard.mHand]);
+            Q_ASSERT(slot != std::end(shard.mValues));
+
+            // entries used since the last sweep get a second chance
+            if (slot->second.mReferenced.exchange(false, std::memory_order_relaxed) || equal(slot->first, keep))
+            {
+                ++shard.mHand;
+                continue;
+            }
+
+            const auto index = slot->second.mClockIndex;
+
+            shard.mBytes -= slot->second.mWeight;
+            shard.mValues.erase(slot);
+
+            // the last key takes over the freed position, which the hand visits next
+            if (index + 1 != shard.mClock.size())
+            {
+                shard.mClock[index] = std::move(shard.mClock.back());
+                shard.mValues.find(shard.mClock[index])->second.mClockIndex = index;
+            }
+
+            shard.mClock.pop_back();
+
+            mEvictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    template<class Key, class Value, class Hash>
+    std::size_t ConcurrentCache<Key, Value, Hash>::getWeight(const Value &value) const
+    {
+        // map node, clock key and bookkeeping
+        const auto overhead = 2 * sizeof(Key) + sizeof(Slot) - sizeof(Value) + 4 * sizeof(void *);
+        return overhead + ((mWeigher) ? (mWeigher(value)) : (sizeof(Value)));
+    }
+
+    template<class Key, class Value, class Hash>
+    std::shared_lock<std::shared_mutex> ConcurrentCache<Key, Value, Hash>::lockShared(const Shard &shard) const
+    {
+        std::shared_lock<std::shared_mutex> lock{shard.mMutex, std::try_to_lock};
+        if (!lock.owns_lock())
+        {
+            mContentions.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+
+        return lock;
+    }
+
+    template<class Key, class Value, class Hash>
+    std::unique_lock<std::shared_mutex> ConcurrentCache<Key, Value, Hash>::lockExclusive(const Shard &shard) const
+    {
+        std::unique_lock<std::shared_mutex> lock{shard.mMutex, std::try_to_lock};
+        if (!lock.owns_lock())
+        {
+            mContentions.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+
+        return lock;
+    }
+}
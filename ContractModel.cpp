@@ -162,6 +162,16 @@ namespace Evernus
         mTotalPrice = mTotalReward = mTotalCollateral = mTotalVolume = 0.;
 
         mContracts = getContracts();
+
+        EveDataProvider::LocationList locationIds;
+        for (const auto &contract : mContracts)
+        {
+            locationIds.emplace(contract->getStartStationId());
+            locationIds.emplace(contract->getEndStationId());
+        }
+
+        mDataProvider.precacheLocations(locationIds);
+
         for (const auto &contract : mContracts)
         {
             const auto status = contract->getStatus();
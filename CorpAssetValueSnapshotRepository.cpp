@@ -66,16 +66,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     CorpAssetValueSnapshotRepository::EntityList CorpAssetValueSnapshotRepository
@@ -90,16 +81,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     QStringList CorpAssetValueSnapshotRepository::getColumns() const
@@ -67,16 +67,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     CorpWalletSnapshotRepository::EntityList CorpWalletSnapshotRepository
@@ -91,16 +82,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     QStringList CorpWalletSnapshotRepository::getColumns() const
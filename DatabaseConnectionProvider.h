@@ -18,6 +18,8 @@ class QSqlDatabase;
 
 namespace Evernus
 {
+    class DatabaseWriter;
+
     class DatabaseConnectionProvider
     {
     public:
@@ -27,6 +29,11 @@ namespace Evernus
         virtual ~DatabaseConnectionProvider() = default;
 
         virtual QSqlDatabase getConnection() const = 0;
+        // writer serializing asynchronous writes to this database; null if there is none
+        virtual DatabaseWriter *getWriter() const noexcept
+        {
+            return nullptr;
+        }
 
         DatabaseConnectionProvider &operator =(const DatabaseConnectionProvider &) = default;
         DatabaseConnectionProvider &operator =(DatabaseConnectionProvider &&) = default;
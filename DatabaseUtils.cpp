@@ -17,6 +17,7 @@
 #include <boost/throw_exception.hpp>
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QStandardPaths>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -24,6 +25,8 @@
 #include <QtDebug>
 #include <QFile>
 
+#include "QueryStatistics.h"
+
 #include "DatabaseUtils.h"
 
 namespace Evernus::DatabaseUtils
@@ -40,14 +43,21 @@ namespace Evernus::DatabaseUtils
 
     void execQuery(QSqlQuery &query)
     {
-        qDebug() << "SQL:" << query.lastQuery();
+        QElapsedTimer timer;
+        timer.start();
+
         if (!query.exec())
         {
             auto error = query.lastError();
-            qCritical() << error;
+            qCritical() << error << query.lastQuery();
 
             BOOST_THROW_EXCEPTION(std::runtime_error{error.text().toStdString()});
         }
+
+        QueryStatistics::recordExec(query.lastQuery(),
+                                    timer.nsecsElapsed() / 1000,
+                                    (query.isSelect()) ? (0) : (query.numRowsAffected()),
+                                    query);
     }
 
     QString backupDatabase(const QSqlDatabase &db)
@@ -64,4 +74,39 @@ namespace Evernus::DatabaseUtils
 
         return dbBak;
     }
+
+    QString getPlaceholders(std::size_t count)
+    {
+        QString result;
+        if (count == 0)
+            return result;
+
+        result.reserve(static_cast<int>(count * 3));
+        result += QLatin1Char{'?'};
+
+        for (auto i = 1u; i < count; ++i)
+            result += QLatin1String{", ?"};
+
+        return result;
+    }
+
+    QString getRowPlaceholders(std::size_t columns, std::size_t rows)
+    {
+        QString result;
+        if (rows == 0)
+            return result;
+
+        const QString row = QLatin1Char{'('} + getPlaceholders(columns) + QLatin1Char{')'};
+
+        result.reserve(static_cast<int>(rows * (row.size() + 2)));
+        result += row;
+
+        for (auto i = 1u; i < rows; ++i)
+        {
+            result += QLatin1String{", "};
+            result += row;
+        }
+
+        return result;
+    }
 }
@@ -15,6 +15,7 @@
 #pragma once
 
 #include <unordered_set>
+#include <cstddef>
 
 class QSqlDatabase;
 class QSqlRecord;
@@ -30,6 +31,9 @@ namespace Evernus::DatabaseUtils
     QString backupDatabase(const QSqlDatabase &db);
     QString backupDatabase(const QString &dbPath);
 
+    QString getPlaceholders(std::size_t count);
+    QString getRowPlaceholders(std::size_t columns, std::size_t rows);
+
     template<class T>
     std::unordered_set<T> decodeRawSet(const QSqlRecord &record, const QString &name);
     template<class T>
@@ -0,0 +1,47 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <type_traits>
+
+#include <QFuture>
+
+class QThreadPool;
+class QObject;
+
+namespace Evernus
+{
+    // Bounded pool for database work issued off the GUI thread. Connections are per-thread, so the threads never
+    // expire - otherwise every recycled thread would open (and leak) a new connection.
+    class DatabaseWorkerPool final
+    {
+    public:
+        DatabaseWorkerPool() = delete;
+
+        static QThreadPool &getPool();
+
+        template<class Func>
+        static QFuture<std::invoke_result_t<Func>> run(Func func);
+
+        // calls callback with the result in the thread of context; exceptions are rethrown there
+        template<class T, class Callback>
+        static void onFinished(const QFuture<T> &future, QObject *context, Callback callback);
+
+    private:
+        static const int maxThreadCount = 4;
+    };
+}
+
+#include "DatabaseWorkerPool.inl"
@@ -0,0 +1,60 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include "StandardExceptionQtWrapperException.h"
+
+namespace Evernus
+{
+    template<class Func>
+    QFuture<std::invoke_result_t<Func>> DatabaseWorkerPool::run(Func func)
+    {
+        return QtConcurrent::run(&getPool(), [=] {
+            // Qt is not smart enough to handle standard exceptions
+            try
+            {
+                return func();
+            }
+            catch (...)
+            {
+                throw StandardExceptionQtWrapperException{std::current_exception()};
+            }
+        });
+    }
+
+    template<class T, class Callback>
+    void DatabaseWorkerPool::onFinished(const QFuture<T> &future, QObject *context, Callback callback)
+    {
+        Q_ASSERT(context != nullptr);
+
+        auto watcher = new QFutureWatcher<T>{context};
+        QObject::connect(watcher, &QFutureWatcher<T>::finished, context, [=] {
+            if (!watcher->isCanceled())
+            {
+                if constexpr (std::is_void_v<T>)
+                    callback();
+                else
+                    callback(watcher->result());
+            }
+        });
+        QObject::connect(watcher, &QFutureWatcher<T>::finished, watcher, &QFutureWatcher<T>::deleteLater);
+        QObject::connect(watcher, &QFutureWatcher<T>::canceled, context, [=] {
+            watcher->waitForFinished(); // rethrow exception, if present
+        });
+
+        watcher->setFuture(future);
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <future>
+
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+#include "StandardExceptionQtWrapperException.h"
+
+#include "DatabaseWriter.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        thread_local bool writerThread = false;
+    }
+
+    DatabaseWriter::DatabaseWriter()
+    {
+        // one thread which never expires, so the writer keeps a single connection for its whole lifetime
+        mPool.setMaxThreadCount(1);
+        mPool.setExpiryTimeout(-1);
+    }
+
+    DatabaseWriter::~DatabaseWriter()
+    {
+        mPool.waitForDone();
+    }
+
+    QFuture<void> DatabaseWriter::submit(std::function<void ()> job)
+    {
+        QElapsedTimer queuedTimer;
+        queuedTimer.start();
+
+        ++mQueueDepth;
+
+        return QtConcurrent::run(&mPool, [=] {
+            writerThread = true;
+
+            const auto waitMs = queuedTimer.elapsed();
+
+            QElapsedTimer runTimer;
+            runTimer.start();
+
+            try
+            {
+                job();
+            }
+            catch (...)
+            {
+                --mQueueDepth;
+                recordJob(waitMs, runTimer.elapsed());
+
+                // Qt is not smart enough to handle standard exceptions
+                throw StandardExceptionQtWrapperException{std::current_exception()};
+            }
+
+            --mQueueDepth;
+            recordJob(waitMs, runTimer.elapsed());
+        });
+    }
+
+    void DatabaseWriter::run(const std::function<void ()> &job)
+    {
+        // nested writes would deadlock the single writer thread
+        if (writerThread)
+        {
+            job();
+            return;
+        }
+
+        // not waiting on the QFuture, since it might steal the job and run it here, ahead of the queue
+        std::promise<void> done;
+        auto result = done.get_future();
+
+        submit([&] {
+            try
+            {
+                job();
+                done.set_value();
+            }
+            catch (...)
+            {
+                done.set_exception(std::current_exception());
+            }
+        });
+
+        result.get();
+    }
+
+    DatabaseWriter::Stats DatabaseWriter::getStats() const
+    {
+        std::lock_guard<std::mutex> lock{mStatsMutex};
+
+        auto stats = mStats;
+        stats.mQueueDepth = mQueueDepth;
+
+        return stats;
+    }
+
+    void DatabaseWriter::recordJob(qint64 waitMs, qint64 runMs)
+    {
+        std::lock_guard<std::mutex> lock{mStatsMutex};
+
+        ++mStats.mProcessedJobs;
+
+        mTotalWaitMs += waitMs;
+        mTotalRunMs += runMs;
+
+        mStats.mAverageWaitMs = mTotalWaitMs / mStats.mProcessedJobs;
+        mStats.mAverageRunMs = mTotalRunMs / mStats.mProcessedJobs;
+        mStats.mMaxWaitMs = std::max(mStats.mMaxWaitMs, waitMs);
+        mStats.mMaxRunMs = std::max(mStats.mMaxRunMs, runMs);
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <functional>
+#include <atomic>
+#include <mutex>
+
+#include <QThreadPool>
+#include <QFuture>
+
+namespace Evernus
+{
+    // Serializes asynchronous DB writes on one dedicated thread (and so one connection). Used with WAL journal mode,
+    // where readers on other threads never block on this writer.
+    // Queued here: async batch stores (application and Repository::batchStoreAsync()), citadel replacement,
+    // external order updates and, through run(), synchronous Repository store()/batchStore()/remove() calls and
+    // market order notes/station/color tag changes. Other ad-hoc UPDATE/DELETE statements issued by individual
+    // repositories still write on the caller's connection.
+    class DatabaseWriter final
+    {
+    public:
+        struct Stats
+        {
+            std::size_t mQueueDepth = 0;
+            quint64 mProcessedJobs = 0;
+            qint64 mAverageWaitMs = 0;
+            qint64 mMaxWaitMs = 0;
+            qint64 mAverageRunMs = 0;
+            qint64 mMaxRunMs = 0;
+        };
+
+        DatabaseWriter();
+        DatabaseWriter(const DatabaseWriter &) = delete;
+        DatabaseWriter(DatabaseWriter &&) = delete;
+        ~DatabaseWriter();
+
+        QFuture<void> submit(std::function<void ()> job);
+        // queues the job and blocks until it's done, rethrowing its exception; runs inline when called from a job
+        void run(const std::function<void ()> &job);
+
+        Stats getStats() const;
+
+        DatabaseWriter &operator =(const DatabaseWriter &) = delete;
+        DatabaseWriter &operator =(DatabaseWriter &&) = delete;
+
+    private:
+        QThreadPool mPool;
+
+        std::atomic_size_t mQueueDepth{0};
+
+        mutable std::mutex mStatsMutex;
+        Stats mStats;
+        qint64 mTotalWaitMs = 0;
+        qint64 mTotalRunMs = 0;
+
+        void recordJob(qint64 waitMs, qint64 runMs);
+    };
+}
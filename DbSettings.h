@@ -21,7 +21,15 @@ namespace Evernus
     namespace DbSettings
     {
         const auto synchronousDefault = 0;
+        const auto useWALDefault = false;
+        const auto partitionExternalOrdersDefault = false;
+        const auto slowQueryThresholdDefault = 1000;
+        const auto collectQueryStatisticsDefault = false;
 
         const auto synchronousKey = QStringLiteral("db/synchronous");
+        const auto useWALKey = QStringLiteral("db/useWAL");
+        const auto partitionExternalOrdersKey = QStringLiteral("db/partitionExternalOrders");
+        const auto slowQueryThresholdKey = QStringLiteral("db/slowQueryThreshold");
+        const auto collectQueryStatisticsKey = QStringLiteral("db/collectQueryStatistics");
     }
 }
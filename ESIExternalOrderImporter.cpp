@@ -20,7 +20,7 @@ namespace Evernus
                                                        ESIInterfaceManager &interfaceManager,
                                                        QObject *parent)
         : CallbackExternalOrderImporter{parent}
-        , mManager{dataProvider, interfaceManager}
+        , mManager{dataProvider, interfaceManager, ESIRequestScheduler::Priority::BulkMarket}
     {
     }
 }
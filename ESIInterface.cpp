@@ -24,11 +24,14 @@
 #include <QStringList>
 #include <QJsonArray>
 #include <QUrlQuery>
+#include <QPointer>
 #include <QThread>
 #include <QUrl>
 
 #include "ESIInterfaceErrorLimiter.h"
 #include "CitadelAccessCache.h"
+#include "ESIResponseCache.h"
+#include "ESIRateLimiter.h"
 #include "NetworkSettings.h"
 #include "CallbackEvent.h"
 #include "ReplyTimeout.h"
@@ -42,6 +45,8 @@ namespace Evernus
     struct ESIInterface::PaginatedContext
     {
         uint mFetchedPages = 0;
+        bool mFailed = false;
+        uint mGeneration = 0;
     };
 
     ESIInterface::ErrorInfo::operator QString() const
@@ -53,9 +58,10 @@ namespace Evernus
     struct ESIInterface::TaggedInvoke<ESIInterface::JsonTag>
     {
         template<class T>
-        static inline void invoke(const QByteArray &data, const QNetworkReply &reply, const T &callback)
+        static inline void invoke(const QByteArray &data, const QDateTime &expires, uint pages, const T &callback)
         {
-            callback(QJsonDocument::fromJson(data), QString{}, getExpireTime(reply));
+            Q_UNUSED(pages);
+            callback(QJsonDocument::fromJson(data), QString{}, expires);
         }
 
         template<class T>
@@ -75,9 +81,9 @@ namespace Evernus
     struct ESIInterface::TaggedInvoke<ESIInterface::PaginatedJsonTag>
     {
         template<class T>
-        static inline void invoke(const QByteArray &data, const QNetworkReply &reply, const T &callback)
+        static inline void invoke(const QByteArray &data, const QDateTime &expires, uint pages, const T &callback)
         {
-            callback(QJsonDocument::fromJson(data), QString{}, getExpireTime(reply), getPageCount(reply));
+            callback(QJsonDocument::fromJson(data), QString{}, expires, pages);
         }
 
         template<class T>
@@ -93,13 +99,36 @@ namespace Evernus
         }
     };
 
+    template<>
+    struct ESIInterface::TaggedInvoke<ESIInterface::PaginatedRawTag>
+    {
+        template<class T>
+        static inline void invoke(const QByteArray &data, const QDateTime &expires, uint pages, const T &callback)
+        {
+            callback(QByteArray{data}, QString{}, expires, pages);
+        }
+
+        template<class T>
+        static inline void invoke(const QString &error, const QNetworkReply &reply, const T &callback)
+        {
+            callback(QByteArray{}, error, getExpireTime(reply), getPageCount(reply));
+        }
+
+        template<class T>
+        static inline void invoke(const QString &error, const T &callback)
+        {
+            callback(QByteArray{}, error, QDateTime{}, 1u);
+        }
+    };
+
     template<>
     struct ESIInterface::TaggedInvoke<ESIInterface::StringTag>
     {
         template<class T>
-        static inline void invoke(const QByteArray &data, const QNetworkReply &reply, const T &callback)
+        static inline void invoke(const QByteArray &data, const QDateTime &expires, uint pages, const T &callback)
         {
-            callback(QString::fromUtf8(data), QString{}, getExpireTime(reply));
+            Q_UNUSED(pages);
+            callback(QString::fromUtf8(data), QString{}, expires);
         }
 
         template<class T>
@@ -117,27 +146,52 @@ namespace Evernus
 
     ESIInterface::ESIInterface(CitadelAccessCache &citadelAccessCache,
                                ESIInterfaceErrorLimiter &errorLimiter,
+                               ESIResponseCache &responseCache,
+                               ESIRateLimiter &rateLimiter,
+                               ESIRequestScheduler &scheduler,
+                               ESIPageRequestLimiter &pageRequestLimiter,
                                ESIOAuth &oauth,
+                               ESIRequestScheduler::Priority priority,
                                QObject *parent)
         : QObject{parent}
         , mCitadelAccessCache{citadelAccessCache}
         , mErrorLimiter{errorLimiter}
+        , mResponseCache{responseCache}
+        , mRateLimiter{rateLimiter}
+        , mScheduler{scheduler}
+        , mPageRequestLimiter{pageRequestLimiter}
         , mOAuth{oauth}
+        , mPriority{priority}
     {
         QSettings settings;
         mLogReplies = settings.value(NetworkSettings::logESIRepliesKey, mLogReplies).toBool();
     }
 
-    void ESIInterface::fetchMarketOrders(uint regionId, EveType::IdType typeId, const PaginatedCallback &callback) const
+    ESIInterface::~ESIInterface()
+    {
+        mScheduler.discard(this);
+        mRateLimiter.discard(this);
+        mPageRequestLimiter.discard(this);
+
+        // requests waiting for the rate limiter or for replies hold slots nobody else would free
+        // except for the ones in ESIOAuth, which free theirs when it calls back
+        for (const auto &active : mActiveRequests)
+        {
+            for (auto i = mAuthenticatedRequests[active.first]; i < active.second; ++i)
+                mScheduler.finish(active.first);
+        }
+    }
+
+    void ESIInterface::fetchMarketOrders(uint regionId, EveType::IdType typeId, const PaginatedRawCallback &callback) const
     {
         qDebug() << "Fetching market orders for" << regionId << "and" << typeId;
-        fetchPaginatedData(QStringLiteral("/v1/markets/%1/orders/").arg(regionId), { { QStringLiteral("type_id"), typeId } }, 1, callback, std::make_shared<PaginatedContext>());
+        fetchPaginatedData<PaginatedRawTag>(QStringLiteral("/v1/markets/%1/orders/").arg(regionId), { { QStringLiteral("type_id"), typeId } }, 1, callback, std::make_shared<PaginatedContext>());
     }
 
-    void ESIInterface::fetchMarketOrders(uint regionId, const PaginatedCallback &callback) const
+    void ESIInterface::fetchMarketOrders(uint regionId, const PaginatedRawCallback &callback) const
     {
         qDebug() << "Fetching whole market for" << regionId;
-        fetchPaginatedData(QStringLiteral("/v1/markets/%1/orders/").arg(regionId), {}, 1, callback, std::make_shared<PaginatedContext>());
+        fetchPaginatedData<PaginatedRawTag>(QStringLiteral("/v1/markets/%1/orders/").arg(regionId), {}, 1, callback, std::make_shared<PaginatedContext>());
     }
 
     void ESIInterface::fetchMarketHistory(uint regionId, EveType::IdType typeId, const JsonCallback &callback) const
@@ -146,7 +200,7 @@ namespace Evernus
         get(QStringLiteral("/v1/markets/%1/history/").arg(regionId), { { QStringLiteral("type_id"), typeId } }, callback, getNumRetries());
     }
 
-    void ESIInterface::fetchCitadelMarketOrders(quint64 citadelId, Character::IdType charId, const PaginatedCallback &callback) const
+    void ESIInterface::fetchCitadelMarketOrders(quint64 citadelId, Character::IdType charId, const PaginatedRawCallback &callback) const
     {
         qDebug() << "Fetching orders from citadel" << citadelId;
 
@@ -163,7 +217,7 @@ namespace Evernus
             return;
         }
 
-        fetchPaginatedData(charId, QStringLiteral("/v1/markets/structures/%1/").arg(citadelId), 1, callback, std::make_shared<PaginatedContext>(), true, citadelId);
+        fetchPaginatedData<PaginatedRawTag>(charId, QStringLiteral("/v1/markets/structures/%1/").arg(citadelId), 1, callback, std::make_shared<PaginatedContext>(), true, citadelId);
     }
 
     void ESIInterface::fetchCharacterAssets(Character::IdType charId, const PaginatedCallback &callback) const
@@ -451,7 +505,7 @@ namespace Evernus
 
         post(QStringLiteral("/v2/universe/names/"),
              idArray,
-             [=](const auto &error) {
+             [=](const auto &error, auto) {
                  callback({}, error);
              }, [=](const auto &data) {
                  const auto doc = QJsonDocument::fromJson(data);
@@ -465,7 +519,7 @@ namespace Evernus
         );
     }
 
-    void ESIInterface::fetchGenericNames(const std::vector<quint64> &ids, const PersistentJsonCallback &callback) const
+    void ESIInterface::fetchGenericNames(const std::vector<quint64> &ids, const NamesCallback &callback) const
     {
         qDebug() << "Fetching generic names:" << ids.size();
 
@@ -476,10 +530,10 @@ namespace Evernus
 
         post(QStringLiteral("/v2/universe/names/"),
              idArray,
-             [=](const auto &error) {
-                 callback({}, error);
+             [=](const auto &error, auto httpStatus) {
+                 callback({}, error, httpStatus == invalidIdsCode);
              }, [=](const auto &data) {
-                 callback(QJsonDocument::fromJson(data), {});
+                 callback(QJsonDocument::fromJson(data), {}, false);
              }
         );
     }
@@ -521,6 +575,17 @@ namespace Evernus
         post(charId, QStringLiteral("/v1/ui/openwindow/marketdetails/?type_id=%1").arg(typeId), {}, std::move(errorCallback));
     }
 
+    void ESIInterface::cancelPendingRequests() const
+    {
+        ++mCancelGeneration;
+
+        runNowOrLater([=] {
+            // scheduler first - freeing slots of requests held back by the rate limiter would dispatch the queued ones
+            mScheduler.cancel(this);
+            mRateLimiter.cancel(this);
+        });
+    }
+
     void ESIInterface::setDestination(quint64 locationId, Character::IdType charId, const ErrorCallback &errorCallback) const
     {
         qDebug() << "Setting destination:" << locationId;
@@ -553,13 +618,19 @@ namespace Evernus
     {
         return [=, continuation = std::move(continuation), fetchNext = std::move(fetchNext), context = std::move(context)]
                (auto &&response, const auto &error, const auto &expires, auto pages) {
+            Q_ASSERT(context);
+
+            // the consumer has already got the error, so pages still in flight are dropped
+            if (context->mFailed)
+                return;
+
             if (Q_UNLIKELY(!error.isEmpty()))
             {
+                context->mFailed = true;
                 continuation({}, true, error, expires);
                 return;
             }
 
-            Q_ASSERT(context);
             ++context->mFetchedPages;
 
             if (pages > 0)
@@ -591,8 +662,7 @@ namespace Evernus
             }
             else
             {
-                const auto array = response.array();
-                if (array.isEmpty())
+                if (isEmptyPage(response))
                 {
                     continuation(std::move(response), true, QString{}, expires);
                 }
@@ -605,23 +675,43 @@ namespace Evernus
         };
     }
 
-    template<class T>
+    template<class ResultTag, class T>
     void ESIInterface::fetchPaginatedData(const QString &url, QVariantMap parameters, uint page, T &&continuation, const std::shared_ptr<PaginatedContext> &context) const
     {
         const auto callback = createPaginatedCallback(
             page,
             continuation,
             [=](auto nextPage) {
-                fetchPaginatedData(url, parameters, nextPage, continuation, context);
+                fetchPaginatedData<ResultTag>(url, parameters, nextPage, continuation, context);
             },
             context
         );
 
         parameters[QStringLiteral("page")] = page;
-        get<decltype(callback), PaginatedJsonTag>(url, parameters, callback, getNumRetries());
+
+        if (page == 1)
+            context->mGeneration = mCancelGeneration;
+
+        schedulePageRequest(url, [=] {
+            if (context->mFailed)
+                return false;
+
+            if (context->mGeneration != mCancelGeneration)
+            {
+                TaggedInvoke<ResultTag>::invoke(getCancelledError(), callback);
+                return false;
+            }
+
+            get<decltype(callback), ResultTag>(url, parameters, [=](auto &&response, const auto &error, const auto &expires, auto pages) {
+                finishPageRequest(url);
+                callback(std::move(response), error, expires, pages);
+            }, getNumRetries());
+
+            return true;
+        });
     }
 
-    template<class T>
+    template<class ResultTag, class T>
     void ESIInterface::fetchPaginatedData(Character::IdType charId,
                                           const QString &url,
                                           uint page,
@@ -634,27 +724,69 @@ namespace Evernus
             page,
             continuation,
             [=](auto nextPage) {
-                fetchPaginatedData(charId, url, nextPage, continuation, context, importingCitadels, citadelId);
+                fetchPaginatedData<ResultTag>(charId, url, nextPage, continuation, context, importingCitadels, citadelId);
             },
             context
         );
 
-        get<decltype(callback), PaginatedJsonTag>(
-            charId,
-            url,
-            { { QStringLiteral("page"), page } },
-            callback,
-            getNumRetries(),
-            importingCitadels,
-            citadelId
-        );
+        if (page == 1)
+            context->mGeneration = mCancelGeneration;
+
+        schedulePageRequest(url, [=] {
+            if (context->mFailed)
+                return false;
+
+            if (context->mGeneration != mCancelGeneration)
+            {
+                TaggedInvoke<ResultTag>::invoke(getCancelledError(), callback);
+                return false;
+            }
+
+            get<decltype(callback), ResultTag>(
+                charId,
+                url,
+                { { QStringLiteral("page"), page } },
+                [=](auto &&response, const auto &error, const auto &expires, auto pages) {
+                    finishPageRequest(url);
+                    callback(std::move(response), error, expires, pages);
+                },
+                getNumRetries(),
+                importingCitadels,
+                citadelId
+            );
+
+            return true;
+        });
+    }
+
+    template<class T>
+    auto ESIInterface::wrapAuthenticatedCallback(const QString &url, T callback) const
+    {
+        const auto priority = getPriority(url);
+        return [=, self = QPointer<const ESIInterface>{this}, &scheduler = mScheduler](auto &&...args) {
+            if (self.isNull())
+            {
+                scheduler.finish(priority);
+                return;
+            }
+
+            auto &authenticated = self->mAuthenticatedRequests[priority];
+            Q_ASSERT(authenticated > 0);
+
+            --authenticated;
+            callback(std::forward<decltype(args)>(args)...);
+        };
     }
 
     template<class T, class ResultTag>
     void ESIInterface::get(const QString &url, const QVariantMap &parameters, const T &continuation, uint retries) const
     {
-        runNowOrLater([=] {
-            auto reply = mOAuth.get(ESIUrls::esiUrl + url, parameters);
+        runScheduled(Character::invalidId, url, [=] {
+            TaggedInvoke<ResultTag>::invoke(getCancelledError(), continuation);
+        }, [=] {
+            const auto cacheKey = ESIResponseCache::getKey(url, parameters);
+
+            auto reply = mOAuth.get(ESIUrls::esiUrl + url, parameters, mResponseCache.getETag(cacheKey));
             Q_ASSERT(reply != nullptr);
 
             qDebug() << "ESI request:" << reply << "" << url << ":" << parameters;
@@ -666,6 +798,8 @@ namespace Evernus
                 reply->deleteLater();
 
                 showReplyDebugInfo(*reply);
+                mRateLimiter.processReply(url, *reply);
+                finishRequest(url);
 
                 const auto error = reply->error();
                 if (Q_UNLIKELY(error != QNetworkReply::NoError))
@@ -691,11 +825,9 @@ namespace Evernus
                 }
                 else
                 {
-                    const auto data = reply->readAll();
-                    if (mLogReplies)
-                        qDebug() << reply << data;
-
-                    TaggedInvoke<ResultTag>::invoke(data, *reply, continuation);
+                    processReply<T, ResultTag>(*reply, cacheKey, continuation, [=] {
+                        get<T, ResultTag>(url, parameters, continuation, retries);
+                    });
                 }
             });
         });
@@ -710,12 +842,20 @@ namespace Evernus
                            bool importingCitadels,
                            quint64 citadelId) const
     {
-        runNowOrLater([=] {
-            mOAuth.get(charId, ESIUrls::esiUrl + url, parameters, [=](auto &reply) {
+        runScheduled(charId, url, [=] {
+            TaggedInvoke<ResultTag>::invoke(getCancelledError(), continuation);
+        }, [=] {
+            const auto cacheKey = ESIResponseCache::getKey(url, parameters, charId);
+
+            ++mAuthenticatedRequests[getPriority(url)];
+
+            mOAuth.get(charId, ESIUrls::esiUrl + url, parameters, wrapAuthenticatedCallback(url, [=](auto &reply) {
                 qDebug() << "ESI request:" << url << ":" << parameters;
                 qDebug() << "Retries" << retries;
 
                 showReplyDebugInfo(reply);
+                mRateLimiter.processReply(url, reply);
+                finishRequest(url);
 
                 const auto error = reply.error();
                 if (Q_UNLIKELY(error != QNetworkReply::NoError))
@@ -762,26 +902,67 @@ namespace Evernus
                 }
                 else
                 {
-                    const auto data = reply.readAll();
-                    if (mLogReplies)
-                        qDebug() << url << data;
-
-                    TaggedInvoke<ResultTag>::invoke(data, reply, continuation);
+                    processReply<T, ResultTag>(reply, cacheKey, continuation, [=] {
+                        get<T, ResultTag>(charId, url, parameters, continuation, retries, importingCitadels, citadelId);
+                    });
                 }
-            }, [=](const auto &error) {
+            }), wrapAuthenticatedCallback(url, [=](const auto &error) {
+                finishRequest(url);
                 TaggedInvoke<ResultTag>::invoke(error, continuation);
-            });
+            }), mResponseCache.getETag(cacheKey));
         });
     }
 
+    template<class T, class ResultTag, class Retry>
+    void ESIInterface::processReply(QNetworkReply &reply, const QString &cacheKey, const T &continuation, const Retry &retry) const
+    {
+        const auto expires = getExpireTime(reply);
+
+        if (reply.attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == notModifiedCode)
+        {
+            const auto cached = mResponseCache.getResponse(cacheKey);
+            if (Q_UNLIKELY(!cached))
+            {
+                // evicted while the request was in flight - without an ETag, the next attempt gets the full body
+                qDebug() << "Cached response missing for" << cacheKey;
+                retry();
+                return;
+            }
+
+            qDebug() << "Not modified:" << cacheKey;
+
+            const auto pages = (reply.hasRawHeader(QByteArrayLiteral("X-Pages"))) ? (getPageCount(reply)) : (cached->mPages);
+            TaggedInvoke<ResultTag>::invoke(cached->mData, expires, pages, continuation);
+            return;
+        }
+
+        const auto data = reply.readAll();
+        if (mLogReplies)
+            qDebug() << cacheKey << data;
+
+        const auto pages = getPageCount(reply);
+
+        const auto eTag = reply.rawHeader(QByteArrayLiteral("ETag"));
+        if (!eTag.isEmpty())
+            mResponseCache.store(cacheKey, eTag, data, pages);
+
+        TaggedInvoke<ResultTag>::invoke(data, expires, pages, continuation);
+    }
+
     template<class T>
     void ESIInterface::post(Character::IdType charId, const QString &url, const QVariant &data, T &&errorCallback) const
     {
-        runNowOrLater([=] {
-            mOAuth.post(charId, ESIUrls::esiUrl + url, data, [=](auto &reply) {
+        runScheduled(charId, url, [=] {
+            errorCallback(getCancelledError());
+        }, [=] {
+            ++mAuthenticatedRequests[getPriority(url)];
+
+            mOAuth.post(charId, ESIUrls::esiUrl + url, data, wrapAuthenticatedCallback(url, [=](auto &reply) {
                 qDebug() << "ESI request:" << url << ":" << data;
 
                 showReplyDebugInfo(reply);
+                mRateLimiter.processReply(url, reply);
+                finishRequest(url);
 
                 const auto error = reply.error();
                 if (Q_UNLIKELY(error != QNetworkReply::NoError))
@@ -812,16 +993,19 @@ namespace Evernus
                     if (!error.mMessage.isEmpty())
                         errorCallback(error);
                 }
-            }, [=](const auto &error) {
+            }), wrapAuthenticatedCallback(url, [=](const auto &error) {
+                finishRequest(url);
                 errorCallback(error);
-            });
+            }));
         });
     }
 
     template<class T>
-    void ESIInterface::post(const QString &url, const QVariant &data, ErrorCallback errorCallback, T &&resultCallback) const
+    void ESIInterface::post(const QString &url, const QVariant &data, PostErrorCallback errorCallback, T &&resultCallback) const
     {
-        runNowOrLater([=] {
+        runScheduled(Character::invalidId, url, [=] {
+            errorCallback(getCancelledError(), 0);
+        }, [=] {
             auto reply = mOAuth.post(ESIUrls::esiUrl + url, data);
             Q_ASSERT(reply != nullptr);
 
@@ -833,6 +1017,8 @@ namespace Evernus
                 reply->deleteLater();
 
                 showReplyDebugInfo(*reply);
+                mRateLimiter.processReply(url, *reply);
+                finishRequest(url);
 
                 const auto error = reply->error();
                 if (Q_UNLIKELY(error != QNetworkReply::NoError))
@@ -850,7 +1036,7 @@ namespace Evernus
                     }
                     else
                     {
-                        errorCallback(parsedError);
+                        errorCallback(parsedError, httpStatus);
                     }
                 }
                 else
@@ -861,7 +1047,7 @@ namespace Evernus
 
                     const auto error = getError(resultText);
                     if (!error.mMessage.isEmpty())
-                        errorCallback(error);
+                        errorCallback(error, 0);
                     else
                         resultCallback(resultText);
                 }
@@ -893,11 +1079,55 @@ namespace Evernus
         mErrorLimiter.addCallback(std::move(callback), std::chrono::seconds{errorTimeout});
     }
 
+    void ESIInterface::schedulePageRequest(const QString &url, PageRequest request) const
+    {
+        runNowOrLater([=] {
+            mPageRequestLimiter.schedule(this, getHost(url), request);
+        });
+    }
+
+    void ESIInterface::finishPageRequest(const QString &url) const
+    {
+        mPageRequestLimiter.finish(this, getHost(url));
+    }
+
     uint ESIInterface::getNumRetries() const
     {
         return mSettings.value(NetworkSettings::maxRetriesKey, NetworkSettings::maxRetriesDefault).toUInt();
     }
 
+    ESIRequestScheduler::Priority ESIInterface::getPriority(const QString &url) const
+    {
+        // anything opening windows in the client is a direct user action, whoever sends it
+        return (url.contains(QLatin1String("/ui/"))) ? (ESIRequestScheduler::Priority::Interactive) : (mPriority);
+    }
+
+    template<class T, class U>
+    void ESIInterface::runScheduled(Character::IdType charId, const QString &url, T cancel, U callback) const
+    {
+        runNowOrLater([=, cancel = std::move(cancel), callback = std::move(callback)] {
+            const auto priority = getPriority(url);
+            mScheduler.schedule(this, priority, charId, [=] {
+                ++mActiveRequests[priority];
+                mRateLimiter.schedule(this, url, priority, callback, [=] {
+                    finishRequest(url);
+                    cancel();
+                });
+            }, cancel);
+        });
+    }
+
+    void ESIInterface::finishRequest(const QString &url) const
+    {
+        const auto priority = getPriority(url);
+
+        auto &active = mActiveRequests[priority];
+        Q_ASSERT(active > 0);
+
+        --active;
+        mScheduler.finish(priority);
+    }
+
     template<class T>
     void ESIInterface::runNowOrLater(T callback) const
     {
@@ -949,6 +1179,27 @@ namespace Evernus
         return reply.rawHeader(QByteArrayLiteral("X-Pages")).toUInt();
     }
 
+    bool ESIInterface::isEmptyPage(const QJsonDocument &page)
+    {
+        return page.array().isEmpty();
+    }
+
+    bool ESIInterface::isEmptyPage(const QByteArray &page)
+    {
+        const auto trimmed = page.trimmed();
+        return trimmed.isEmpty() || trimmed == "[]";
+    }
+
+    QString ESIInterface::getHost(const QString &url)
+    {
+        return QUrl{ESIUrls::esiUrl + url}.host();
+    }
+
+    QString ESIInterface::getCancelledError()
+    {
+        return tr("Request cancelled.");
+    }
+
     void ESIInterface::showReplyDebugInfo(const QNetworkReply &reply)
     {
         qDebug() << "X-Esi-Ab-Test:" << reply.rawHeader(QByteArrayLiteral("X-Esi-Ab-Test"));
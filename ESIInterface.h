@@ -16,14 +16,19 @@
 
 #include <unordered_map>
 #include <functional>
+#include <atomic>
 #include <mutex>
+#include <map>
 
 #include <optional>
 
 #include <QSettings>
 #include <QDateTime>
 #include <QString>
+#include <QHash>
 
+#include "ESIPageRequestLimiter.h"
+#include "ESIRequestScheduler.h"
 #include "WalletJournalEntry.h"
 #include "WalletTransaction.h"
 #include "Character.h"
@@ -39,6 +44,8 @@ namespace Evernus
 {
     class ESIInterfaceErrorLimiter;
     class CitadelAccessCache;
+    class ESIResponseCache;
+    class ESIRateLimiter;
     class ESIOAuth;
 
     class ESIInterface final
@@ -51,23 +58,32 @@ namespace Evernus
         using PersistentCallback = std::function<void (T &&data, const QString &error)>;
         using JsonCallback = std::function<void (QJsonDocument &&data, const QString &error, const QDateTime &expires)>;
         using PaginatedCallback = std::function<void (QJsonDocument &&data, bool atEnd, const QString &error, const QDateTime &expires)>;
+        // undecoded page bodies, for consumers with their own parsers
+        using PaginatedRawCallback = std::function<void (QByteArray &&data, bool atEnd, const QString &error, const QDateTime &expires)>;
         using ErrorCallback = std::function<void (const QString &error)>;
         using StringCallback = std::function<void (QString &&data, const QString &error, const QDateTime &expires)>;  // https://bugreports.qt.io/browse/QTBUG-62502
         using PersistentStringCallback = PersistentCallback<QString>;
         using PersistentJsonCallback = PersistentCallback<QJsonDocument>;
+        // invalidIds is set when the whole batch has been rejected because some of the ids cannot be resolved
+        using NamesCallback = std::function<void (QJsonDocument &&data, const QString &error, bool invalidIds)>;
 
         ESIInterface(CitadelAccessCache &citadelAccessCache,
                      ESIInterfaceErrorLimiter &errorLimiter,
+                     ESIResponseCache &responseCache,
+                     ESIRateLimiter &rateLimiter,
+                     ESIRequestScheduler &scheduler,
+                     ESIPageRequestLimiter &pageRequestLimiter,
                      ESIOAuth &oauth,
+                     ESIRequestScheduler::Priority priority,
                      QObject *parent = nullptr);
         ESIInterface(const ESIInterface &) = default;
         ESIInterface(ESIInterface &&) = default;
-        virtual ~ESIInterface() = default;
+        virtual ~ESIInterface();
 
-        void fetchMarketOrders(uint regionId, EveType::IdType typeId, const PaginatedCallback &callback) const;
-        void fetchMarketOrders(uint regionId, const PaginatedCallback &callback) const;
+        void fetchMarketOrders(uint regionId, EveType::IdType typeId, const PaginatedRawCallback &callback) const;
+        void fetchMarketOrders(uint regionId, const PaginatedRawCallback &callback) const;
         void fetchMarketHistory(uint regionId, EveType::IdType typeId, const JsonCallback &callback) const;
-        void fetchCitadelMarketOrders(quint64 citadelId, Character::IdType charId, const PaginatedCallback &callback) const;
+        void fetchCitadelMarketOrders(quint64 citadelId, Character::IdType charId, const PaginatedRawCallback &callback) const;
         void fetchCharacterAssets(Character::IdType charId, const PaginatedCallback &callback) const;
         void fetchCorporationAssets(Character::IdType charId, quint64 corpId, const PaginatedCallback &callback) const;
         void fetchCharacter(Character::IdType charId, const JsonCallback &callback) const;
@@ -100,7 +116,7 @@ namespace Evernus
         void fetchCorporationBlueprints(Character::IdType charId, quint64 corpId, const PaginatedCallback &callback) const;
         void fetchCharacterMiningLedger(Character::IdType charId, const PaginatedCallback &callback) const;
         void fetchGenericName(quint64 id, const PersistentStringCallback &callback) const;
-        void fetchGenericNames(const std::vector<quint64> &ids, const PersistentJsonCallback &callback) const;
+        void fetchGenericNames(const std::vector<quint64> &ids, const NamesCallback &callback) const;
         void fetchMarketPrices(const JsonCallback &callback) const;
         void fetchIndustryCostIndices(const JsonCallback &callback) const;
         void fetchSovereigntyStructures(const JsonCallback &callback) const;
@@ -109,6 +125,9 @@ namespace Evernus
 
         void setDestination(quint64 locationId, Character::IdType charId, const ErrorCallback &errorCallback) const;
 
+        // requests still waiting for the scheduler end with an error; so do further pages of running paginated requests
+        void cancelPendingRequests() const;
+
         ESIInterface &operator =(const ESIInterface &) = default;
         ESIInterface &operator =(ESIInterface &&) = default;
 
@@ -124,8 +143,11 @@ namespace Evernus
             operator QString() const;
         };
 
+        using PostErrorCallback = std::function<void (const QString &error, int httpStatus)>;
+
         struct JsonTag {};
         struct PaginatedJsonTag {};
+        struct PaginatedRawTag {};
         struct StringTag {};
 
         template<class Tag>
@@ -133,22 +155,39 @@ namespace Evernus
 
         struct PaginatedContext;
 
+        using PageRequest = ESIPageRequestLimiter::Request;
+
+        static const int notModifiedCode = 304;
         static const int errorLimitCode = 420;
         static const int requestThrottledCode = 429;
+        static const int invalidIdsCode = 404;
 
         CitadelAccessCache &mCitadelAccessCache;
         ESIInterfaceErrorLimiter &mErrorLimiter;
+        ESIResponseCache &mResponseCache;
+        ESIRateLimiter &mRateLimiter;
+        ESIRequestScheduler &mScheduler;
+        ESIPageRequestLimiter &mPageRequestLimiter;
         ESIOAuth &mOAuth;
 
+        ESIRequestScheduler::Priority mPriority = ESIRequestScheduler::Priority::CharacterSync;
+
         bool mLogReplies = false;
 
         mutable std::mutex mObjectStateMutex;
 
         QSettings mSettings;
 
-        template<class T>
+        // scheduler slots taken by this interface, given back on destruction
+        mutable std::map<ESIRequestScheduler::Priority, uint> mActiveRequests;
+        // part of the above held by requests handed to ESIOAuth - those give their slots back themselves, even if this interface is gone
+        mutable std::map<ESIRequestScheduler::Priority, uint> mAuthenticatedRequests;
+
+        mutable std::atomic_uint mCancelGeneration{0};
+
+        template<class ResultTag = PaginatedJsonTag, class T>
         void fetchPaginatedData(const QString &url, QVariantMap parameters, uint page, T &&continuation, const std::shared_ptr<PaginatedContext> &context) const;
-        template<class T>
+        template<class ResultTag = PaginatedJsonTag, class T>
         void fetchPaginatedData(Character::IdType charId,
                                 const QString &url,
                                 uint page,
@@ -168,18 +207,35 @@ namespace Evernus
                  bool importingCitadels = false,
                  quint64 citadelId = 0) const;
 
+        // handles a successful reply; a 304 replays the cached body
+        template<class T, class ResultTag, class Retry>
+        void processReply(QNetworkReply &reply, const QString &cacheKey, const T &continuation, const Retry &retry) const;
+
         template<class T>
         void post(Character::IdType charId, const QString &url, const QVariant &data, T &&errorCallback) const;
+        // httpStatus is 0 for cancelled requests and errors reported in successful replies
         template<class T>
-        void post(const QString &url, const QVariant &data, ErrorCallback errorCallback, T &&resultCallback) const;
+        void post(const QString &url, const QVariant &data, PostErrorCallback errorCallback, T &&resultCallback) const;
 
         template<class T>
         void schedulePostErrorLimitRequest(T &&callback, const QNetworkReply &reply) const;
 
+        void schedulePageRequest(const QString &url, PageRequest request) const;
+        void finishPageRequest(const QString &url) const;
+
         uint getNumRetries() const;
 
+        ESIRequestScheduler::Priority getPriority(const QString &url) const;
+
         template<class T>
         void runNowOrLater(T callback) const;
+        // like runNowOrLater(), but queued by the scheduler and paced by the rate limiter; finishRequest() has to follow the reply
+        template<class T, class U>
+        void runScheduled(Character::IdType charId, const QString &url, T cancel, U callback) const;
+        void finishRequest(const QString &url) const;
+        // ESIOAuth can call back after this interface has been destroyed; both callbacks of a request have to be wrapped
+        template<class T>
+        auto wrapAuthenticatedCallback(const QString &url, T callback) const;
 
         template<class T, class U>
         static auto createPaginatedCallback(uint page, T continuation, U fetchNext, std::shared_ptr<PaginatedContext> context);
@@ -189,6 +245,11 @@ namespace Evernus
         static QDateTime getExpireTime(const QNetworkReply &reply);
         static uint getPageCount(const QNetworkReply &reply);
 
+        static bool isEmptyPage(const QJsonDocument &page);
+        static bool isEmptyPage(const QByteArray &page);
+        static QString getHost(const QString &url);
+        static QString getCancelledError();
+
         static void showReplyDebugInfo(const QNetworkReply &reply);
 
         static bool shouldThrottle(int httpStatus);
@@ -19,6 +19,7 @@
 #include <QDir>
 
 #include "ImportSettings.h"
+#include "CacheSettings.h"
 
 #include "ESIInterfaceManager.h"
 
@@ -32,12 +33,13 @@ namespace Evernus
         : QObject{parent}
         , mClientId{clientId}
         , mClientSecret{clientSecret}
+        , mResponseCache{getResponseCacheBudget()}
         , mOAuth{std::move(clientId), std::move(clientSecret), characterRepo, dataProvider}
-        , mInterface{mCitadelAccessCache, mErrorLimiter, mOAuth}
     {
         connect(&mOAuth, &ESIOAuth::ssoAuthRequested, this, &ESIInterfaceManager::ssoAuthRequested);
 
         readCitadelAccessCache();
+        readResponseCache();
     }
 
     ESIInterfaceManager::~ESIInterfaceManager()
@@ -45,6 +47,7 @@ namespace Evernus
         try
         {
             writeCitadelAccessCache();
+            writeResponseCache();
         }
         catch (...)
         {
@@ -71,9 +74,14 @@ namespace Evernus
         mOAuth.setTokens(id, accessToken, refreshToken);
     }
 
-    const ESIInterface &ESIInterfaceManager::getInterface() const
+    std::unique_ptr<ESIInterface, QObjectDeleteLaterDeleter> ESIInterfaceManager::createInterface(ESIRequestScheduler::Priority priority)
     {
-        return mInterface;
+        std::unique_ptr<ESIInterface, QObjectDeleteLaterDeleter> interface{
+            new ESIInterface{mCitadelAccessCache, mErrorLimiter, mResponseCache, mRateLimiter, mRequestScheduler, mPageRequestLimiter, mOAuth, priority}
+        };
+        interface->moveToThread(thread());
+
+        return interface;
     }
 
     const CitadelAccessCache &ESIInterfaceManager::getCitadelAccessCache() const noexcept
@@ -86,6 +94,21 @@ namespace Evernus
         return mCitadelAccessCache;
     }
 
+    CacheStats ESIInterfaceManager::getResponseCacheStats() const
+    {
+        return mResponseCache.getStats();
+    }
+
+    ESIRateLimiter::Stats ESIInterfaceManager::getRateLimiterStats() const
+    {
+        return mRateLimiter.getStats();
+    }
+
+    std::vector<ESIRequestScheduler::PriorityStats> ESIInterfaceManager::getRequestSchedulerStats() const
+    {
+        return mRequestScheduler.getStats();
+    }
+
     QString ESIInterfaceManager::getClientId() const
     {
         return mClientId;
@@ -96,6 +119,13 @@ namespace Evernus
         return mClientSecret;
     }
 
+    void ESIInterfaceManager::handleNewPreferences()
+    {
+        mRateLimiter.handleNewPreferences();
+        mRequestScheduler.handleNewPreferences();
+        mPageRequestLimiter.handleNewPreferences();
+    }
+
     void ESIInterfaceManager::readCitadelAccessCache()
     {
         QFile cacheFile{getCachePath()};
@@ -121,8 +151,37 @@ namespace Evernus
             stream << mCitadelAccessCache;
     }
 
+    void ESIInterfaceManager::readResponseCache()
+    {
+        QFile cacheFile{getResponseCachePath()};
+        QDataStream stream{&cacheFile};
+
+        if (cacheFile.open(QIODevice::ReadOnly))
+            stream >> mResponseCache;
+    }
+
+    void ESIInterfaceManager::writeResponseCache()
+    {
+        QFile cacheFile{getResponseCachePath()};
+        QDataStream stream{&cacheFile};
+
+        if (cacheFile.open(QIODevice::WriteOnly))
+            stream << mResponseCache;
+    }
+
     QString ESIInterfaceManager::getCachePath()
     {
         return QDir{QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/data")}.filePath(QStringLiteral("citadel_access"));
     }
+
+    QString ESIInterfaceManager::getResponseCachePath()
+    {
+        return QDir{QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/data")}.filePath(QStringLiteral("esi_responses"));
+    }
+
+    std::size_t ESIInterfaceManager::getResponseCacheBudget()
+    {
+        QSettings settings;
+        return settings.value(CacheSettings::esiResponseBudgetKey, CacheSettings::esiResponseBudgetDefault).toULongLong() * 1024 * 1024;
+    }
 }
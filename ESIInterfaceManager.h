@@ -14,13 +14,20 @@
  */
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <QDateTime>
 #include <QObject>
 #include <QString>
 
 #include "QObjectDeleteLaterDeleter.h"
 #include "ESIInterfaceErrorLimiter.h"
+#include "ESIPageRequestLimiter.h"
+#include "ESIRequestScheduler.h"
 #include "CitadelAccessCache.h"
+#include "ESIResponseCache.h"
+#include "ESIRateLimiter.h"
 #include "ESIInterface.h"
 #include "Character.h"
 #include "ESIOAuth.h"
@@ -55,14 +62,21 @@ namespace Evernus
         void cancelSsoAuth(Character::IdType charId);
         void setTokens(Character::IdType id, const QString &accessToken, const QString &refreshToken);
 
-        const ESIInterface &getInterface() const;
+        // every requester gets its own interface, so its requests can be prioritized and cancelled together
+        std::unique_ptr<ESIInterface, QObjectDeleteLaterDeleter> createInterface(ESIRequestScheduler::Priority priority);
 
         const CitadelAccessCache &getCitadelAccessCache() const noexcept;
         CitadelAccessCache &getCitadelAccessCache() noexcept;
 
+        CacheStats getResponseCacheStats() const;
+        ESIRateLimiter::Stats getRateLimiterStats() const;
+        std::vector<ESIRequestScheduler::PriorityStats> getRequestSchedulerStats() const;
+
         QString getClientId() const;
         QString getClientSecret() const;
 
+        void handleNewPreferences();
+
         ESIInterfaceManager &operator =(const ESIInterfaceManager &) = delete;
         ESIInterfaceManager &operator =(ESIInterfaceManager &&) = default;
 
@@ -75,13 +89,20 @@ namespace Evernus
 
         CitadelAccessCache mCitadelAccessCache;
         ESIInterfaceErrorLimiter mErrorLimiter;
+        ESIResponseCache mResponseCache;
+        ESIRateLimiter mRateLimiter;
+        ESIRequestScheduler mRequestScheduler;
+        ESIPageRequestLimiter mPageRequestLimiter;
         ESIOAuth mOAuth;
 
-        ESIInterface mInterface;
-
         void readCitadelAccessCache();
         void writeCitadelAccessCache();
 
+        void readResponseCache();
+        void writeResponseCache();
+
         static QString getCachePath();
+        static QString getResponseCachePath();
+        static std::size_t getResponseCacheBudget();
     };
 }
@@ -22,7 +22,6 @@
 
 #include <QFutureWatcher>
 #include <QNetworkReply>
-#include <QJsonDocument>
 #include <QApplication>
 #include <QMessageBox>
 #include <QJsonObject>
@@ -35,6 +34,7 @@
 
 #include "SovereigntyStructure.h"
 #include "ESIInterfaceManager.h"
+#include "ESIMarketOrderParser.h"
 #include "EveDataProvider.h"
 #include "NetworkSettings.h"
 #include "ExternalOrder.h"
@@ -53,10 +53,12 @@ namespace Evernus
 
     ESIManager::ESIManager(const EveDataProvider &dataProvider,
                            ESIInterfaceManager &interfaceManager,
+                           ESIRequestScheduler::Priority priority,
                            QObject *parent)
         : QObject{parent}
         , mDataProvider{dataProvider}
         , mInterfaceManager{interfaceManager}
+        , mInterface{mInterfaceManager.createInterface(priority)}
     {
         QSettings settings;
         mFirstTimeCitadelOrderImport = settings.value(firstTimeCitadelOrderImportKey, mFirstTimeCitadelOrderImport).toBool();
@@ -563,30 +565,41 @@ namespace Evernus
         });
     }
 
-    void ESIManager::fetchGenericNames(const std::vector<quint64> &ids, const PesistentDataCallback<std::unordered_map<quint64, QString>> &callback) const
+    void ESIManager::fetchGenericNames(const std::vector<quint64> &ids, const NamesCallback &callback) const
     {
-        const auto maxPerRequest = 1000;
+        const auto maxPerRequest = 1000u;
+
+        if (ids.empty())
+        {
+            callback({}, {}, false);
+            return;
+        }
 
         struct SharedState
         {
-            std::unordered_map<quint64, QString> mResult;
+            NameMap mResult;
             QString mError;
+            bool mInvalidIds = false;
             bool mEmittedError = false;
+            std::size_t mRemainingRequests = 0;
         };
 
         auto state = std::make_shared<SharedState>();
-        auto current = 0u;
+        state->mRemainingRequests = (ids.size() + maxPerRequest - 1) / maxPerRequest;
 
-        const auto transformCallback = [=, totalSize = ids.size()](auto &&data, const auto &error) {
+        const auto transformCallback = [=](auto &&data, const auto &error, auto invalidIds) {
             if (state->mError.isEmpty() && !error.isEmpty())
+            {
                 state->mError = error;
+                state->mInvalidIds = invalidIds;
+            }
 
             if (!state->mError.isEmpty())
             {
                 if (!state->mEmittedError)
                 {
                     state->mEmittedError = true;
-                    callback({}, state->mError);
+                    callback({}, state->mError, state->mInvalidIds);
                 }
 
                 return;
@@ -601,20 +614,18 @@ namespace Evernus
                 return std::make_pair(static_cast<quint64>(nameObj.value(QStringLiteral("id")).toDouble()), nameObj.value(QStringLiteral("name")).toString());
             });
 
-            if (state->mResult.size() == totalSize)
-                callback(std::move(state->mResult), {});
+            // count requests rather than names - ids without a name would otherwise stall the callback
+            if (--state->mRemainingRequests == 0)
+                callback(std::move(state->mResult), {}, false);
         };
 
-        for (; current < ids.size() / maxPerRequest; ++current)
+        for (auto begin = 0u; begin < ids.size(); begin += maxPerRequest)
         {
             getInterface().fetchGenericNames(
-                std::vector<quint64>(std::begin(ids) + current * maxPerRequest, std::min(std::end(ids), std::begin(ids) + (current + 1) * maxPerRequest)),
+                std::vector<quint64>(std::begin(ids) + begin, std::begin(ids) + std::min<std::size_t>(begin + maxPerRequest, ids.size())),
                 transformCallback
             );
         }
-
-        if (current < ids.size())
-            getInterface().fetchGenericNames(std::vector<quint64>(std::begin(ids) + current * maxPerRequest, std::end(ids)), transformCallback);
     }
 
     void ESIManager::fetchCharacterContracts(Character::IdType charId, const ContractCallback &callback) const
@@ -778,6 +789,11 @@ namespace Evernus
         });
     }
 
+    void ESIManager::cancelPendingRequests() const
+    {
+        getInterface().cancelPendingRequests();
+    }
+
     void ESIManager::fetchCharacterWalletTransactions(Character::IdType charId,
                                                       const std::optional<WalletTransaction::IdType> &fromId,
                                                       WalletTransaction::IdType tillId,
@@ -812,69 +828,93 @@ namespace Evernus
         );
     }
 
-    ExternalOrder ESIManager::getExternalOrderFromJson(const QJsonObject &object, uint regionId, const QDateTime &updateTime) const
+    ESIManager::ExternalOrderList ESIManager::parseMarketOrders(const QByteArray &data, uint regionId) const
     {
-        const auto range = object.value(QStringLiteral("range")).toString();
+        ExternalOrderList orders;
 
-        ExternalOrder order;
+        // blacklisted citadels end with no data at all
+        if (data.isEmpty())
+            return orders;
 
-        order.setId(object.value(QStringLiteral("order_id")).toDouble()); // https://bugreports.qt.io/browse/QTBUG-28560
-        order.setType((object.value(QStringLiteral("is_buy_order")).toBool()) ? (ExternalOrder::Type::Buy) : (ExternalOrder::Type::Sell));
-        order.setTypeId(object.value(QStringLiteral("type_id")).toDouble());
-        order.setStationId(object.value(QStringLiteral("location_id")).toDouble());
-        order.setRegionId(regionId);
+        const auto updateTime = QDateTime::currentDateTimeUtc();
 
-        if (object.contains(QStringLiteral("system_id")))
-            order.setSolarSystemId(object.value(QStringLiteral("system_id")).toDouble());
-        else
-            order.setSolarSystemId(mDataProvider.getStationSolarSystemId(order.getStationId()));
-
-        if (range == "station")
-            order.setRange(ExternalOrder::rangeStation);
-        else if (range == "system")
-            order.setRange(ExternalOrder::rangeSystem);
-        else if (range == "region")
-            order.setRange(ExternalOrder::rangeRegion);
-        else
-            order.setRange(range.toShort());
+        ESIMarketOrderParser parser{regionId, updateTime};
+        if (Q_UNLIKELY(!parser.parse(data, orders)))
+        {
+            qWarning() << "Unexpected market order page format, falling back to generic parsing.";
+            parser.parseJson(data, orders);
+        }
 
-        order.setUpdateTime(updateTime);
-        order.setPrice(object.value(QStringLiteral("price")).toDouble());
-        order.setVolumeEntered(object.value(QStringLiteral("volume_total")).toInt());
-        order.setVolumeRemaining(object.value(QStringLiteral("volume_remain")).toInt());
-        order.setMinVolume(object.value(QStringLiteral("min_volume")).toInt());
-        order.setIssued(getDateTimeFromString(object.value(QStringLiteral("issued")).toString()));
-        order.setDuration(object.value(QStringLiteral("duration")).toInt());
+        for (auto &order : orders)
+        {
+            // citadel orders come without system
+            if (order.getSolarSystemId() == 0)
+                order.setSolarSystemId(mDataProvider.getStationSolarSystemId(order.getStationId()));
+        }
 
-        return order;
+        return orders;
     }
 
-    ESIInterface::PaginatedCallback ESIManager::getMarketOrderCallback(uint regionId, const MarketOrderCallback &callback) const
+    ESIInterface::PaginatedRawCallback ESIManager::getMarketOrderCallback(uint regionId, const MarketOrderCallback &callback) const
     {
-        auto orders = std::make_shared<std::vector<ExternalOrder>>();
-        return [=, orders = std::move(orders)](auto &&data, auto atEnd, const auto &error, const auto &expires) {
+        struct Context
+        {
+            ExternalOrderList mOrders;
+            uint mPendingPages = 0;
+            bool mAtEnd = false;
+            bool mFailed = false;
+            QDateTime mExpires;
+        };
+
+        auto context = std::make_shared<Context>();
+        return [=, context = std::move(context)](auto &&data, auto atEnd, const auto &error, const auto &expires) {
+            if (context->mFailed)
+                return;
+
             if (Q_UNLIKELY(!error.isEmpty()))
             {
+                context->mFailed = true;
                 callback({}, error, expires);
                 return;
             }
 
-            const auto items = data.array();
-            const auto curSize = orders->size();
-            orders->resize(curSize + items.size());
+            if (atEnd)
+            {
+                context->mAtEnd = true;
+                context->mExpires = expires;
+            }
 
-            const auto updateTime = QDateTime::currentDateTimeUtc();
+            ++context->mPendingPages;
 
-            std::atomic_size_t nextIndex{curSize};
+            // pages are parsed on the pool and gathered back on this thread, in whatever order they finish
+            auto pageOrders = std::make_shared<ExternalOrderList>();
+            auto watcher = new QFutureWatcher<void>{};
 
-            const auto parseItem = [&](const auto &item) {
-                (*orders)[nextIndex++] = getExternalOrderFromJson(item.toObject(), regionId, updateTime);
-            };
+            connect(watcher, &QFutureWatcher<void>::finished, watcher, [=] {
+                watcher->deleteLater();
 
-            QtConcurrent::blockingMap(items, parseItem);
+                --context->mPendingPages;
+                if (context->mFailed)
+                    return;
 
-            if (atEnd)
-                callback(std::move(*orders), {}, expires);
+                if (context->mOrders.empty())
+                {
+                    context->mOrders = std::move(*pageOrders);
+                }
+                else
+                {
+                    context->mOrders.insert(std::end(context->mOrders),
+                                            std::make_move_iterator(std::begin(*pageOrders)),
+                                            std::make_move_iterator(std::end(*pageOrders)));
+                }
+
+                if (context->mAtEnd && context->mPendingPages == 0)
+                    callback(std::move(context->mOrders), {}, context->mExpires);
+            });
+
+            watcher->setFuture(QtConcurrent::run([=, data = std::move(data)] {
+                *pageOrders = parseMarketOrders(data, regionId);
+            }));
         };
     }
 
@@ -1316,7 +1356,8 @@ namespace Evernus
 
     const ESIInterface &ESIManager::getInterface() const
     {
-        return mInterfaceManager.getInterface();
+        Q_ASSERT(mInterface);
+        return *mInterface;
     }
 
     short ESIManager::getMarketOrderRangeFromString(const QString &range)
@@ -25,6 +25,7 @@
 #include <QString>
 #include <QDate>
 
+#include "QObjectDeleteLaterDeleter.h"
 #include "IndustryCostIndices.h"
 #include "MarketHistoryEntry.h"
 #include "WalletJournalEntry.h"
@@ -42,7 +43,6 @@
 #include "Contract.h"
 #include "EveType.h"
 
-class QJsonObject;
 class QDateTime;
 
 namespace Evernus
@@ -79,11 +79,14 @@ namespace Evernus
         using BlueprintCallback = Callback<BlueprintList>;
         using HistoryMap = std::map<QDate, MarketHistoryEntry>;
         using NameMap = std::unordered_map<quint64, QString>;
+        // invalidIds is set when a batch has been rejected because some of the ids cannot be resolved
+        using NamesCallback = std::function<void (NameMap &&data, const QString &error, bool invalidIds)>;
 
         static const QString loginUrl;
 
         ESIManager(const EveDataProvider &dataProvider,
                    ESIInterfaceManager &interfaceManager,
+                   ESIRequestScheduler::Priority priority = ESIRequestScheduler::Priority::CharacterSync,
                    QObject *parent = nullptr);
         ESIManager(const ESIManager &) = default;
         ESIManager(ESIManager &&) = default;
@@ -132,7 +135,7 @@ namespace Evernus
         void fetchCorporationBlueprints(Character::IdType charId, quint64 corpId, const BlueprintCallback &callback) const;
         void fetchCharacterMiningLedger(Character::IdType charId, const Callback<MiningLedgerList> &callback) const;
         void fetchGenericName(quint64 id, const PesistentDataCallback<QString> &callback) const;
-        void fetchGenericNames(const std::vector<quint64> &ids, const PesistentDataCallback<std::unordered_map<quint64, QString>> &callback) const;
+        void fetchGenericNames(const std::vector<quint64> &ids, const NamesCallback &callback) const;
         void fetchMarketPrices(const Callback<MarketPrices> &callback) const;
         void fetchIndustryCostIndices(const Callback<IndustryCostIndices> &callback) const;
         void fetchSovereigntyStructures(const Callback<SovereigntyStructureList> &callback) const;
@@ -141,6 +144,8 @@ namespace Evernus
 
         void setDestination(quint64 locationId, Character::IdType charId) const;
 
+        void cancelPendingRequests() const;
+
         ESIManager &operator =(const ESIManager &) = default;
         ESIManager &operator =(ESIManager &&) = default;
 
@@ -156,6 +161,8 @@ namespace Evernus
 
         ESIInterfaceManager &mInterfaceManager;
 
+        std::unique_ptr<ESIInterface, QObjectDeleteLaterDeleter> mInterface;
+
         void fetchCharacterWalletTransactions(Character::IdType charId,
                                               const std::optional<WalletTransaction::IdType> &fromId,
                                               WalletTransaction::IdType tillId,
@@ -169,8 +176,8 @@ namespace Evernus
                                                 std::shared_ptr<WalletTransactions> &&transactions,
                                                 const WalletTransactionsCallback &callback) const;
 
-        ExternalOrder getExternalOrderFromJson(const QJsonObject &object, uint regionId, const QDateTime &updateTime) const;
-        ESIInterface::PaginatedCallback getMarketOrderCallback(uint regionId, const MarketOrderCallback &callback) const;
+        ExternalOrderList parseMarketOrders(const QByteArray &data, uint regionId) const;
+        ESIInterface::PaginatedRawCallback getMarketOrderCallback(uint regionId, const MarketOrderCallback &callback) const;
         ESIInterface::JsonCallback getMarketOrdersCallback(Character::IdType charId, const MarketOrdersCallback &callback) const;
         ESIInterface::PaginatedCallback getAssetListCallback(Character::IdType charId, const AssetCallback &callback) const;
         ESIInterface::JsonCallback getContractCallback(const ContractCallback &callback) const;
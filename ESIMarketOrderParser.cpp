@@ -0,0 +1,550 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstring>
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QByteArray>
+#include <QString>
+
+#include "ESIMarketOrderParser.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        // raw bytes of a JSON token, pointing into the parsed buffer
+        struct Token
+        {
+            const char *mBegin = nullptr;
+            const char *mEnd = nullptr;
+
+            inline std::size_t size() const noexcept
+            {
+                return mEnd - mBegin;
+            }
+        };
+
+        class Cursor final
+        {
+        public:
+            Cursor(const char *begin, const char *end) noexcept
+                : mPos{begin}
+                , mEnd{end}
+            {
+            }
+
+            bool atEnd() noexcept
+            {
+                skipWhitespace();
+                return mPos == mEnd;
+            }
+
+            bool consume(char c) noexcept
+            {
+                skipWhitespace();
+                if (mPos == mEnd || *mPos != c)
+                    return false;
+
+                ++mPos;
+                return true;
+            }
+
+            // escapes are left as they are
+            bool readString(Token &token) noexcept
+            {
+                if (!consume('"'))
+                    return false;
+
+                token.mBegin = mPos;
+                while (mPos != mEnd && *mPos != '"')
+                {
+                    if (*mPos == '\\' && ++mPos == mEnd)
+                        return false;
+
+                    ++mPos;
+                }
+
+                if (mPos == mEnd)
+                    return false;
+
+                token.mEnd = mPos++;
+                return true;
+            }
+
+            bool readNumber(Token &token) noexcept
+            {
+                skipWhitespace();
+
+                token.mBegin = mPos;
+                while (mPos != mEnd && isNumberChar(*mPos))
+                    ++mPos;
+
+                token.mEnd = mPos;
+                return token.mBegin != token.mEnd;
+            }
+
+            bool readBool(bool &value) noexcept
+            {
+                if (readLiteral("true"))
+                {
+                    value = true;
+                    return true;
+                }
+                if (readLiteral("false"))
+                {
+                    value = false;
+                    return true;
+                }
+
+                return false;
+            }
+
+            bool skipValue(uint depth = 0) noexcept
+            {
+                if (depth > maxDepth)
+                    return false;
+
+                skipWhitespace();
+                if (mPos == mEnd)
+                    return false;
+
+                Token token;
+
+                switch (*mPos) {
+                case '"':
+                    return readString(token);
+                case '{':
+                    ++mPos;
+                    if (consume('}'))
+                        return true;
+
+                    do
+                    {
+                        if (!readString(token) || !consume(':') || !skipValue(depth + 1))
+                            return false;
+                    } while (consume(','));
+
+                    return consume('}');
+                case '[':
+                    ++mPos;
+                    if (consume(']'))
+                        return true;
+
+                    do
+                    {
+                        if (!skipValue(depth + 1))
+                            return false;
+                    } while (consume(','));
+
+                    return consume(']');
+                case 't':
+                case 'f':
+                    {
+                        bool value = false;
+                        return readBool(value);
+                    }
+                case 'n':
+                    return readLiteral("null");
+                default:
+                    return readNumber(token);
+                }
+            }
+
+        private:
+            static const uint maxDepth = 32;
+
+            const char *mPos = nullptr;
+            const char *mEnd = nullptr;
+
+            void skipWhitespace() noexcept
+            {
+                while (mPos != mEnd && (*mPos == ' ' || *mPos == '\n' || *mPos == '\r' || *mPos == '\t'))
+                    ++mPos;
+            }
+
+            template<std::size_t N>
+            bool readLiteral(const char (&literal)[N]) noexcept
+            {
+                skipWhitespace();
+                if (static_cast<std::size_t>(mEnd - mPos) < N - 1 || std::memcmp(mPos, literal, N - 1) != 0)
+                    return false;
+
+                mPos += N - 1;
+                return true;
+            }
+
+            static inline bool isNumberChar(char c) noexcept
+            {
+                return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+            }
+        };
+
+        template<std::size_t N>
+        inline bool equals(const Token &token, const char (&value)[N]) noexcept
+        {
+            return token.size() == N - 1 && std::memcmp(token.mBegin, value, N - 1) == 0;
+        }
+
+        // ids, volumes and durations are plain non-negative integers
+        template<class T>
+        bool toUnsigned(const Token &token, T &value) noexcept
+        {
+            if (token.size() == 0)
+                return false;
+
+            quint64 result = 0;
+            for (auto c = token.mBegin; c != token.mEnd; ++c)
+            {
+                if (*c < '0' || *c > '9')
+                    return false;
+
+                const auto digit = static_cast<quint64>(*c - '0');
+                if (result > (std::numeric_limits<quint64>::max() - digit) / 10)
+                    return false;
+
+                result = result * 10 + digit;
+            }
+
+            if (result > static_cast<quint64>(std::numeric_limits<T>::max()))
+                return false;
+
+            value = static_cast<T>(result);
+            return true;
+        }
+
+        bool toDouble(const Token &token, double &value)
+        {
+            // exact powers, so mantissa / power is correctly rounded
+            static const double powersOf10[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+            // anything below 2^53 is exact
+            const auto maxDigits = 15;
+
+            auto c = token.mBegin;
+
+            const auto negative = c != token.mEnd && *c == '-';
+            if (negative)
+                ++c;
+
+            quint64 mantissa = 0;
+            auto digits = 0;
+            auto fractionDigits = 0;
+            auto inFraction = false;
+
+            for (; c != token.mEnd; ++c)
+            {
+                if (*c >= '0' && *c <= '9')
+                {
+                    mantissa = mantissa * 10 + (*c - '0');
+                    ++digits;
+
+                    if (inFraction)
+                        ++fractionDigits;
+                }
+                else if (*c == '.' && !inFraction)
+                {
+                    inFraction = true;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            if (c == token.mEnd && digits > 0 && digits <= maxDigits)
+            {
+                value = static_cast<double>(mantissa) / powersOf10[fractionDigits];
+                if (negative)
+                    value = -value;
+
+                return true;
+            }
+
+            // exponents and long mantissas are rare enough to take the slow path
+            auto ok = false;
+            value = QByteArray::fromRawData(token.mBegin, static_cast<int>(token.size())).toDouble(&ok);
+            return ok;
+        }
+
+        template<class T, class Setter>
+        bool readUnsigned(Cursor &cursor, Setter setter)
+        {
+            Token token;
+            T value = 0;
+
+            if (!cursor.readNumber(token) || !toUnsigned(token, value))
+                return false;
+
+            setter(value);
+            return true;
+        }
+
+        short getRange(const Token &range) noexcept
+        {
+            if (equals(range, "station"))
+                return ExternalOrder::rangeStation;
+            if (equals(range, "solarsystem") || equals(range, "system"))
+                return ExternalOrder::rangeSystem;
+            if (equals(range, "region"))
+                return ExternalOrder::rangeRegion;
+
+            // number of jumps
+            short jumps = 0;
+            return (toUnsigned(range, jumps)) ? (jumps) : (0);
+        }
+
+        bool parseOrder(Cursor &cursor, ExternalOrder &order)
+        {
+            if (!cursor.consume('{'))
+                return false;
+            if (cursor.consume('}'))
+                return true;
+
+            do
+            {
+                Token key;
+                if (!cursor.readString(key) || !cursor.consume(':'))
+                    return false;
+
+                auto ok = true;
+
+                if (equals(key, "order_id"))
+                {
+                    ok = readUnsigned<ExternalOrder::IdType>(cursor, [&](auto value) {
+                        order.setId(value);
+                    });
+                }
+                else if (equals(key, "type_id"))
+                {
+                    ok = readUnsigned<ExternalOrder::TypeIdType>(cursor, [&](auto value) {
+                        order.setTypeId(value);
+                    });
+                }
+                else if (equals(key, "location_id"))
+                {
+                    ok = readUnsigned<quint64>(cursor, [&](auto value) {
+                        order.setStationId(value);
+                    });
+                }
+                else if (equals(key, "system_id"))
+                {
+                    ok = readUnsigned<uint>(cursor, [&](auto value) {
+                        order.setSolarSystemId(value);
+                    });
+                }
+                else if (equals(key, "volume_total"))
+                {
+                    ok = readUnsigned<uint>(cursor, [&](auto value) {
+                        order.setVolumeEntered(value);
+                    });
+                }
+                else if (equals(key, "volume_remain"))
+                {
+                    ok = readUnsigned<uint>(cursor, [&](auto value) {
+                        order.setVolumeRemaining(value);
+                    });
+                }
+                else if (equals(key, "min_volume"))
+                {
+                    ok = readUnsigned<uint>(cursor, [&](auto value) {
+                        order.setMinVolume(value);
+                    });
+                }
+                else if (equals(key, "duration"))
+                {
+                    ok = readUnsigned<short>(cursor, [&](auto value) {
+                        order.setDuration(value);
+                    });
+                }
+                else if (equals(key, "is_buy_order"))
+                {
+                    auto buy = false;
+                    ok = cursor.readBool(buy);
+                    order.setType((buy) ? (ExternalOrder::Type::Buy) : (ExternalOrder::Type::Sell));
+                }
+                else if (equals(key, "price"))
+                {
+                    Token value;
+                    auto price = 0.;
+                    ok = cursor.readNumber(value) && toDouble(value, price);
+                    order.setPrice(price);
+                }
+                else if (equals(key, "range"))
+                {
+                    Token value;
+                    ok = cursor.readString(value);
+                    order.setRange(getRange(value));
+                }
+                else if (equals(key, "issued"))
+                {
+                    Token value;
+                    ok = cursor.readString(value);
+                    if (ok)
+                    {
+                        auto issued = ESIMarketOrderParser::parseDateTime(value.mBegin, value.mEnd);
+                        if (Q_UNLIKELY(!issued.isValid()))
+                            issued = QDateTime::currentDateTimeUtc();   // just to be safe
+
+                        order.setIssued(issued);
+                    }
+                }
+                else
+                {
+                    ok = cursor.skipValue();
+                }
+
+                if (Q_UNLIKELY(!ok))
+                    return false;
+            } while (cursor.consume(','));
+
+            return cursor.consume('}');
+        }
+    }
+
+    ESIMarketOrderParser::ESIMarketOrderParser(uint regionId, QDateTime updateTime)
+        : mRegionId{regionId}
+        , mUpdateTime{std::move(updateTime)}
+    {
+    }
+
+    bool ESIMarketOrderParser::parse(const QByteArray &data, std::vector<ExternalOrder> &orders) const
+    {
+        const auto originalSize = orders.size();
+        const auto fail = [&] {
+            orders.erase(std::next(std::begin(orders), originalSize), std::end(orders));
+            return false;
+        };
+
+        // orders are flat objects, so this is exact for well-formed pages
+        orders.reserve(originalSize + std::count(std::begin(data), std::end(data), '{'));
+
+        Cursor cursor{data.constData(), data.constData() + data.size()};
+        if (!cursor.consume('['))
+            return fail();
+
+        if (!cursor.consume(']'))
+        {
+            do
+            {
+                auto &order = orders.emplace_back();
+                if (!parseOrder(cursor, order))
+                    return fail();
+
+                order.setRegionId(mRegionId);
+                order.setUpdateTime(mUpdateTime);
+            } while (cursor.consume(','));
+
+            if (!cursor.consume(']'))
+                return fail();
+        }
+
+        if (!cursor.atEnd())
+            return fail();
+
+        return true;
+    }
+
+    void ESIMarketOrderParser::parseJson(const QByteArray &data, std::vector<ExternalOrder> &orders) const
+    {
+        const auto items = QJsonDocument::fromJson(data).array();
+        orders.reserve(orders.size() + items.size());
+
+        for (const auto &item : items)
+            orders.emplace_back(parseJsonOrder(item.toObject(), mRegionId, mUpdateTime));
+    }
+
+    QDateTime ESIMarketOrderParser::parseDateTime(const char *begin, const char *end)
+    {
+        const auto length = end - begin;
+        const auto getNumber = [=](int pos, int count) {
+            auto result = 0;
+            for (auto i = pos; i < pos + count; ++i)
+            {
+                if (begin[i] < '0' || begin[i] > '9')
+                    return -1;
+
+                result = result * 10 + (begin[i] - '0');
+            }
+
+            return result;
+        };
+
+        if (length == 20 && begin[4] == '-' && begin[7] == '-' && begin[10] == 'T' && begin[13] == ':' && begin[16] == ':' && begin[19] == 'Z')
+        {
+            const auto year = getNumber(0, 4);
+            const auto month = getNumber(5, 2);
+            const auto day = getNumber(8, 2);
+            const auto hour = getNumber(11, 2);
+            const auto minute = getNumber(14, 2);
+            const auto second = getNumber(17, 2);
+
+            // the year check also rejects non-digits, which give -1
+            if (year > 0 && QDate::isValid(year, month, day) && QTime::isValid(hour, minute, second))
+                return QDateTime{QDate{year, month, day}, QTime{hour, minute, second}, Qt::UTC};
+        }
+
+        auto dt = QDateTime::fromString(QString::fromLatin1(begin, static_cast<int>(length)), Qt::ISODate);
+        if (dt.isValid())
+            dt.setTimeSpec(Qt::UTC);
+
+        return dt;
+    }
+
+    ExternalOrder ESIMarketOrderParser::parseJsonOrder(const QJsonObject &object, uint regionId, const QDateTime &updateTime)
+    {
+        const auto range = object.value(QStringLiteral("range")).toString();
+
+        ExternalOrder order;
+
+        order.setId(object.value(QStringLiteral("order_id")).toDouble()); // https://bugreports.qt.io/browse/QTBUG-28560
+        order.setType((object.value(QStringLiteral("is_buy_order")).toBool()) ? (ExternalOrder::Type::Buy) : (ExternalOrder::Type::Sell));
+        order.setTypeId(object.value(QStringLiteral("type_id")).toDouble());
+        order.setStationId(object.value(QStringLiteral("location_id")).toDouble());
+        order.setSolarSystemId(object.value(QStringLiteral("system_id")).toDouble());
+        order.setRegionId(regionId);
+
+        if (range == QLatin1String{"station"})
+            order.setRange(ExternalOrder::rangeStation);
+        else if (range == QLatin1String{"solarsystem"} || range == QLatin1String{"system"})
+            order.setRange(ExternalOrder::rangeSystem);
+        else if (range == QLatin1String{"region"})
+            order.setRange(ExternalOrder::rangeRegion);
+        else
+            order.setRange(range.toShort());
+
+        auto issued = QDateTime::fromString(object.value(QStringLiteral("issued")).toString(), Qt::ISODate);
+        if (Q_UNLIKELY(!issued.isValid()))
+            issued = QDateTime::currentDateTimeUtc();   // just to be safe
+        else
+            issued.setTimeSpec(Qt::UTC);
+
+        order.setUpdateTime(updateTime);
+        order.setPrice(object.value(QStringLiteral("price")).toDouble());
+        order.setVolumeEntered(object.value(QStringLiteral("volume_total")).toInt());
+        order.setVolumeRemaining(object.value(QStringLiteral("volume_remain")).toInt());
+        order.setMinVolume(object.value(QStringLiteral("min_volume")).toInt());
+        order.setIssued(issued);
+        order.setDuration(object.value(QStringLiteral("duration")).toInt());
+
+        return order;
+    }
+}
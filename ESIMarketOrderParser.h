@@ -0,0 +1,55 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <vector>
+
+#include <QDateTime>
+
+#include "ExternalOrder.h"
+
+class QJsonObject;
+class QByteArray;
+
+namespace Evernus
+{
+    // decodes market order pages straight from reply bytes, without building a JSON document
+    class ESIMarketOrderParser final
+    {
+    public:
+        ESIMarketOrderParser(uint regionId, QDateTime updateTime);
+        ESIMarketOrderParser(const ESIMarketOrderParser &) = default;
+        ESIMarketOrderParser(ESIMarketOrderParser &&) = default;
+        ~ESIMarketOrderParser() = default;
+
+        // appends orders to the list; on malformed input returns false and leaves the list untouched
+        // orders without system_id get 0 as solar system
+        bool parse(const QByteArray &data, std::vector<ExternalOrder> &orders) const;
+        // generic QJsonDocument decoding for pages parse() rejects; same conventions, appends whatever decodes
+        void parseJson(const QByteArray &data, std::vector<ExternalOrder> &orders) const;
+
+        ESIMarketOrderParser &operator =(const ESIMarketOrderParser &) = default;
+        ESIMarketOrderParser &operator =(ESIMarketOrderParser &&) = default;
+
+        // fast path for "yyyy-MM-ddTHH:mm:ssZ", anything else goes through Qt::ISODate; invalid values give an invalid date
+        static QDateTime parseDateTime(const char *begin, const char *end);
+
+        static ExternalOrder parseJsonOrder(const QJsonObject &object, uint regionId, const QDateTime &updateTime);
+
+    private:
+        uint mRegionId = 0;
+        QDateTime mUpdateTime;
+    };
+}
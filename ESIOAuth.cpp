@@ -60,25 +60,46 @@ namespace Evernus
         settings.endGroup();
     }
 
-    void ESIOAuth::get(Character::IdType charId, const QUrl &url, QVariantMap parameters, NetworkReplyCallback callback, AuthErrorCallback errorCallback)
+    void ESIOAuth::get(Character::IdType charId,
+                       QUrl url,
+                       QVariantMap parameters,
+                       NetworkReplyCallback callback,
+                       AuthErrorCallback errorCallback,
+                       const QByteArray &eTag)
     {
         prepareParameters(parameters);
-        makeRequest(charId, url, std::move(callback), std::move(errorCallback), [=, parameters = std::move(parameters)] {
-            return getOAuth(charId).get(url, parameters);
+
+        if (eTag.isEmpty())
+        {
+            makeRequest(charId, url, std::move(callback), std::move(errorCallback), [=, parameters = std::move(parameters)] {
+                return getOAuth(charId).get(url, parameters);
+            });
+            return;
+        }
+
+        addQueryParameters(url, parameters);
+        makeRequest(charId, url, std::move(callback), std::move(errorCallback), [=] {
+            const auto &oauth = getOAuth(charId);
+
+            // done manually, since QAbstractOAuth2::get() gives no way to add conditional headers
+            auto request = prepareRequest(url);
+            request.setRawHeader("Authorization", QStringLiteral("Bearer %1").arg(oauth.token()).toUtf8());
+            request.setRawHeader("If-None-Match", eTag);
+
+            return oauth.networkAccessManager()->get(request);
         });
     }
 
-    QNetworkReply *ESIOAuth::get(QUrl url, QVariantMap parameters)
+    QNetworkReply *ESIOAuth::get(QUrl url, QVariantMap parameters, const QByteArray &eTag)
     {
         prepareParameters(parameters);
+        addQueryParameters(url, parameters);
 
-        QUrlQuery query{url.query()};
-        for (auto param = std::begin(parameters); param != std::end(parameters); ++param)
-            query.addQueryItem(param.key(), param.value().toString());
-
-        url.setQuery(query);
+        auto request = prepareRequest(url);
+        if (!eTag.isEmpty())
+            request.setRawHeader("If-None-Match", eTag);
 
-        const auto reply = mUnauthNetworkAccessManager.get(prepareRequest(url));
+        const auto reply = mUnauthNetworkAccessManager.get(request);
         connect(reply, &QNetworkReply::sslErrors, this, &ESIOAuth::processSslErrors);
 
         return reply;
@@ -310,6 +331,15 @@ namespace Evernus
         }
     }
 
+    void ESIOAuth::addQueryParameters(QUrl &url, const QVariantMap &parameters)
+    {
+        QUrlQuery query{url.query()};
+        for (auto param = std::begin(parameters); param != std::end(parameters); ++param)
+            query.addQueryItem(param.key(), param.value().toString());
+
+        url.setQuery(query);
+    }
+
     QNetworkRequest ESIOAuth::prepareRequest(const QUrl &url)
     {
         QNetworkRequest request{url};
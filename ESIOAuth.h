@@ -53,8 +53,13 @@ namespace Evernus
         ESIOAuth(ESIOAuth &&) = default;
         virtual ~ESIOAuth() = default;
 
-        void get(Character::IdType charId, const QUrl &url, QVariantMap parameters, NetworkReplyCallback callback, AuthErrorCallback errorCallback);
-        QNetworkReply *get(QUrl url, QVariantMap parameters = {});
+        void get(Character::IdType charId,
+                 QUrl url,
+                 QVariantMap parameters,
+                 NetworkReplyCallback callback,
+                 AuthErrorCallback errorCallback,
+                 const QByteArray &eTag = {});
+        QNetworkReply *get(QUrl url, QVariantMap parameters = {}, const QByteArray &eTag = {});
         QNetworkReply *post(QUrl url, const QVariant &data = {});
         void post(Character::IdType charId, QUrl url, const QVariant &data, NetworkReplyCallback callback, AuthErrorCallback errorCallback);
 
@@ -116,6 +121,7 @@ namespace Evernus
 
         void saveRefreshToken(Character::IdType charId);
 
+        static void addQueryParameters(QUrl &url, const QVariantMap &parameters);
         static QNetworkRequest prepareRequest(const QUrl &url);
 
         static void grantOrRefresh(ESIOAuth2CharacterAuthorizationCodeFlow &oauth);
@@ -0,0 +1,153 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <vector>
+
+#include <QStringList>
+#include <QSettings>
+
+#include "NetworkSettings.h"
+
+#include "ESIPageRequestLimiter.h"
+
+namespace Evernus
+{
+    ESIPageRequestLimiter::ESIPageRequestLimiter()
+    {
+        handleNewPreferences();
+    }
+
+    void ESIPageRequestLimiter::schedule(Owner owner, const QString &host, Request request)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+            mHosts[host].mPending.emplace_back(PendingRequest{owner, std::move(request)});
+        }
+
+        dispatchPending(host);
+    }
+
+    void ESIPageRequestLimiter::finish(Owner owner, const QString &host)
+    {
+        release(owner, host);
+        dispatchPending(host);
+    }
+
+    void ESIPageRequestLimiter::discard(Owner owner)
+    {
+        std::vector<QString> freedHosts;
+
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+
+            for (auto &queue : mHosts)
+            {
+                auto &pending = queue.mPending;
+                pending.erase(std::remove_if(std::begin(pending), std::end(pending), [=](const auto &request) {
+                    return request.mOwner == owner;
+                }), std::end(pending));
+            }
+
+            const auto slots = mOwnerSlots.find(owner);
+            if (slots != std::end(mOwnerSlots))
+            {
+                for (auto slot = std::begin(slots->second); slot != std::end(slots->second); ++slot)
+                {
+                    auto &queue = mHosts[slot.key()];
+                    Q_ASSERT(queue.mActive >= slot.value());
+
+                    queue.mActive -= slot.value();
+                    freedHosts.emplace_back(slot.key());
+                }
+
+                mOwnerSlots.erase(slots);
+            }
+        }
+
+        for (const auto &host : freedHosts)
+            dispatchPending(host);
+    }
+
+    void ESIPageRequestLimiter::handleNewPreferences()
+    {
+        QSettings settings;
+        const auto maxActive = std::max(settings.value(NetworkSettings::maxConcurrentPageRequestsKey, NetworkSettings::maxConcurrentPageRequestsDefault).toUInt(), 1u);
+
+        QStringList hosts;
+
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+
+            mMaxActive = maxActive;
+            hosts = mHosts.keys();
+        }
+
+        // more slots might be free now
+        for (const auto &host : hosts)
+            dispatchPending(host);
+    }
+
+    void ESIPageRequestLimiter::dispatchPending(const QString &host)
+    {
+        while (true)
+        {
+            PendingRequest request;
+
+            {
+                std::lock_guard<std::mutex> lock{mQueueMutex};
+
+                auto &queue = mHosts[host];
+                if (queue.mPending.empty() || queue.mActive >= mMaxActive)
+                    return;
+
+                request = std::move(queue.mPending.front());
+                queue.mPending.pop_front();
+
+                ++queue.mActive;
+                ++mOwnerSlots[request.mOwner][host];
+            }
+
+            // the request can finish synchronously, so no lock here
+            if (!request.mRequest())
+                release(request.mOwner, host);
+        }
+    }
+
+    void ESIPageRequestLimiter::release(Owner owner, const QString &host)
+    {
+        std::lock_guard<std::mutex> lock{mQueueMutex};
+
+        // discarded owners have already given their slots back
+        const auto slots = mOwnerSlots.find(owner);
+        if (slots == std::end(mOwnerSlots))
+            return;
+
+        const auto slot = slots->second.find(host);
+        if (slot == std::end(slots->second))
+            return;
+
+        auto &queue = mHosts[host];
+        Q_ASSERT(queue.mActive > 0 && slot.value() > 0);
+
+        --queue.mActive;
+
+        if (--slot.value() == 0)
+        {
+            slots->second.erase(slot);
+            if (slots->second.empty())
+                mOwnerSlots.erase(slots);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <map>
+
+#include <QString>
+#include <QHash>
+
+namespace Evernus
+{
+    // pages of paginated requests share a per-host concurrency limit across all interfaces,
+    // so big fan-outs queue instead of flooding the connection
+    // requests run on the thread calling schedule() or finish(), which for interfaces is always the manager's one
+    class ESIPageRequestLimiter final
+    {
+    public:
+        // returns false if there was nothing to send after all
+        using Request = std::function<bool ()>;
+        using Owner = const void *;
+
+        ESIPageRequestLimiter();
+        ESIPageRequestLimiter(const ESIPageRequestLimiter &) = delete;
+        ESIPageRequestLimiter(ESIPageRequestLimiter &&) = delete;
+        ~ESIPageRequestLimiter() = default;
+
+        // a request which has been sent has to be followed by finish() when its reply is handled
+        void schedule(Owner owner, const QString &host, Request request);
+        void finish(Owner owner, const QString &host);
+
+        // drops queued requests and frees slots of the ones in flight - for owners going away
+        void discard(Owner owner);
+
+        void handleNewPreferences();
+
+        ESIPageRequestLimiter &operator =(const ESIPageRequestLimiter &) = delete;
+        ESIPageRequestLimiter &operator =(ESIPageRequestLimiter &&) = delete;
+
+    private:
+        struct PendingRequest
+        {
+            Owner mOwner = nullptr;
+            Request mRequest;
+        };
+
+        struct HostQueue
+        {
+            uint mActive = 0;
+            std::deque<PendingRequest> mPending;
+        };
+
+        QHash<QString, HostQueue> mHosts;
+        // slots in flight per owner and host
+        std::map<Owner, QHash<QString, uint>> mOwnerSlots;
+        uint mMaxActive = 1;
+
+        std::mutex mQueueMutex;
+
+        void dispatchPending(const QString &host);
+        void release(Owner owner, const QString &host);
+    };
+}
@@ -0,0 +1,377 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include <QtDebug>
+
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QStringList>
+#include <QSettings>
+
+#include "NetworkSettings.h"
+
+#include "ESIRateLimiter.h"
+
+namespace Evernus
+{
+    ESIRateLimiter::ESIRateLimiter(QObject *parent)
+        : QObject{parent}
+    {
+        mDispatchTimer.setSingleShot(true);
+        connect(&mDispatchTimer, &QTimer::timeout, this, &ESIRateLimiter::dispatchPending);
+
+        handleNewPreferences();
+    }
+
+    void ESIRateLimiter::schedule(Owner owner, const QString &url, ESIRequestScheduler::Priority priority, Callback request, Callback cancel)
+    {
+        auto sendNow = false;
+
+        {
+            std::lock_guard<std::mutex> lock{mStateMutex};
+
+            const auto now = Clock::now();
+
+            auto &bucket = getBucket(url);
+            if (bucket.mPending.empty() && getDelay(bucket, now) == Clock::duration::zero())
+            {
+                takeToken(bucket);
+                sendNow = true;
+            }
+            else
+            {
+                if (isErrorLimited(now))
+                    ++mErrorLimitWaits;
+
+                ++bucket.mWaits;
+
+                // the scheduler's order is lost once requests wait for tokens, so keep classes apart here too
+                const auto position = std::upper_bound(std::begin(bucket.mPending), std::end(bucket.mPending), priority, [](auto requested, const auto &pending) {
+                    return requested < pending.mPriority;
+                });
+                bucket.mPending.emplace(position, Bucket::PendingRequest{owner, priority, std::move(request), std::move(cancel), now});
+            }
+        }
+
+        if (sendNow)
+            request();
+        else
+            dispatchPending();
+    }
+
+    void ESIRateLimiter::processReply(const QString &url, const QNetworkReply &reply)
+    {
+        const auto errorLimitRemainHeader = QByteArrayLiteral("X-Esi-Error-Limit-Remain");
+        const auto errorLimitResetHeader = QByteArrayLiteral("X-Esi-Error-Limit-Reset");
+
+        const auto httpStatus = reply.attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const auto now = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock{mStateMutex};
+
+            if (reply.hasRawHeader(errorLimitRemainHeader) && reply.hasRawHeader(errorLimitResetHeader))
+            {
+                mErrorLimitRemain = reply.rawHeader(errorLimitRemainHeader).toUInt();
+                mErrorLimitResetAt = now + std::chrono::seconds{reply.rawHeader(errorLimitResetHeader).toUInt()};
+            }
+
+            if (httpStatus == errorLimitCode)
+                mErrorLimitRemain = 0;
+
+            const auto group = reply.rawHeader(QByteArrayLiteral("X-Ratelimit-Group"));
+            if (!group.isEmpty())
+                mRouteGroups[getRoute(url)] = QString::fromLatin1(group);
+
+            auto &bucket = getBucket(url);
+            refill(bucket, now);
+
+            const auto limitValue = reply.rawHeader(QByteArrayLiteral("X-Ratelimit-Limit"));
+            if (!limitValue.isEmpty())
+            {
+                auto limit = 0u;
+                const auto window = parseWindow(limitValue, limit);
+
+                if (limit > 0 && window.count() > 0)
+                {
+                    if (bucket.mLimit == 0)
+                    {
+                        qDebug() << "Rate limit for" << getBucketName(url) << ":" << limit << "per" << window.count() << "s";
+                        bucket.mTokens = limit;
+                    }
+
+                    bucket.mLimit = limit;
+                    bucket.mWindow = window;
+                }
+            }
+
+            // the server knows about requests we have not counted, e.g. from other clients on the same IP
+            const auto remaining = reply.rawHeader(QByteArrayLiteral("X-Ratelimit-Remaining"));
+            if (!remaining.isEmpty() && bucket.mLimit > 0)
+                bucket.mTokens = std::min(bucket.mTokens, remaining.toDouble());
+
+            if (httpStatus == errorLimitCode || httpStatus == requestThrottledCode)
+            {
+                ++bucket.mRejections;
+
+                if (httpStatus == requestThrottledCode)
+                    bucket.mTokens = std::min(bucket.mTokens, 0.);
+            }
+        }
+
+        // limits might have just got looser
+        dispatchPending();
+    }
+
+    void ESIRateLimiter::cancel(Owner owner)
+    {
+        const auto cancelled = removeOwner(owner);
+
+        qDebug() << "Cancelled rate limited ESI requests:" << cancelled.size();
+
+        for (const auto &callback : cancelled)
+            callback();
+    }
+
+    void ESIRateLimiter::discard(Owner owner)
+    {
+        removeOwner(owner);
+    }
+
+    ESIRateLimiter::Stats ESIRateLimiter::getStats() const
+    {
+        std::lock_guard<std::mutex> lock{mStateMutex};
+
+        const auto now = Clock::now();
+
+        Stats stats;
+        stats.mErrorLimitRemain = mErrorLimitRemain;
+        stats.mErrorLimitReset = (mErrorLimitResetAt > now) ?
+                                 (std::chrono::duration_cast<std::chrono::seconds>(mErrorLimitResetAt - now)) :
+                                 (std::chrono::seconds{0});
+        stats.mErrorLimitWaits = mErrorLimitWaits;
+        stats.mErrorLimitReserve = mErrorLimitReserve;
+
+        stats.mGroups.reserve(mBuckets.size());
+        for (const auto &bucket : mBuckets)
+        {
+            GroupStats group;
+            group.mGroup = bucket.first;
+            group.mTokens = bucket.second.mTokens;
+            group.mLimit = bucket.second.mLimit;
+            group.mWindow = bucket.second.mWindow;
+            group.mRequests = bucket.second.mRequests;
+            group.mWaits = bucket.second.mWaits;
+            group.mRejections = bucket.second.mRejections;
+            group.mTotalWait = bucket.second.mTotalWait;
+            group.mQueued = bucket.second.mPending.size();
+
+            stats.mGroups.emplace_back(std::move(group));
+        }
+
+        return stats;
+    }
+
+    void ESIRateLimiter::handleNewPreferences()
+    {
+        QSettings settings;
+        const auto errorReserve = settings.value(NetworkSettings::errorLimitReserveKey, NetworkSettings::errorLimitReserveDefault).toUInt();
+
+        {
+            std::lock_guard<std::mutex> lock{mStateMutex};
+            mErrorLimitReserve = errorReserve;
+        }
+
+        // a smaller reserve might let held back requests through
+        dispatchPending();
+    }
+
+    void ESIRateLimiter::dispatchPending()
+    {
+        std::vector<Callback> requests;
+
+        {
+            std::lock_guard<std::mutex> lock{mStateMutex};
+
+            const auto now = Clock::now();
+            auto nextDelay = Clock::duration::max();
+
+            for (auto &group : mBuckets)
+            {
+                auto &bucket = group.second;
+                while (!bucket.mPending.empty())
+                {
+                    const auto delay = getDelay(bucket, now);
+                    if (delay != Clock::duration::zero())
+                    {
+                        nextDelay = std::min(nextDelay, delay);
+                        break;
+                    }
+
+                    takeToken(bucket);
+
+                    auto &pending = bucket.mPending.front();
+                    bucket.mTotalWait += std::chrono::duration_cast<std::chrono::milliseconds>(now - pending.mQueued);
+
+                    requests.emplace_back(std::move(pending.mRequest));
+                    bucket.mPending.pop_front();
+                }
+            }
+
+            if (nextDelay != Clock::duration::max())
+                scheduleDispatch(nextDelay);
+        }
+
+        if (!requests.empty())
+            qDebug() << "Dispatching rate limited requests:" << requests.size();
+
+        for (const auto &request : requests)
+            request();
+    }
+
+    ESIRateLimiter::Bucket &ESIRateLimiter::getBucket(const QString &url)
+    {
+        return mBuckets[getBucketName(url)];
+    }
+
+    QString ESIRateLimiter::getBucketName(const QString &url) const
+    {
+        // routes without a known group are paced on their own
+        const auto route = getRoute(url);
+        return mRouteGroups.value(route, route);
+    }
+
+    bool ESIRateLimiter::isErrorLimited(Clock::time_point now) const noexcept
+    {
+        return mErrorLimitRemain <= mErrorLimitReserve && now < mErrorLimitResetAt;
+    }
+
+    ESIRateLimiter::Clock::duration ESIRateLimiter::getDelay(Bucket &bucket, Clock::time_point now) const
+    {
+        // keep a few errors in reserve for the whole window, so a burst of failures cannot cause a lockout
+        if (isErrorLimited(now))
+            return mErrorLimitResetAt - now;
+
+        if (bucket.mLimit == 0)
+            return Clock::duration::zero();
+
+        refill(bucket, now);
+        if (bucket.mTokens >= 1.)
+            return Clock::duration::zero();
+
+        const auto tokensPerSecond = static_cast<double>(bucket.mLimit) / bucket.mWindow.count();
+        const auto delay = std::chrono::duration<double>{(1. - bucket.mTokens) / tokensPerSecond};
+
+        return std::max(std::chrono::duration_cast<Clock::duration>(delay), Clock::duration{1});
+    }
+
+    void ESIRateLimiter::takeToken(Bucket &bucket)
+    {
+        ++bucket.mRequests;
+        if (bucket.mLimit > 0)
+            bucket.mTokens -= 1.;
+    }
+
+    void ESIRateLimiter::scheduleDispatch(Clock::duration delay)
+    {
+        const auto msecs = std::max<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(delay).count() + 1, 1);
+        if (!mDispatchTimer.isActive() || mDispatchTimer.remainingTime() > msecs)
+            mDispatchTimer.start(static_cast<int>(std::min<long long>(msecs, std::numeric_limits<int>::max())));
+    }
+
+    void ESIRateLimiter::refill(Bucket &bucket, Clock::time_point now)
+    {
+        if (bucket.mLimit > 0 && bucket.mWindow.count() > 0 && now > bucket.mLastRefill)
+        {
+            const auto elapsed = std::chrono::duration<double>{now - bucket.mLastRefill}.count();
+            bucket.mTokens = std::min<double>(bucket.mLimit, bucket.mTokens + elapsed * bucket.mLimit / bucket.mWindow.count());
+        }
+
+        bucket.mLastRefill = now;
+    }
+
+    std::vector<ESIRateLimiter::Callback> ESIRateLimiter::removeOwner(Owner owner)
+    {
+        std::vector<Callback> cancelled;
+
+        std::lock_guard<std::mutex> lock{mStateMutex};
+
+        for (auto &bucket : mBuckets)
+        {
+            auto &pending = bucket.second.mPending;
+            const auto removed = std::stable_partition(std::begin(pending), std::end(pending), [=](const auto &request) {
+                return request.mOwner != owner;
+            });
+
+            std::transform(std::make_move_iterator(removed),
+                           std::make_move_iterator(std::end(pending)),
+                           std::back_inserter(cancelled),
+                           [](auto &&request) {
+                return std::move(request.mCancel);
+            });
+
+            pending.erase(removed, std::end(pending));
+        }
+
+        return cancelled;
+    }
+
+    QString ESIRateLimiter::getRoute(const QString &url)
+    {
+        // ids are not part of the route, so /v1/markets/10000002/orders/ and /v1/markets/10000043/orders/ share limits
+        auto segments = url.section(QLatin1Char('?'), 0, 0).split(QLatin1Char('/'));
+        for (auto &segment : segments)
+        {
+            auto isNumber = false;
+            segment.toULongLong(&isNumber);
+
+            if (isNumber)
+                segment = QStringLiteral("{id}");
+        }
+
+        return segments.join(QLatin1Char('/'));
+    }
+
+    std::chrono::seconds ESIRateLimiter::parseWindow(const QByteArray &value, uint &limit)
+    {
+        // e.g. "150/15m"
+        const auto separator = value.indexOf('/');
+        if (separator < 0)
+            return std::chrono::seconds{0};
+
+        limit = value.left(separator).trimmed().toUInt();
+
+        auto window = value.mid(separator + 1).trimmed();
+        if (window.isEmpty())
+            return std::chrono::seconds{0};
+
+        auto multiplier = 1u;
+        switch (window.back()) {
+        case 'h':
+            multiplier *= 60;
+            Q_FALLTHROUGH();
+        case 'm':
+            multiplier *= 60;
+            Q_FALLTHROUGH();
+        case 's':
+            window.chop(1);
+        }
+
+        return std::chrono::seconds{window.toUInt() * multiplier};
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <map>
+
+#include <QString>
+#include <QTimer>
+#include <QHash>
+
+#include "ESIRequestScheduler.h"
+
+class QNetworkReply;
+
+namespace Evernus
+{
+    // proactive counterpart of ESIInterfaceErrorLimiter - paces requests by what reply headers say is left,
+    // instead of waiting for a 420/429 to happen
+    class ESIRateLimiter final
+        : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        using Callback = std::function<void ()>;
+        using Owner = const void *;
+        using Clock = std::chrono::steady_clock;
+
+        struct GroupStats
+        {
+            QString mGroup;
+            double mTokens = 0.;
+            uint mLimit = 0;    // 0 if not known yet
+            std::chrono::seconds mWindow{0};
+            quint64 mRequests = 0;
+            quint64 mWaits = 0;
+            quint64 mRejections = 0;
+            std::chrono::milliseconds mTotalWait{0};
+            std::size_t mQueued = 0;
+        };
+
+        struct Stats
+        {
+            uint mErrorLimitRemain = 0;
+            std::chrono::seconds mErrorLimitReset{0};
+            quint64 mErrorLimitWaits = 0;
+            uint mErrorLimitReserve = 0;
+            std::vector<GroupStats> mGroups;
+        };
+
+        explicit ESIRateLimiter(QObject *parent = nullptr);
+        ESIRateLimiter(const ESIRateLimiter &) = delete;
+        ESIRateLimiter(ESIRateLimiter &&) = delete;
+        virtual ~ESIRateLimiter() = default;
+
+        // runs the request now or as soon as its group and the error budget allow; waiting higher priorities go first
+        // if it gets cancelled while still queued, cancel is run instead
+        void schedule(Owner owner, const QString &url, ESIRequestScheduler::Priority priority, Callback request, Callback cancel);
+        void processReply(const QString &url, const QNetworkReply &reply);
+
+        void cancel(Owner owner);
+        // like cancel(), but nobody is notified - for owners going away
+        void discard(Owner owner);
+
+        Stats getStats() const;
+
+        void handleNewPreferences();
+
+        ESIRateLimiter &operator =(const ESIRateLimiter &) = delete;
+        ESIRateLimiter &operator =(ESIRateLimiter &&) = delete;
+
+    private slots:
+        void dispatchPending();
+
+    private:
+        struct Bucket
+        {
+            struct PendingRequest
+            {
+                Owner mOwner = nullptr;
+                ESIRequestScheduler::Priority mPriority = ESIRequestScheduler::Priority::Background;
+                Callback mRequest;
+                Callback mCancel;
+                Clock::time_point mQueued;
+            };
+
+            double mTokens = 0.;
+            uint mLimit = 0;
+            std::chrono::seconds mWindow{0};
+            Clock::time_point mLastRefill = Clock::now();
+            std::deque<PendingRequest> mPending;
+
+            quint64 mRequests = 0;
+            quint64 mWaits = 0;
+            quint64 mRejections = 0;
+            std::chrono::milliseconds mTotalWait{0};
+        };
+
+        static const uint errorLimitDefault = 100;
+        static const int errorLimitCode = 420;
+        static const int requestThrottledCode = 429;
+
+        // route -> group, as announced by X-Ratelimit-Group
+        QHash<QString, QString> mRouteGroups;
+        std::map<QString, Bucket> mBuckets;
+
+        uint mErrorLimitRemain = errorLimitDefault;
+        uint mErrorLimitReserve = 0;
+        Clock::time_point mErrorLimitResetAt = Clock::now();
+        quint64 mErrorLimitWaits = 0;
+
+        QTimer mDispatchTimer;
+
+        mutable std::mutex mStateMutex;
+
+        Bucket &getBucket(const QString &url);
+        QString getBucketName(const QString &url) const;
+
+        bool isErrorLimited(Clock::time_point now) const noexcept;
+
+        // how long until the bucket can send; zero means now
+        Clock::duration getDelay(Bucket &bucket, Clock::time_point now) const;
+        void takeToken(Bucket &bucket);
+        void scheduleDispatch(Clock::duration delay);
+        std::vector<Callback> removeOwner(Owner owner);
+
+        static void refill(Bucket &bucket, Clock::time_point now);
+        static QString getRoute(const QString &url);
+        static std::chrono::seconds parseWindow(const QByteArray &value, uint &limit);
+    };
+}
@@ -0,0 +1,234 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include <QtDebug>
+
+#include <QSettings>
+
+#include "NetworkSettings.h"
+
+#include "ESIRequestScheduler.h"
+
+namespace Evernus
+{
+    ESIRequestScheduler::ESIRequestScheduler()
+    {
+        handleNewPreferences();
+    }
+
+    void ESIRequestScheduler::schedule(Owner owner, Priority priority, Character::IdType charId, Callback request, Callback cancel)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+
+            auto &queue = mQueues[static_cast<std::size_t>(priority)];
+            queue.mCharacterRequests[charId].emplace_back(PendingRequest{owner, std::move(request), std::move(cancel), Clock::now()});
+        }
+
+        dispatchPending();
+    }
+
+    void ESIRequestScheduler::finish(Priority priority)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+
+            auto &stats = mQueues[static_cast<std::size_t>(priority)].mStats;
+
+            Q_ASSERT(mActive > 0 && stats.mActive > 0);
+
+            --mActive;
+            --stats.mActive;
+        }
+
+        dispatchPending();
+    }
+
+    void ESIRequestScheduler::cancel(Owner owner)
+    {
+        const auto cancelled = removeOwner(owner);
+
+        qDebug() << "Cancelled queued ESI requests:" << cancelled.size();
+
+        for (const auto &callback : cancelled)
+            callback();
+    }
+
+    void ESIRequestScheduler::discard(Owner owner)
+    {
+        removeOwner(owner);
+    }
+
+    std::vector<ESIRequestScheduler::PriorityStats> ESIRequestScheduler::getStats() const
+    {
+        std::lock_guard<std::mutex> lock{mQueueMutex};
+
+        std::vector<PriorityStats> result;
+        result.reserve(priorityCount);
+
+        for (auto priority = 0u; priority < priorityCount; ++priority)
+        {
+            const auto &queue = mQueues[priority];
+
+            auto stats = queue.mStats;
+            stats.mPriority = static_cast<Priority>(priority);
+
+            for (const auto &requests : queue.mCharacterRequests)
+                stats.mQueued += requests.second.size();
+
+            result.emplace_back(std::move(stats));
+        }
+
+        return result;
+    }
+
+    void ESIRequestScheduler::handleNewPreferences()
+    {
+        QSettings settings;
+        const auto maxActive = std::max(settings.value(NetworkSettings::maxConcurrentRequestsKey, NetworkSettings::maxConcurrentRequestsDefault).toUInt(), 1u);
+
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+            mMaxActive = maxActive;
+        }
+
+        // more slots might be free now
+        dispatchPending();
+    }
+
+    QString ESIRequestScheduler::getPriorityName(Priority priority)
+    {
+        switch (priority) {
+        case Priority::Interactive:
+            return QStringLiteral("interactive");
+        case Priority::CharacterSync:
+            return QStringLiteral("character sync");
+        case Priority::BulkMarket:
+            return QStringLiteral("bulk market");
+        case Priority::Background:
+            return QStringLiteral("background");
+        }
+
+        return QString{};
+    }
+
+    void ESIRequestScheduler::dispatchPending()
+    {
+        std::vector<Callback> requests;
+
+        {
+            std::lock_guard<std::mutex> lock{mQueueMutex};
+
+            const auto maxNonInteractive = (mMaxActive > interactiveReserve) ? (mMaxActive - interactiveReserve) : (1u);
+            const auto now = Clock::now();
+
+            while (mActive < mMaxActive)
+            {
+                PendingRequest request;
+                auto found = false;
+
+                for (auto priority = 0u; priority < priorityCount; ++priority)
+                {
+                    if (static_cast<Priority>(priority) != Priority::Interactive && mActive >= maxNonInteractive)
+                        break;
+
+                    auto &queue = mQueues[priority];
+                    if (popNext(queue, request))
+                    {
+                        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(now - request.mQueued);
+
+                        auto &stats = queue.mStats;
+                        ++stats.mRequests;
+                        ++stats.mActive;
+                        stats.mTotalWait += wait;
+                        stats.mMaxWait = std::max(stats.mMaxWait, wait);
+
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found)
+                    break;
+
+                ++mActive;
+                requests.emplace_back(std::move(request.mRequest));
+            }
+        }
+
+        for (const auto &request : requests)
+            request();
+    }
+
+    std::vector<ESIRequestScheduler::Callback> ESIRequestScheduler::removeOwner(Owner owner)
+    {
+        std::vector<Callback> cancelled;
+
+        std::lock_guard<std::mutex> lock{mQueueMutex};
+
+        for (auto &queue : mQueues)
+        {
+            for (auto requests = std::begin(queue.mCharacterRequests); requests != std::end(queue.mCharacterRequests);)
+            {
+                auto &pending = requests->second;
+                const auto removed = std::stable_partition(std::begin(pending), std::end(pending), [=](const auto &request) {
+                    return request.mOwner != owner;
+                });
+
+                std::transform(std::make_move_iterator(removed),
+                               std::make_move_iterator(std::end(pending)),
+                               std::back_inserter(cancelled),
+                               [](auto &&request) {
+                    return std::move(request.mCancel);
+                });
+
+                queue.mStats.mCancelled += std::distance(removed, std::end(pending));
+                pending.erase(removed, std::end(pending));
+
+                if (pending.empty())
+                    requests = queue.mCharacterRequests.erase(requests);
+                else
+                    ++requests;
+            }
+        }
+
+        return cancelled;
+    }
+
+    bool ESIRequestScheduler::popNext(Queue &queue, PendingRequest &request)
+    {
+        if (queue.mCharacterRequests.empty())
+            return false;
+
+        // next character after the last served one
+        auto requests = queue.mCharacterRequests.upper_bound(queue.mLastServed);
+        if (requests == std::end(queue.mCharacterRequests))
+            requests = std::begin(queue.mCharacterRequests);
+
+        auto &pending = requests->second;
+        Q_ASSERT(!pending.empty());
+
+        request = std::move(pending.front());
+        pending.pop_front();
+
+        queue.mLastServed = requests->first;
+
+        if (pending.empty())
+            queue.mCharacterRequests.erase(requests);
+
+        return true;
+    }
+}
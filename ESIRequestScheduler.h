@@ -0,0 +1,114 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <array>
+#include <map>
+
+#include <QString>
+
+#include "Character.h"
+
+namespace Evernus
+{
+    // orders ESI requests by priority class, limiting how many are in flight at once
+    class ESIRequestScheduler final
+    {
+    public:
+        enum class Priority
+        {
+            Interactive,
+            CharacterSync,
+            BulkMarket,
+            Background
+        };
+
+        using Callback = std::function<void ()>;
+        using Owner = const void *;
+        using Clock = std::chrono::steady_clock;
+
+        struct PriorityStats
+        {
+            Priority mPriority = Priority::Background;
+            quint64 mRequests = 0;
+            quint64 mCancelled = 0;
+            std::chrono::milliseconds mTotalWait{0};
+            std::chrono::milliseconds mMaxWait{0};
+            std::size_t mQueued = 0;
+            uint mActive = 0;
+        };
+
+        ESIRequestScheduler();
+        ESIRequestScheduler(const ESIRequestScheduler &) = delete;
+        ESIRequestScheduler(ESIRequestScheduler &&) = delete;
+        ~ESIRequestScheduler() = default;
+
+        // request is run once there is a free slot and has to be followed by finish() when its reply is handled
+        // if it gets cancelled while still queued, cancel is run instead
+        void schedule(Owner owner, Priority priority, Character::IdType charId, Callback request, Callback cancel);
+        void finish(Priority priority);
+
+        void cancel(Owner owner);
+        // like cancel(), but nobody is notified - for owners going away
+        void discard(Owner owner);
+
+        std::vector<PriorityStats> getStats() const;
+
+        void handleNewPreferences();
+
+        ESIRequestScheduler &operator =(const ESIRequestScheduler &) = delete;
+        ESIRequestScheduler &operator =(ESIRequestScheduler &&) = delete;
+
+        static QString getPriorityName(Priority priority);
+
+    private:
+        struct PendingRequest
+        {
+            Owner mOwner = nullptr;
+            Callback mRequest;
+            Callback mCancel;
+            Clock::time_point mQueued;
+        };
+
+        struct Queue
+        {
+            // served round-robin, so one character's sync cannot starve another's
+            std::map<Character::IdType, std::deque<PendingRequest>> mCharacterRequests;
+            Character::IdType mLastServed = Character::invalidId;
+
+            PriorityStats mStats;
+        };
+
+        static const std::size_t priorityCount = static_cast<std::size_t>(Priority::Background) + 1;
+        // slots only interactive requests can take, so they never wait behind bulk traffic
+        static const uint interactiveReserve = 4;
+
+        std::array<Queue, priorityCount> mQueues;
+        uint mActive = 0;
+        uint mMaxActive = 1;
+
+        mutable std::mutex mQueueMutex;
+
+        void dispatchPending();
+        std::vector<Callback> removeOwner(Owner owner);
+
+        static bool popNext(Queue &queue, PendingRequest &request);
+    };
+}
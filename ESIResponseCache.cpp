@@ -0,0 +1,157 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vector>
+
+#include <QtDebug>
+
+#include <QDataStream>
+#include <QStringList>
+
+#include "ESIResponseCache.h"
+
+namespace Evernus
+{
+    ESIResponseCache::ESIResponseCache(std::size_t budget)
+        : mEntries{[](const auto &entry) {
+            return sizeof(entry) + entry.mETag.size() + entry.mData.size();
+        }, budget}
+    {
+    }
+
+    QByteArray ESIResponseCache::getETag(const QString &key)
+    {
+        std::lock_guard<std::mutex> lock{mEntriesMutex};
+
+        const auto entry = mEntries.find(key);
+        return (entry != nullptr) ? (entry->mETag) : (QByteArray{});
+    }
+
+    std::optional<ESIResponseCache::Response> ESIResponseCache::getResponse(const QString &key) const
+    {
+        QByteArray data;
+        uint pages = 0;
+
+        {
+            std::lock_guard<std::mutex> lock{mEntriesMutex};
+
+            const auto entry = mEntries.peek(key);
+            if (entry == nullptr)
+                return std::nullopt;
+
+            // implicitly shared, so decompression can happen outside the lock
+            data = entry->mData;
+            pages = entry->mPages;
+        }
+
+        return Response{qUncompress(data), pages};
+    }
+
+    void ESIResponseCache::store(const QString &key, const QByteArray &eTag, const QByteArray &data, uint pages)
+    {
+        // market pages are highly repetitive JSON, which the default level already shrinks several times
+        Entry entry{eTag, qCompress(data), pages};
+
+        std::lock_guard<std::mutex> lock{mEntriesMutex};
+        mEntries.insert(key, std::move(entry));
+    }
+
+    void ESIResponseCache::remove(const QString &key)
+    {
+        std::lock_guard<std::mutex> lock{mEntriesMutex};
+        mEntries.erase(key);
+    }
+
+    void ESIResponseCache::clear()
+    {
+        std::lock_guard<std::mutex> lock{mEntriesMutex};
+        mEntries.clear();
+    }
+
+    void ESIResponseCache::setBudget(std::size_t budget)
+    {
+        std::lock_guard<std::mutex> lock{mEntriesMutex};
+        mEntries.setBudget(budget);
+    }
+
+    CacheStats ESIResponseCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock{mEntriesMutex};
+        return mEntries.getStats();
+    }
+
+    QString ESIResponseCache::getKey(const QString &url, const QVariantMap &parameters, Character::IdType charId)
+    {
+        // parameters are ordered by name, so equal requests map to the same key
+        QStringList query;
+        for (auto param = std::begin(parameters); param != std::end(parameters); ++param)
+            query << QStringLiteral("%1=%2").arg(param.key()).arg(param.value().toString());
+
+        return QStringLiteral("%1:%2?%3").arg(charId).arg(url).arg(query.join('&'));
+    }
+
+    QDataStream &operator <<(QDataStream &stream, const ESIResponseCache &cache)
+    {
+        std::lock_guard<std::mutex> lock{cache.mEntriesMutex};
+
+        stream
+            << ESIResponseCache::formatVersion
+            << static_cast<quint64>(cache.mEntries.getStats().mEntries);
+
+        // most recently used first
+        cache.mEntries.forEach([&](const auto &key, const auto &entry) {
+            stream << key << entry.mETag << entry.mData << entry.mPages;
+        });
+
+        return stream;
+    }
+
+    QDataStream &operator >>(QDataStream &stream, ESIResponseCache &cache)
+    {
+        quint32 version = 0;
+        quint64 count = 0;
+
+        stream >> version >> count;
+        if (version != ESIResponseCache::formatVersion)
+        {
+            qWarning() << "Ignoring ESI response cache with unknown version:" << version;
+            return stream;
+        }
+
+        std::vector<std::pair<QString, ESIResponseCache::Entry>> entries;
+
+        for (auto i = 0ull; i < count && stream.status() == QDataStream::Ok; ++i)
+        {
+            QString key;
+            ESIResponseCache::Entry entry;
+
+            stream >> key >> entry.mETag >> entry.mData >> entry.mPages;
+            entries.emplace_back(std::move(key), std::move(entry));
+        }
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            qWarning() << "Ignoring truncated ESI response cache.";
+            return stream;
+        }
+
+        std::lock_guard<std::mutex> lock{cache.mEntriesMutex};
+
+        // least recently used go in first, which restores the original order
+        for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry)
+            cache.mEntries.insert(entry->first, std::move(entry->second));
+
+        return stream;
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <optional>
+#include <mutex>
+
+#include <QByteArray>
+#include <QVariant>
+#include <QString>
+
+#include "BoundedCache.h"
+#include "Character.h"
+
+class QDataStream;
+
+namespace Evernus
+{
+    // last ETag and body of ESI GET responses, so repeated requests can be made conditional
+    class ESIResponseCache final
+    {
+    public:
+        struct Response
+        {
+            QByteArray mData;
+            uint mPages = 0;
+        };
+
+        // in bytes of compressed data, 0 for no limit
+        explicit ESIResponseCache(std::size_t budget);
+        ESIResponseCache(const ESIResponseCache &) = delete;
+        ESIResponseCache(ESIResponseCache &&) = delete;
+        ~ESIResponseCache() = default;
+
+        // empty if nothing is cached
+        QByteArray getETag(const QString &key);
+        std::optional<Response> getResponse(const QString &key) const;
+
+        void store(const QString &key, const QByteArray &eTag, const QByteArray &data, uint pages);
+        void remove(const QString &key);
+        void clear();
+
+        void setBudget(std::size_t budget);
+        CacheStats getStats() const;
+
+        ESIResponseCache &operator =(const ESIResponseCache &) = delete;
+        ESIResponseCache &operator =(ESIResponseCache &&) = delete;
+
+        static QString getKey(const QString &url, const QVariantMap &parameters, Character::IdType charId = Character::invalidId);
+
+    private:
+        static const quint32 formatVersion = 1;
+
+        struct Entry
+        {
+            QByteArray mETag;
+            // compressed
+            QByteArray mData;
+            uint mPages = 0;
+        };
+
+        struct KeyHash
+        {
+            inline std::size_t operator ()(const QString &value) const noexcept
+            {
+                return qHash(value);
+            }
+        };
+
+        BoundedCache<QString, Entry, KeyHash> mEntries;
+        mutable std::mutex mEntriesMutex;
+
+        friend QDataStream &operator <<(QDataStream &stream, const ESIResponseCache &cache);
+        friend QDataStream &operator >>(QDataStream &stream, ESIResponseCache &cache);
+    };
+}
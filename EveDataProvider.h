@@ -26,6 +26,7 @@
 
 #include "CitadelRepository.h"
 #include "MarketGroup.h"
+#include "CacheStats.h"
 #include "MetaGroup.h"
 #include "EveType.h"
 
@@ -72,6 +73,7 @@ namespace Evernus
         using Station = std::pair<quint64, QString>;
         using ReprocessingMap = std::unordered_map<EveType::IdType, ReprocessingInfo>;
         using TypeList = std::unordered_set<EveType::IdType>;
+        using LocationList = std::unordered_set<quint64>;
 
         static const uint industrySkillId = 3380;
         static const uint advancedIndustrySkillId = 3388;
@@ -94,12 +96,16 @@ namespace Evernus
         virtual std::shared_ptr<ExternalOrder> getTypeStationSellPrice(EveType::IdType id, quint64 stationId) const = 0;
         virtual std::shared_ptr<ExternalOrder> getTypeRegionSellPrice(EveType::IdType id, uint regionId) const = 0;
         virtual std::shared_ptr<ExternalOrder> getTypeBuyPrice(EveType::IdType id, quint64 stationId, int range = -1) const = 0;
+        // changes whenever external orders for given type and region might have changed; safe to call from any thread
+        virtual quint64 getExternalOrderGeneration(EveType::IdType id, uint regionId) const = 0;
 
         virtual void updateExternalOrders(const std::vector<ExternalOrder> &orders) = 0;
         virtual void clearExternalOrders() = 0;
         virtual void clearExternalOrdersForType(EveType::IdType id) = 0;
 
         virtual QString getLocationName(quint64 id) const = 0;
+        // resolves names, solar systems and regions of many locations at once
+        virtual void precacheLocations(const LocationList &ids) const = 0;
         virtual QString getRegionName(uint id) const = 0;
         virtual QString getSolarSystemName(uint id) const = 0;
 
@@ -122,7 +128,8 @@ namespace Evernus
         virtual const CitadelRepository::EntityList &getCitadels() const = 0;
 
         virtual const ReprocessingMap &getOreReprocessingInfo() const = 0;
-        virtual const ReprocessingMap &getTypeReprocessingInfo(const TypeList &requestedTypes) const = 0;
+        // only requested types with reprocessing materials are present
+        virtual ReprocessingMap getTypeReprocessingInfo(const TypeList &requestedTypes) const = 0;
 
         virtual uint getGroupId(const QString &name) const = 0;
 
@@ -135,6 +142,8 @@ namespace Evernus
         virtual const ManufacturingInfo &getTypeManufacturingInfo(EveType::IdType typeId) const = 0;
         virtual EveType::IdType getBlueprintOutputType(EveType::IdType blueprintId) const = 0;
 
+        virtual CacheStatistics getCacheStatistics() const = 0;
+
         static quint64 getStationIdFromPath(const QVariantList &path);
 
     signals:
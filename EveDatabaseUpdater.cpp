@@ -12,11 +12,14 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <exception>
+
 #include <QNetworkRequest>
 #include <QDesktopWidget>
 #include <QNetworkReply>
 #include <QJsonDocument>
 #include <QApplication>
+#include <QSqlDatabase>
 #include <QJsonObject>
 #include <QMessageBox>
 #include <QSettings>
@@ -25,9 +28,11 @@
 #include <QtDebug>
 
 #include "EveDatabaseConnectionProvider.h"
+#include "PreparedQueryCache.h"
 #include "UpdaterSettings.h"
 #include "ReplyTimeout.h"
 #include "FileDownload.h"
+#include "SdeSnapshot.h"
 
 #include "EveDatabaseUpdater.h"
 
@@ -95,6 +100,8 @@ namespace Evernus
                 QSettings settings;
                 settings.setValue(UpdaterSettings::sdeVersionKey, latestVersion);
 
+                writeSnapshot(latestVersion);
+
                 QCoreApplication::exit();
             }
         });
@@ -133,4 +140,40 @@ namespace Evernus
         else
             QCoreApplication::exit();
     }
+
+    void EveDatabaseUpdater::writeSnapshot(const QString &sdeVersion)
+    {
+        mProgress.setRange(0, 0);
+        mProgress.setWindowTitle(tr("Preparing static data..."));
+        QCoreApplication::processEvents();
+
+        // a private connection, so nothing outlives this application instance
+        const auto connectionName = QStringLiteral("eve-snapshot");
+
+        {
+            auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName);
+            db.setDatabaseName(EveDatabaseConnectionProvider::getDatabasePath());
+            db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+
+            // not fatal - the snapshot is rebuilt on startup when missing
+            if (!db.open())
+            {
+                qWarning() << "Cannot open Eve DB for snapshot.";
+            }
+            else
+            {
+                try
+                {
+                    SdeSnapshot::write(db, sdeVersion);
+                }
+                catch (const std::exception &e)
+                {
+                    qWarning() << "Error writing SDE snapshot:" << e.what();
+                }
+            }
+        }
+
+        PreparedQueryCache::removeConnection(connectionName);
+        QSqlDatabase::removeDatabase(connectionName);
+    }
 }
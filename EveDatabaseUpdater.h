@@ -54,5 +54,6 @@ namespace Evernus
 
         void doUpdate(const QString &latestVersion);
         void checkUpdate(QNetworkReply &reply);
+        void writeSnapshot(const QString &sdeVersion);
     };
 }
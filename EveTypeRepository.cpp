@@ -96,17 +96,8 @@ namespace Evernus
 
     EveTypeRepository::EntityList EveTypeRepository::fetchAllTradeable() const
     {
-        EntityList out;
-
         auto result = exec(QStringLiteral("SELECT * FROM %1 WHERE published = 1 AND marketGroupID IS NOT NULL").arg(getTableName()));
-        const auto size = result.size();
-        if (size != -1)
-            out.reserve(size);
-
-        while (result.next())
-            out.emplace_back(populate(result.record()));
-
-        return out;
+        return populateAll(result);
     }
 
     QStringList EveTypeRepository::getColumns() const
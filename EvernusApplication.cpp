@@ -49,6 +49,8 @@
 #include "ExternalOrderImporterNames.h"
 #include "LanguageSelectDialog.h"
 #include "SovereigntyStructure.h"
+#include "QueryStatistics.h"
+#include "DatabaseWorkerPool.h"
 #include "StatisticsSettings.h"
 #include "UpdaterSettings.h"
 #include "NetworkSettings.h"
@@ -91,6 +93,7 @@ namespace Evernus
         , LMeveDataProvider{}
         , TaskManager{}
         , EveDataManagerProvider{}
+        , CacheStatisticsProvider{}
     {
         QSettings settings;
 
@@ -164,11 +167,9 @@ namespace Evernus
         mCorpContractProvider = std::make_unique<CachingContractProvider>(*mCorpContractRepository);
 
         mDataProvider = std::make_unique<CachingEveDataProvider>(*mEveTypeRepository,
-                                                                 *mMetaGroupRepository,
                                                                  *mExternalOrderRepository,
                                                                  *mMarketOrderRepository,
                                                                  *mCorpMarketOrderRepository,
-                                                                 *mMarketGroupRepository,
                                                                  *mCitadelRepository,
                                                                  *this,
                                                                  mEveDatabaseConnectionProvider);
@@ -182,6 +183,12 @@ namespace Evernus
         precacheCacheTimers();
         precacheUpdateTimers();
 
+        showSplashMessage(tr("Loading static data..."), splash);
+        mDataProvider->precacheSnapshot();
+
+        showSplashMessage(tr("Precaching type data..."), splash);
+        mDataProvider->precacheTypeMetadata();
+
         showSplashMessage(tr("Precaching jump map..."), splash);
         mDataProvider->precacheJumpMap();
 
@@ -247,6 +254,9 @@ namespace Evernus
 
     EvernusApplication::~EvernusApplication()
     {
+        mMainDatabaseConnectionProvider.setWriter(nullptr);
+        mDatabaseWriter.reset();
+        DatabaseWorkerPool::getPool().waitForDone();
         QThreadPool::globalInstance()->waitForDone();
     }
 
@@ -609,6 +619,21 @@ namespace Evernus
         return *mESIManager;
     }
 
+    CacheStatistics EvernusApplication::getCacheStatistics() const
+    {
+        auto result = mDataProvider->getCacheStatistics();
+
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("character market orders"), mCharacterOrderProvider->getCacheStats()});
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("corporation market orders"), mCorpOrderProvider->getCacheStats()});
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("character assets"), mCharacterAssetProvider->getCacheStats()});
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("corporation assets"), mCorpAssetProvider->getCacheStats()});
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("character contracts"), mCharacterContractProvider->getCacheStats()});
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("corporation contracts"), mCorpContractProvider->getCacheStats()});
+        result.emplace_back(CacheStatisticsEntry{QStringLiteral("ESI responses"), mESIInterfaceManager->getResponseCacheStats()});
+
+        return result;
+    }
+
     ESIInterfaceManager &EvernusApplication::getESIInterfaceManager() noexcept
     {
         return *mESIInterfaceManager;
@@ -1223,7 +1248,7 @@ namespace Evernus
             {
                 mDataProvider->clearCitadelCache();
 
-                asyncExecute([=, citadels = std::move(citadels)] {
+                asyncWrite([=, citadels = std::move(citadels)] {
                     QSettings settings;
 
                     mCitadelRepository->replace(std::move(citadels), settings.value(ImportSettings::clearExistingCitadelsKey, ImportSettings::clearExistingCitadelsDefault).toBool());
@@ -1308,7 +1333,7 @@ namespace Evernus
             emit externalOrdersChanged();
         });
 
-        watcher->setFuture(asyncExecute(std::bind(&CachingEveDataProvider::updateExternalOrders, mDataProvider.get(), orders)));
+        watcher->setFuture(asyncWrite(std::bind(&CachingEveDataProvider::updateExternalOrders, mDataProvider.get(), orders)));
     }
 
     void EvernusApplication::handleNewPreferences()
@@ -1324,8 +1349,14 @@ namespace Evernus
         if (settings.value(HttpSettings::enabledKey, HttpSettings::enabledDefault).toBool())
             mHttpSessionManager.start();
 
+        QueryStatistics::setSlowQueryThreshold(
+            settings.value(DbSettings::slowQueryThresholdKey, DbSettings::slowQueryThresholdDefault).toInt());
+        QueryStatistics::setEnabled(
+            settings.value(DbSettings::collectQueryStatisticsKey, DbSettings::collectQueryStatisticsDefault).toBool());
+
         mCharacterItemCostCache.clear();
         mDataProvider->handleNewPreferences();
+        mESIInterfaceManager->handleNewPreferences();
 
         setSmtpSettings();
 
@@ -1643,6 +1674,18 @@ namespace Evernus
         if (!QDir{}.mkpath(DatabaseUtils::getDbPath()))
             BOOST_THROW_EXCEPTION(std::runtime_error{QCoreApplication::translate("DatabaseUtils", "Error creating DB path!").toStdString()});
 
+        QSettings settings;
+        if (settings.value(DbSettings::useWALKey, DbSettings::useWALDefault).toBool())
+        {
+            mDatabaseWriter = std::make_unique<DatabaseWriter>();
+            mMainDatabaseConnectionProvider.setWriter(mDatabaseWriter.get());
+        }
+
+        QueryStatistics::setSlowQueryThreshold(
+            settings.value(DbSettings::slowQueryThresholdKey, DbSettings::slowQueryThresholdDefault).toInt());
+        QueryStatistics::setEnabled(
+            settings.value(DbSettings::collectQueryStatisticsKey, DbSettings::collectQueryStatisticsDefault).toBool());
+
         mCharacterRepository.reset(new CharacterRepository{mMainDatabaseConnectionProvider});
         mItemRepository.reset(new ItemRepository{false, mMainDatabaseConnectionProvider});
         mCorpItemRepository.reset(new ItemRepository{true, mMainDatabaseConnectionProvider});
@@ -1650,7 +1693,10 @@ namespace Evernus
         mCorpAssetListRepository.reset(new AssetListRepository{true, mMainDatabaseConnectionProvider, *mCorpItemRepository});
         mWalletSnapshotRepository.reset(new WalletSnapshotRepository{mMainDatabaseConnectionProvider});
         mCorpWalletSnapshotRepository.reset(new CorpWalletSnapshotRepository{mMainDatabaseConnectionProvider});
-        mExternalOrderRepository.reset(new ExternalOrderRepository{mMainDatabaseConnectionProvider});
+        mExternalOrderRepository.reset(new ExternalOrderRepository{
+            settings.value(DbSettings::partitionExternalOrdersKey, DbSettings::partitionExternalOrdersDefault).toBool(),
+            mMainDatabaseConnectionProvider
+        });
         mAssetValueSnapshotRepository.reset(new AssetValueSnapshotRepository{mMainDatabaseConnectionProvider});
         mCorpAssetValueSnapshotRepository.reset(new CorpAssetValueSnapshotRepository{mMainDatabaseConnectionProvider});
         mWalletJournalEntryRepository.reset(new WalletJournalEntryRepository{false, mMainDatabaseConnectionProvider});
@@ -2619,7 +2665,7 @@ namespace Evernus
     template<class T, class Data>
     QFuture<void> EvernusApplication::asyncBatchStore(const T &repo, Data data, bool hasId)
     {
-        return asyncExecute(std::bind(&T::template batchStore<Data>, &repo, std::move(data), hasId, true));
+        return asyncWrite(std::bind(&T::template batchStore<Data>, &repo, std::move(data), hasId, true));
     }
 
     template<class T, class Data, class Callback>
@@ -2652,6 +2698,19 @@ namespace Evernus
         });
     }
 
+    template<class Func>
+    QFuture<void> EvernusApplication::asyncWrite(Func func)
+    {
+        if (!mDatabaseWriter)
+            return asyncExecute(std::move(func));
+
+        const auto stats = mDatabaseWriter->getStats();
+        qDebug() << "Starting DB write, pending:" << stats.mQueueDepth
+                 << "avg wait:" << stats.mAverageWaitMs << "ms, max wait:" << stats.mMaxWaitMs << "ms";
+
+        return mDatabaseWriter->submit(std::move(func));
+    }
+
     void EvernusApplication::fetchStationTypeIds()
     {
         // get all ids from group 15, and hope it never changes...
@@ -40,6 +40,7 @@
 #include "CachingMarketOrderProvider.h"
 #include "LocationBookmarkRepository.h"
 #include "RegionTypePresetRepository.h"
+#include "CacheStatisticsProvider.h"
 #include "WalletSnapshotRepository.h"
 #include "ExternalOrderRepository.h"
 #include "CachingContractProvider.h"
@@ -75,6 +76,7 @@
 #include "ItemRepository.h"
 #include "TaskConstants.h"
 #include "WalletJournal.h"
+#include "DatabaseWriter.h"
 #include "ESIManager.h"
 #include "TaskManager.h"
 #include "Contracts.h"
@@ -95,6 +97,7 @@ namespace Evernus
         , public LMeveDataProvider
         , public TaskManager
         , public EveDataManagerProvider
+        , public CacheStatisticsProvider
     {
         Q_OBJECT
 
@@ -165,6 +168,8 @@ namespace Evernus
 
         virtual const ESIManager &getESIManager() const override;
 
+        virtual CacheStatistics getCacheStatistics() const override;
+
         ESIInterfaceManager &getESIInterfaceManager() noexcept;
 
         MarketOrderProvider &getMarketOrderProvider() const noexcept;
@@ -357,6 +362,8 @@ namespace Evernus
 
         std::unique_ptr<ESIManager> mESIManager;
 
+        std::unique_ptr<DatabaseWriter> mDatabaseWriter;
+
         std::unordered_set<EveType::IdType> mStationGroupTypeIds;
 
         std::size_t mPendingCharacterContractItemRequests = 0;
@@ -423,6 +430,8 @@ namespace Evernus
 
         template<class Func>
         QFuture<void> asyncExecute(Func func);
+        template<class Func>
+        QFuture<void> asyncWrite(Func func);
 
         void fetchStationTypeIds();
 
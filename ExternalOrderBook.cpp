@@ -0,0 +1,158 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <iterator>
+
+#include "BoundedCache.h"
+
+#include "ExternalOrderBook.h"
+
+namespace Evernus
+{
+    ExternalOrderBook::ExternalOrderBook(const ExternalOrderRepository::EntityList &orders)
+    {
+        for (const auto &order : orders)
+        {
+            if (order->getType() == ExternalOrder::Type::Buy)
+                mBuy.mOrders.emplace_back(order);
+            else
+                mSell.mOrders.emplace_back(order);
+        }
+
+        std::stable_sort(std::begin(mBuy.mOrders), std::end(mBuy.mOrders), [](const auto &a, const auto &b) {
+            return a->getPrice() > b->getPrice();
+        });
+        std::stable_sort(std::begin(mSell.mOrders), std::end(mSell.mOrders), [](const auto &a, const auto &b) {
+            return a->getPrice() < b->getPrice();
+        });
+
+        const auto indexStations = [](auto &side) {
+            for (auto i = 0u; i < side.mOrders.size(); ++i)
+                side.mStationOrders[side.mOrders[i]->getStationId()].emplace_back(i);
+        };
+
+        indexStations(mBuy);
+        indexStations(mSell);
+    }
+
+    ExternalOrderRepository::EntityPtr ExternalOrderBook::getBestOrder(ExternalOrder::Type side, const OrderIdSet &excluded) const
+    {
+        for (const auto &order : getSide(side).mOrders)
+        {
+            if (excluded.find(order->getId()) == std::end(excluded))
+                return order;
+        }
+
+        return {};
+    }
+
+    ExternalOrderRepository::EntityPtr ExternalOrderBook::getBestStationOrder(ExternalOrder::Type side,
+                                                                              quint64 stationId,
+                                                                              const OrderIdSet &excluded) const
+    {
+        const auto &orders = getSide(side);
+
+        const auto station = orders.mStationOrders.find(stationId);
+        if (station == std::end(orders.mStationOrders))
+            return {};
+
+        for (const auto index : station->second)
+        {
+            const auto &order = orders.mOrders[index];
+            if (excluded.find(order->getId()) == std::end(excluded))
+                return order;
+        }
+
+        return {};
+    }
+
+    ExternalOrderRepository::EntityList ExternalOrderBook::getOrders(ExternalOrder::Type side, const OrderIdSet &excluded) const
+    {
+        const auto &orders = getSide(side).mOrders;
+
+        ExternalOrderRepository::EntityList result;
+        result.reserve(orders.size());
+
+        std::copy_if(std::begin(orders), std::end(orders), std::back_inserter(result), [&](const auto &order) {
+            return excluded.find(order->getId()) == std::end(excluded);
+        });
+
+        return result;
+    }
+
+    std::vector<ExternalOrderBook::PriceLevel> ExternalOrderBook::getDepth(ExternalOrder::Type side,
+                                                                           std::size_t maxLevels,
+                                                                           const OrderIdSet &excluded) const
+    {
+        std::vector<PriceLevel> result;
+
+        for (const auto &order : getSide(side).mOrders)
+        {
+            if (excluded.find(order->getId()) != std::end(excluded))
+                continue;
+
+            if (result.empty() || result.back().mPrice != order->getPrice())
+            {
+                if (result.size() == maxLevels)
+                    break;
+
+                result.emplace_back(PriceLevel{order->getPrice(), 0});
+            }
+
+            result.back().mVolume += order->getVolumeRemaining();
+        }
+
+        return result;
+    }
+
+    quint64 ExternalOrderBook::getCumulativeVolume(ExternalOrder::Type side, double priceLimit, const OrderIdSet &excluded) const
+    {
+        quint64 result = 0;
+
+        for (const auto &order : getSide(side).mOrders)
+        {
+            if (!isBetterOrEqual(side, order->getPrice(), priceLimit))
+                break;
+
+            if (excluded.find(order->getId()) == std::end(excluded))
+                result += order->getVolumeRemaining();
+        }
+
+        return result;
+    }
+
+    std::size_t ExternalOrderBook::getMemoryUsage() const noexcept
+    {
+        const auto getSideWeight = [](const Side &side) {
+            auto weight = getSharedListWeight(side.mOrders);
+            for (const auto &station : side.mStationOrders)
+                weight += sizeof(station) + 2 * sizeof(void *) + station.second.capacity() * sizeof(std::size_t);
+
+            return weight;
+        };
+
+        return sizeof(*this) + getSideWeight(mBuy) + getSideWeight(mSell);
+    }
+
+    const ExternalOrderBook::Side &ExternalOrderBook::getSide(ExternalOrder::Type side) const noexcept
+    {
+        return (side == ExternalOrder::Type::Buy) ? (mBuy) : (mSell);
+    }
+
+    bool ExternalOrderBook::isBetterOrEqual(ExternalOrder::Type side, double price, double limit) noexcept
+    {
+        return (side == ExternalOrder::Type::Buy) ? (price >= limit) : (price <= limit);
+    }
+}
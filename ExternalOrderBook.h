@@ -0,0 +1,75 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ExternalOrderRepository.h"
+
+namespace Evernus
+{
+    // external orders of a single type and region, sorted best price first on each side
+    // immutable once built, so one book can be shared by any number of readers
+    class ExternalOrderBook final
+    {
+    public:
+        using OrderIdSet = std::unordered_set<ExternalOrder::IdType>;
+
+        struct PriceLevel
+        {
+            double mPrice = 0.;
+            quint64 mVolume = 0;
+        };
+
+        explicit ExternalOrderBook(const ExternalOrderRepository::EntityList &orders);
+        ExternalOrderBook(const ExternalOrderBook &) = delete;
+        ExternalOrderBook(ExternalOrderBook &&) = default;
+        ~ExternalOrderBook() = default;
+
+        // lookups skip excluded orders; best order getters yield null if nothing matches
+        ExternalOrderRepository::EntityPtr getBestOrder(ExternalOrder::Type side, const OrderIdSet &excluded) const;
+        ExternalOrderRepository::EntityPtr getBestStationOrder(ExternalOrder::Type side,
+                                                               quint64 stationId,
+                                                               const OrderIdSet &excluded) const;
+        ExternalOrderRepository::EntityList getOrders(ExternalOrder::Type side, const OrderIdSet &excluded) const;
+
+        // volume aggregated per price, best prices first
+        std::vector<PriceLevel> getDepth(ExternalOrder::Type side, std::size_t maxLevels, const OrderIdSet &excluded) const;
+        // total volume at prices equal to or better than priceLimit
+        quint64 getCumulativeVolume(ExternalOrder::Type side, double priceLimit, const OrderIdSet &excluded) const;
+
+        std::size_t getMemoryUsage() const noexcept;
+
+        ExternalOrderBook &operator =(const ExternalOrderBook &) = delete;
+        ExternalOrderBook &operator =(ExternalOrderBook &&) = default;
+
+    private:
+        struct Side
+        {
+            ExternalOrderRepository::EntityList mOrders;
+            // positions in mOrders, so each station view keeps price order
+            std::unordered_map<quint64, std::vector<std::size_t>> mStationOrders;
+        };
+
+        Side mBuy;
+        Side mSell;
+
+        const Side &getSide(ExternalOrder::Type side) const noexcept;
+
+        static bool isBetterOrEqual(ExternalOrder::Type side, double price, double limit) noexcept;
+    };
+}
@@ -12,8 +12,14 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <unordered_map>
+#include <iterator>
+#include <map>
+#include <set>
+
 #include <boost/throw_exception.hpp>
 
+#include <QElapsedTimer>
 #include <QSqlRecord>
 #include <QSqlQuery>
 
@@ -24,9 +30,44 @@
 
 namespace Evernus
 {
+    namespace
+    {
+        struct IndexDefinition
+        {
+            QLatin1String mName;
+            QLatin1String mColumns;
+            bool mRegion;   // useless in single region partitions
+            bool mNarrow;   // kept during bulk loads - delta lookups need it
+        };
+
+        const IndexDefinition indexes[] = {
+            { QLatin1String{"type_id"}, QLatin1String{"type_id"}, false, true },
+            { QLatin1String{"type_id_region"}, QLatin1String{"type_id, region_id"}, true, true },
+            { QLatin1String{"solar_system"}, QLatin1String{"solar_system_id"}, false, false },
+            { QLatin1String{"region"}, QLatin1String{"region_id"}, true, false },
+            { QLatin1String{"update_time"}, QLatin1String{"update_time"}, false, false },
+            { QLatin1String{"type_type_id"}, QLatin1String{"type, type_id"}, false, false },
+            { QLatin1String{"type_type_id_location"}, QLatin1String{"type, type_id, location_id"}, false, false },
+            { QLatin1String{"type_type_id_solar_system"}, QLatin1String{"type, type_id, solar_system_id"}, false, false },
+            { QLatin1String{"type_type_id_region"}, QLatin1String{"type, type_id, region_id"}, true, false },
+        };
+    }
+
+    ExternalOrderRepository::ExternalOrderRepository(bool partitioned, const DatabaseConnectionProvider &connectionProvider)
+        : Repository{connectionProvider}
+        , mPartitioned{partitioned}
+    {
+    }
+
     QString ExternalOrderRepository::getTableName() const
     {
-        return QStringLiteral("external_orders");
+        return getBaseTableName();
+    }
+
+    QString ExternalOrderRepository::getReadTableName() const
+    {
+        // when partitioned, reads go through a view over all regions
+        return (mPartitioned) ? (getPartitionViewName()) : (getBaseTableName());
     }
 
     QString ExternalOrderRepository::getIdColumn() const
@@ -34,61 +75,48 @@ namespace Evernus
         return QStringLiteral("id");
     }
 
-    ExternalOrderRepository::EntityPtr ExternalOrderRepository::populate(const QSqlRecord &record) const
+    template<class Row>
+    ExternalOrderRepository::EntityPtr ExternalOrderRepository::decodeRow(const Row &row, const ColumnOrdinals &ordinals) const
     {
-        auto updateDt = record.value(QStringLiteral("update_time")).toDateTime();
+        auto updateDt = row.value(ordinals[UpdateTimeColumn]).toDateTime();
         updateDt.setTimeSpec(Qt::UTC);
 
-        auto issuedDt = record.value(QStringLiteral("issued")).toDateTime();
+        auto issuedDt = row.value(ordinals[IssuedColumn]).toDateTime();
         issuedDt.setTimeSpec(Qt::UTC);
 
-        auto externalOrder = std::make_shared<ExternalOrder>(record.value(QStringLiteral("id")).value<ExternalOrder::IdType>());
-        externalOrder->setType(static_cast<ExternalOrder::Type>(record.value(QStringLiteral("type")).toInt()));
-        externalOrder->setTypeId(record.value(QStringLiteral("type_id")).value<ExternalOrder::TypeIdType>());
-        externalOrder->setStationId(record.value(QStringLiteral("location_id")).toULongLong());
-        externalOrder->setSolarSystemId(record.value(QStringLiteral("solar_system_id")).toUInt());
-        externalOrder->setRegionId(record.value(QStringLiteral("region_id")).toUInt());
-        externalOrder->setRange(record.value(QStringLiteral("range")).toInt());
+        auto externalOrder = std::make_shared<ExternalOrder>(row.value(ordinals[IdColumn]).value<ExternalOrder::IdType>());
+        externalOrder->setType(static_cast<ExternalOrder::Type>(row.value(ordinals[TypeColumn]).toInt()));
+        externalOrder->setTypeId(row.value(ordinals[TypeIdColumn]).value<ExternalOrder::TypeIdType>());
+        externalOrder->setStationId(row.value(ordinals[LocationIdColumn]).toULongLong());
+        externalOrder->setSolarSystemId(row.value(ordinals[SolarSystemIdColumn]).toUInt());
+        externalOrder->setRegionId(row.value(ordinals[RegionIdColumn]).toUInt());
+        externalOrder->setRange(row.value(ordinals[RangeColumn]).toInt());
         externalOrder->setUpdateTime(updateDt);
-        externalOrder->setPrice(record.value(QStringLiteral("value")).toDouble());
-        externalOrder->setVolumeEntered(record.value(QStringLiteral("volume_entered")).toUInt());
-        externalOrder->setVolumeRemaining(record.value(QStringLiteral("volume_remaining")).toUInt());
-        externalOrder->setMinVolume(record.value(QStringLiteral("min_volume")).toUInt());
+        externalOrder->setPrice(row.value(ordinals[ValueColumn]).toDouble());
+        externalOrder->setVolumeEntered(row.value(ordinals[VolumeEnteredColumn]).toUInt());
+        externalOrder->setVolumeRemaining(row.value(ordinals[VolumeRemainingColumn]).toUInt());
+        externalOrder->setMinVolume(row.value(ordinals[MinVolumeColumn]).toUInt());
         externalOrder->setIssued(issuedDt);
-        externalOrder->setDuration(record.value(QStringLiteral("duration")).value<short>());
+        externalOrder->setDuration(row.value(ordinals[DurationColumn]).value<short>());
         externalOrder->setNew(false);
 
         return externalOrder;
     }
 
-    void ExternalOrderRepository::create() const
+    ExternalOrderRepository::EntityPtr ExternalOrderRepository::populate(const QSqlRecord &record) const
     {
-        exec(QStringLiteral("CREATE TABLE IF NOT EXISTS %1 ("
-            "id BIGINT PRIMARY KEY,"
-            "type TINYINT NOT NULL,"
-            "type_id INTEGER NOT NULL,"
-            "location_id BIGINT NOT NULL,"
-            "solar_system_id INTEGER NOT NULL,"
-            "region_id INTEGER NOT NULL,"
-            "range INTEGER NOT NULL,"
-            "update_time DATETIME NOT NULL,"
-            "value DOUBLE NOT NULL,"
-            "volume_entered INTEGER NOT NULL,"
-            "volume_remaining INTEGER NOT NULL,"
-            "min_volume INTEGER NOT NULL,"
-            "issued DATETIME NOT NULL,"
-            "duration INTEGER NOT NULL"
-        ")").arg(getTableName()));
+        return decodeRow(record, getColumnOrdinals(record));
+    }
 
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_type_id ON %1(type_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_type_id_region ON %1(type_id, region_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_solar_system ON %1(solar_system_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_region ON %1(region_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_update_time ON %1(update_time)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_type_type_id ON %1(type, type_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_type_type_id_location ON %1(type, type_id, location_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_type_type_id_solar_system ON %1(type, type_id, solar_system_id)").arg(getTableName()));
-        exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_type_type_id_region ON %1(type, type_id, region_id)").arg(getTableName()));
+    ExternalOrderRepository::EntityPtr ExternalOrderRepository::populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const
+    {
+        return decodeRow(query, ordinals);
+    }
+
+    void ExternalOrderRepository::create() const
+    {
+        createTable(getBaseTableName(), false);
+        setupPartitions();
     }
 
     ExternalOrderRepository::EntityPtr ExternalOrderRepository::findSellByTypeAndStation(ExternalOrder::TypeIdType typeId,
@@ -96,22 +124,22 @@ namespace Evernus
                                                                                          const Repository<MarketOrder> &orderRepo,
                                                                                          const Repository<MarketOrder> &corpOrderRepo) const
     {
-        auto query = prepare(QStringLiteral(
+        auto query = prepareCached(QStringLiteral(
             "SELECT * FROM %1 WHERE type = ? AND type_id = ? AND location_id = ? AND id NOT IN "
             "(SELECT id FROM %2 WHERE state = ? UNION SELECT id FROM %3 WHERE state = ?) "
             "ORDER BY value ASC LIMIT 1")
-            .arg(getTableName()).arg(orderRepo.getTableName()).arg(corpOrderRepo.getTableName()));
-        query.addBindValue(static_cast<int>(ExternalOrder::Type::Sell));
-        query.addBindValue(typeId);
-        query.addBindValue(stationId);
-        query.addBindValue(static_cast<int>(MarketOrder::State::Active));
-        query.addBindValue(static_cast<int>(MarketOrder::State::Active));
-
-        DatabaseUtils::execQuery(query);
-        if (!query.next())
+            .arg(getReadTableName()).arg(orderRepo.getTableName()).arg(corpOrderRepo.getTableName()));
+        query->addBindValue(static_cast<int>(ExternalOrder::Type::Sell));
+        query->addBindValue(typeId);
+        query->addBindValue(stationId);
+        query->addBindValue(static_cast<int>(MarketOrder::State::Active));
+        query->addBindValue(static_cast<int>(MarketOrder::State::Active));
+
+        DatabaseUtils::execQuery(*query);
+        if (!query->next())
             BOOST_THROW_EXCEPTION(NotFoundException{});
 
-        return populate(query.record());
+        return populate(query->record());
     }
 
     ExternalOrderRepository::EntityPtr ExternalOrderRepository::findSellByTypeAndRegion(ExternalOrder::TypeIdType typeId,
@@ -119,22 +147,22 @@ namespace Evernus
                                                                                         const Repository<MarketOrder> &orderRepo,
                                                                                         const Repository<MarketOrder> &corpOrderRepo) const
     {
-        auto query = prepare(QStringLiteral(
+        auto query = prepareCached(QStringLiteral(
             "SELECT * FROM %1 WHERE type = ? AND type_id = ? AND region_id = ? AND id NOT IN "
             "(SELECT id FROM %2 WHERE state = ? UNION SELECT id FROM %3 WHERE state = ?) "
             "ORDER BY value ASC LIMIT 1")
-            .arg(getTableName()).arg(orderRepo.getTableName()).arg(corpOrderRepo.getTableName()));
-        query.addBindValue(static_cast<int>(ExternalOrder::Type::Sell));
-        query.addBindValue(typeId);
-        query.addBindValue(regionId);
-        query.addBindValue(static_cast<int>(MarketOrder::State::Active));
-        query.addBindValue(static_cast<int>(MarketOrder::State::Active));
-
-        DatabaseUtils::execQuery(query);
-        if (!query.next())
+            .arg(getRegionTableName(regionId)).arg(orderRepo.getTableName()).arg(corpOrderRepo.getTableName()));
+        query->addBindValue(static_cast<int>(ExternalOrder::Type::Sell));
+        query->addBindValue(typeId);
+        query->addBindValue(regionId);
+        query->addBindValue(static_cast<int>(MarketOrder::State::Active));
+        query->addBindValue(static_cast<int>(MarketOrder::State::Active));
+
+        DatabaseUtils::execQuery(*query);
+        if (!query->next())
             BOOST_THROW_EXCEPTION(NotFoundException{});
 
-        return populate(query.record());
+        return populate(query->record());
     }
 
     ExternalOrderRepository::EntityList ExternalOrderRepository::findBuyByTypeAndRegion(ExternalOrder::TypeIdType typeId,
@@ -142,28 +170,19 @@ namespace Evernus
                                                                                         const Repository<MarketOrder> &orderRepo,
                                                                                         const Repository<MarketOrder> &corpOrderRepo) const
     {
-        auto query = prepare(QStringLiteral(
+        auto query = prepareCached(QStringLiteral(
             "SELECT * FROM %1 WHERE type = ? AND type_id = ? AND region_id = ? AND id NOT IN "
             "(SELECT id FROM %2 WHERE state = ? UNION SELECT id FROM %3 WHERE state = ?)"
-            ).arg(getTableName()).arg(orderRepo.getTableName()).arg(corpOrderRepo.getTableName()));
-        query.addBindValue(static_cast<int>(ExternalOrder::Type::Buy));
-        query.addBindValue(typeId);
-        query.addBindValue(regionId);
-        query.addBindValue(static_cast<int>(MarketOrder::State::Active));
-        query.addBindValue(static_cast<int>(MarketOrder::State::Active));
-
-        DatabaseUtils::execQuery(query);
-
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
+            ).arg(getRegionTableName(regionId)).arg(orderRepo.getTableName()).arg(corpOrderRepo.getTableName()));
+        query->addBindValue(static_cast<int>(ExternalOrder::Type::Buy));
+        query->addBindValue(typeId);
+        query->addBindValue(regionId);
+        query->addBindValue(static_cast<int>(MarketOrder::State::Active));
+        query->addBindValue(static_cast<int>(MarketOrder::State::Active));
 
-        while (query.next())
-            result.emplace_back(populate(query.record()));
+        DatabaseUtils::execQuery(*query);
 
-        return result;
+        return populateAll(*query);
     }
 
     ExternalOrderRepository::EntityList ExternalOrderRepository::fetchBuyByType(ExternalOrder::TypeIdType typeId) const
@@ -229,7 +248,7 @@ namespace Evernus
 
         std::vector<uint> result;
 
-        auto query = prepare(QStringLiteral("SELECT DISTINCT solar_system_id FROM %1 WHERE region_id = ?").arg(getTableName()));
+        auto query = prepare(QStringLiteral("SELECT DISTINCT solar_system_id FROM %1 WHERE region_id = ?").arg(getRegionTableName(regionId)));
         query.bindValue(0, regionId);
 
         DatabaseUtils::execQuery(query);
@@ -253,7 +272,7 @@ namespace Evernus
     {
         std::vector<quint64> result;
 
-        auto query = prepare(QStringLiteral("SELECT DISTINCT location_id FROM %1 WHERE region_id = ?").arg(getTableName()));
+        auto query = prepare(QStringLiteral("SELECT DISTINCT location_id FROM %1 WHERE region_id = ?").arg(getRegionTableName(regionId)));
         query.bindValue(0, regionId);
 
         DatabaseUtils::execQuery(query);
@@ -272,7 +291,7 @@ namespace Evernus
     {
         std::vector<quint64> result;
 
-        auto query = prepare(QStringLiteral("SELECT DISTINCT location_id FROM %1 WHERE solar_system_id = ?").arg(getTableName()));
+        auto query = prepare(QStringLiteral("SELECT DISTINCT location_id FROM %1 WHERE solar_system_id = ?").arg(getReadTableName()));
         query.bindValue(0, solarSystemId);
 
         DatabaseUtils::execQuery(query);
@@ -296,6 +315,30 @@ namespace Evernus
 
         db.transaction();
 
+        if (mPartitioned)
+        {
+            try
+            {
+                for (const auto &pair : set)
+                {
+                    auto query = prepareCached(QStringLiteral("DELETE FROM %1 WHERE type_id = ? AND region_id = ?")
+                        .arg(getRegionTableName(pair.second)));
+                    query->addBindValue(pair.first);
+                    query->addBindValue(pair.second);
+
+                    DatabaseUtils::execQuery(*query);
+                }
+            }
+            catch (...)
+            {
+                db.rollback();
+                throw;
+            }
+
+            db.commit();
+            return;
+        }
+
         try
         {
             const auto baseQuery = QStringLiteral("DELETE FROM %1 WHERE %2").arg(getTableName());
@@ -357,28 +400,123 @@ namespace Evernus
         db.commit();
     }
 
+    ExternalOrderRepository::DeltaResult ExternalOrderRepository::applyDelta(const OrderRefList &orders, const TypeLocationPairs &set) const
+    {
+        DeltaResult result;
+
+        std::map<uint, std::pair<OrderRefList, TypeLocationPairs>> regionDeltas;
+        QStringList bulkTables;
+
+        if (mPartitioned)
+        {
+            for (const auto &pair : set)
+                regionDeltas[pair.second].second.emplace(pair);
+            for (const auto &order : orders)
+                regionDeltas[order.get().getRegionId()].first.emplace_back(order);
+
+            // create partitions outside the transaction, so a rollback cannot remove tables we already know about
+            for (const auto &delta : regionDeltas)
+            {
+                ensurePartition(delta.first);
+
+                const auto table = getPartitionName(delta.first);
+                if (isBulkLoad(table, delta.second.first.size()))
+                    bulkTables << table;
+            }
+        }
+        else if (isBulkLoad(getTableName(), orders.size()))
+        {
+            bulkTables << getTableName();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // maintaining every index row by row is far more expensive than rebuilding them once at the end
+        for (const auto &table : bulkTables)
+            dropWideIndexes(table);
+
+        auto db = getDatabase();
+
+        db.transaction();
+
+        try
+        {
+            if (mPartitioned)
+            {
+                for (const auto &delta : regionDeltas)
+                    applyDelta(getPartitionName(delta.first), delta.second.first, delta.second.second, result);
+            }
+            else
+            {
+                applyDelta(getTableName(), orders, set, result);
+            }
+        }
+        catch (...)
+        {
+            db.rollback();
+
+            for (const auto &table : bulkTables)
+                createIndexes(table, mPartitioned);
+
+            throw;
+        }
+
+        db.commit();
+
+        result.mWriteTime = timer.restart();
+
+        if (!bulkTables.isEmpty())
+        {
+            for (const auto &table : bulkTables)
+                createIndexes(table, mPartitioned);
+
+            result.mIndexRebuildTime = timer.elapsed();
+        }
+
+        return result;
+    }
+
     void ExternalOrderRepository::removeForType(ExternalOrder::TypeIdType typeId) const
     {
-        auto query = prepare(QStringLiteral("DELETE FROM %1 WHERE type_id = ?").arg(getTableName()));
-        query.bindValue(0, typeId);
+        for (const auto &table : getWritableTableNames())
+        {
+            auto query = prepare(QStringLiteral("DELETE FROM %1 WHERE type_id = ?").arg(table));
+            query.bindValue(0, typeId);
 
-        DatabaseUtils::execQuery(query);
+            DatabaseUtils::execQuery(query);
+        }
     }
 
     void ExternalOrderRepository::removeAll() const
     {
-        exec(QStringLiteral("DELETE FROM %1").arg(getTableName()));
+        if (mPartitioned)
+        {
+            // dropping whole partitions is much cheaper than deleting through the indexes
+            std::lock_guard<std::mutex> lock{mPartitionMutex};
+
+            for (const auto regionId : mPartitions)
+                exec(QStringLiteral("DROP TABLE IF EXISTS %1").arg(getPartitionName(regionId)));
+
+            mPartitions.clear();
+            createPartitionView();
+        }
+
+        exec(QStringLiteral("DELETE FROM %1").arg(getBaseTableName()));
     }
 
     void ExternalOrderRepository::fixMissingData(const Repository<Citadel> &citadelRepo) const
     {
-        exec(QStringLiteral(R"(
+        for (const auto &table : getWritableTableNames())
+        {
+            exec(QStringLiteral(R"(
     UPDATE %1 SET solar_system_id = (
         SELECT c.solar_system_id FROM %2 c WHERE c.%3 = location_id
     ) WHERE solar_system_id = 0 AND EXISTS(
         SELECT c.solar_system_id FROM %2 c WHERE c.%3 = location_id
     )
-        )").arg(getTableName()).arg(citadelRepo.getTableName()).arg(citadelRepo.getIdColumn()));
+            )").arg(table).arg(citadelRepo.getTableName()).arg(citadelRepo.getIdColumn()));
+        }
     }
 
     QStringList ExternalOrderRepository::getColumns() const
@@ -444,107 +582,379 @@ namespace Evernus
     ExternalOrderRepository::EntityList ExternalOrderRepository::fetchByType(ExternalOrder::TypeIdType typeId,
                                                                              ExternalOrder::Type type) const
     {
-        auto query = prepare(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ?").arg(getTableName()));
-        query.addBindValue(static_cast<int>(type));
-        query.addBindValue(typeId);
-
-        DatabaseUtils::execQuery(query);
-
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
+        auto query = prepareCached(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ?").arg(getReadTableName()));
+        query->addBindValue(static_cast<int>(type));
+        query->addBindValue(typeId);
 
-        while (query.next())
-            result.emplace_back(populate(query.record()));
+        DatabaseUtils::execQuery(*query);
 
-        return result;
+        return populateAll(*query);
     }
 
     ExternalOrderRepository::EntityList ExternalOrderRepository::fetchByTypeAndStation(ExternalOrder::TypeIdType typeId,
                                                                                        quint64 stationId,
                                                                                        ExternalOrder::Type type) const
     {
-        auto query = prepare(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ? AND location_id = ?").arg(getTableName()));
-        query.addBindValue(static_cast<int>(type));
-        query.addBindValue(typeId);
-        query.addBindValue(stationId);
+        auto query = prepareCached(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ? AND location_id = ?").arg(getReadTableName()));
+        query->addBindValue(static_cast<int>(type));
+        query->addBindValue(typeId);
+        query->addBindValue(stationId);
 
-        DatabaseUtils::execQuery(query);
-
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
+        DatabaseUtils::execQuery(*query);
 
-        return result;
+        return populateAll(*query);
     }
 
     ExternalOrderRepository::EntityList ExternalOrderRepository::fetchByTypeAndSolarSystem(ExternalOrder::TypeIdType typeId,
                                                                                            uint solarSystemId,
                                                                                            ExternalOrder::Type type) const
     {
-        auto query = prepare(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ? AND solar_system_id = ?").arg(getTableName()));
-        query.addBindValue(static_cast<int>(type));
-        query.addBindValue(typeId);
-        query.addBindValue(solarSystemId);
+        auto query = prepareCached(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ? AND solar_system_id = ?").arg(getReadTableName()));
+        query->addBindValue(static_cast<int>(type));
+        query->addBindValue(typeId);
+        query->addBindValue(solarSystemId);
 
-        DatabaseUtils::execQuery(query);
+        DatabaseUtils::execQuery(*query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(*query);
     }
 
     ExternalOrderRepository::EntityList ExternalOrderRepository::fetchByTypeAndRegion(ExternalOrder::TypeIdType typeId,
                                                                                       uint regionId,
                                                                                       ExternalOrder::Type type) const
     {
-        auto query = prepare(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ? AND region_id = ?").arg(getTableName()));
-        query.addBindValue(static_cast<int>(type));
-        query.addBindValue(typeId);
-        query.addBindValue(regionId);
+        auto query = prepareCached(QStringLiteral("SELECT * FROM %1 WHERE type = ? AND type_id = ? AND region_id = ?").arg(getRegionTableName(regionId)));
+        query->addBindValue(static_cast<int>(type));
+        query->addBindValue(typeId);
+        query->addBindValue(regionId);
 
-        DatabaseUtils::execQuery(query);
+        DatabaseUtils::execQuery(*query);
 
-        EntityList result;
+        return populateAll(*query);
+    }
+
+    template<class T>
+    std::vector<T> ExternalOrderRepository::fetchUniqueColumn(const QString &column) const
+    {
+        std::vector<T> result;
+
+        auto query = exec(QStringLiteral("SELECT DISTINCT %1 FROM %2").arg(column).arg(getReadTableName()));
 
         const auto size = query.size();
         if (size > 0)
             result.reserve(size);
 
         while (query.next())
-            result.emplace_back(populate(query.record()));
+            result.emplace_back(query.value(0).template value<T>());
 
         return result;
     }
 
-    template<class T>
-    std::vector<T> ExternalOrderRepository::fetchUniqueColumn(const QString &column) const
+    void ExternalOrderRepository::applyDelta(const QString &tableName,
+                                             const OrderRefList &orders,
+                                             const TypeLocationPairs &set,
+                                             DeltaResult &result) const
     {
-        std::vector<T> result;
+        struct StoredOrder
+        {
+            double mPrice;
+            uint mVolumeRemaining;
+            QDateTime mIssued;
+        };
 
-        auto query = exec(QStringLiteral("SELECT DISTINCT %1 FROM %2").arg(column).arg(getTableName()));
+        std::unordered_map<ExternalOrder::IdType, StoredOrder> storedOrders;
 
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
+        auto query = prepareCached(QStringLiteral(
+            "SELECT id, value, volume_remaining, issued FROM %1 WHERE type_id = ? AND region_id = ?").arg(tableName));
+        for (const auto &pair : set)
+        {
+            query->addBindValue(pair.first);
+            query->addBindValue(pair.second);
+
+            DatabaseUtils::execQuery(*query);
+
+            while (query->next())
+            {
+                auto issued = query->value(3).toDateTime();
+                issued.setTimeSpec(Qt::UTC);
+
+                storedOrders.emplace(query->value(0).value<ExternalOrder::IdType>(),
+                                     StoredOrder{query->value(1).toDouble(), query->value(2).toUInt(), issued});
+            }
+        }
+
+        OrderRefList toStore;
+
+        // unchanged orders only get their update time refreshed, which touches a single index
+        std::map<QDateTime, std::vector<ExternalOrder::IdType>> toRefresh;
+
+        for (const auto &order : orders)
+        {
+            const auto &entity = order.get();
+
+            const auto stored = storedOrders.find(entity.getId());
+            if (stored == std::end(storedOrders))
+            {
+                toStore.emplace_back(order);
+                ++result.mInserted;
+                continue;
+            }
+
+            if (stored->second.mPrice != entity.getPrice() ||
+                stored->second.mVolumeRemaining != entity.getVolumeRemaining() ||
+                stored->second.mIssued != entity.getIssued())
+            {
+                toStore.emplace_back(order);
+                ++result.mUpdated;
+            }
+            else
+            {
+                toRefresh[entity.getUpdateTime()].emplace_back(entity.getId());
+                ++result.mUnchanged;
+            }
+
+            storedOrders.erase(stored);
+        }
+
+        // whatever is left has vanished from the market
+        std::vector<ExternalOrder::IdType> toRemove;
+        toRemove.reserve(storedOrders.size());
+
+        for (const auto &order : storedOrders)
+            toRemove.emplace_back(order.first);
+
+        result.mDeleted += toRemove.size();
+
+        const auto ignoreResult = [](const auto &) {};
+
+        execForIdChunks(QStringLiteral("DELETE FROM %1 WHERE id IN (%2)").arg(tableName), toRemove, ignoreResult);
+
+        for (const auto &refresh : toRefresh)
+        {
+            execForIdChunks(QStringLiteral("UPDATE %1 SET update_time = ? WHERE id IN (%2)").arg(tableName),
+                            refresh.second,
+                            ignoreResult,
+                            { refresh.first });
+        }
+
+        storeInto(tableName, toStore);
+    }
+
+    void ExternalOrderRepository::storeInto(const QString &tableName, const OrderRefList &orders) const
+    {
+        if (orders.empty())
+            return;
+
+        const auto columns = getColumns();
+
+        auto row = std::begin(orders);
+        execBatchReplace(tableName, columns, orders.size(), maxSqliteBoundVariables / columns.size(), [&](auto &query) {
+            bindPositionalValues(*row, query);
+            ++row;
+        });
+    }
+
+    void ExternalOrderRepository::createTable(const QString &tableName, bool partition) const
+    {
+        exec(QStringLiteral("CREATE TABLE IF NOT EXISTS %1 ("
+            "id BIGINT PRIMARY KEY,"
+            "type TINYINT NOT NULL,"
+            "type_id INTEGER NOT NULL,"
+            "location_id BIGINT NOT NULL,"
+            "solar_system_id INTEGER NOT NULL,"
+            "region_id INTEGER NOT NULL,"
+            "range INTEGER NOT NULL,"
+            "update_time DATETIME NOT NULL,"
+            "value DOUBLE NOT NULL,"
+            "volume_entered INTEGER NOT NULL,"
+            "volume_remaining INTEGER NOT NULL,"
+            "min_volume INTEGER NOT NULL,"
+            "issued DATETIME NOT NULL,"
+            "duration INTEGER NOT NULL"
+        ")").arg(tableName));
+
+        createIndexes(tableName, partition);
+    }
+
+    void ExternalOrderRepository::createIndexes(const QString &tableName, bool partition) const
+    {
+        for (const auto &index : indexes)
+        {
+            if (partition && index.mRegion)
+                continue;
+
+            exec(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_%2 ON %1(%3)").arg(tableName).arg(index.mName).arg(index.mColumns));
+        }
+    }
+
+    bool ExternalOrderRepository::isBulkLoad(const QString &tableName, std::size_t incomingOrders) const
+    {
+        if (incomingOrders < bulkLoadMinOrders)
+            return false;
+
+        auto query = exec(QStringLiteral("SELECT COUNT(*) FROM %1").arg(tableName));
+        const auto storedOrders = (query.next()) ? (query.value(0).toULongLong()) : (0ull);
+
+        // a rebuild covers the whole table, so it only pays off if the load rewrites a good part of it
+        return incomingOrders * bulkLoadTableFraction >= storedOrders;
+    }
+
+    void ExternalOrderRepository::dropWideIndexes(const QString &tableName) const
+    {
+        for (const auto &index : indexes)
+        {
+            if (!index.mNarrow)
+                exec(QStringLiteral("DROP INDEX IF EXISTS %1_%2").arg(tableName).arg(index.mName));
+        }
+    }
 
+    void ExternalOrderRepository::setupPartitions() const
+    {
+        const auto prefix = getBaseTableName() + QStringLiteral("_r");
+
+        std::set<uint> existing;
+
+        auto query = exec(QStringLiteral("SELECT name FROM sqlite_master WHERE type = 'table' AND name LIKE '%1%'").arg(prefix));
         while (query.next())
-            result.emplace_back(query.value(0).template value<T>());
+        {
+            const auto name = query.value(0).toString();
+            if (!name.startsWith(prefix))
+                continue;
+
+            auto ok = false;
+            const auto regionId = name.mid(prefix.size()).toUInt(&ok);
+
+            if (ok)
+                existing.emplace(regionId);
+        }
+
+        auto db = getDatabase();
+
+        db.transaction();
+
+        try
+        {
+            if (mPartitioned)
+            {
+                // move orders left in the single table layout to their partitions
+                auto regionQuery = exec(QStringLiteral("SELECT DISTINCT region_id FROM %1").arg(getBaseTableName()));
+                while (regionQuery.next())
+                {
+                    const auto regionId = regionQuery.value(0).toUInt();
+
+                    createTable(getPartitionName(regionId), true);
+                    existing.emplace(regionId);
+
+                    auto moveQuery = prepare(QStringLiteral("REPLACE INTO %1 SELECT * FROM %2 WHERE region_id = ?")
+                        .arg(getPartitionName(regionId))
+                        .arg(getBaseTableName()));
+                    moveQuery.bindValue(0, regionId);
+
+                    DatabaseUtils::execQuery(moveQuery);
+                }
+
+                exec(QStringLiteral("DELETE FROM %1").arg(getBaseTableName()));
+
+                std::lock_guard<std::mutex> lock{mPartitionMutex};
+
+                mPartitions = std::move(existing);
+                createPartitionView();
+            }
+            else
+            {
+                // partitioning was turned off - merge everything back
+                for (const auto regionId : existing)
+                {
+                    exec(QStringLiteral("REPLACE INTO %1 SELECT * FROM %2").arg(getBaseTableName()).arg(getPartitionName(regionId)));
+                    exec(QStringLiteral("DROP TABLE %1").arg(getPartitionName(regionId)));
+                }
+
+                exec(QStringLiteral("DROP VIEW IF EXISTS %1").arg(getPartitionViewName()));
+            }
+        }
+        catch (...)
+        {
+            db.rollback();
+            throw;
+        }
+
+        db.commit();
+    }
+
+    void ExternalOrderRepository::ensurePartition(uint regionId) const
+    {
+        std::lock_guard<std::mutex> lock{mPartitionMutex};
+
+        if (mPartitions.find(regionId) != std::end(mPartitions))
+            return;
+
+        createTable(getPartitionName(regionId), true);
+
+        mPartitions.emplace(regionId);
+        createPartitionView();
+    }
+
+    void ExternalOrderRepository::createPartitionView() const
+    {
+        // the base table is always empty here, but keeps the view valid when there are no partitions
+        QStringList selects{QStringLiteral("SELECT * FROM %1").arg(getBaseTableName())};
+        for (const auto regionId : mPartitions)
+            selects << QStringLiteral("SELECT * FROM %1").arg(getPartitionName(regionId));
+
+        // a savepoint works both standalone and inside setupPartitions() transaction, and other connections never see
+        // the view missing in between
+        exec(QStringLiteral("SAVEPOINT partition_view"));
+
+        try
+        {
+            exec(QStringLiteral("DROP VIEW IF EXISTS %1").arg(getPartitionViewName()));
+            exec(QStringLiteral("CREATE VIEW %1 AS %2").arg(getPartitionViewName()).arg(selects.join(QStringLiteral(" UNION ALL "))));
+        }
+        catch (...)
+        {
+            exec(QStringLiteral("ROLLBACK TO partition_view"));
+            exec(QStringLiteral("RELEASE partition_view"));
+            throw;
+        }
+
+        exec(QStringLiteral("RELEASE partition_view"));
+    }
+
+    QString ExternalOrderRepository::getRegionTableName(uint regionId) const
+    {
+        if (!mPartitioned)
+            return getTableName();
+
+        std::lock_guard<std::mutex> lock{mPartitionMutex};
+        return (mPartitions.find(regionId) != std::end(mPartitions)) ? (getPartitionName(regionId)) : (getTableName());
+    }
+
+    QStringList ExternalOrderRepository::getWritableTableNames() const
+    {
+        QStringList result{getBaseTableName()};
+        if (!mPartitioned)
+            return result;
+
+        std::lock_guard<std::mutex> lock{mPartitionMutex};
+
+        for (const auto regionId : mPartitions)
+            result << getPartitionName(regionId);
 
         return result;
     }
+
+    QString ExternalOrderRepository::getBaseTableName()
+    {
+        return QStringLiteral("external_orders");
+    }
+
+    QString ExternalOrderRepository::getPartitionViewName()
+    {
+        return QStringLiteral("external_orders_all");
+    }
+
+    QString ExternalOrderRepository::getPartitionName(uint regionId)
+    {
+        return QStringLiteral("%1_r%2").arg(getBaseTableName()).arg(regionId);
+    }
 }
@@ -14,6 +14,13 @@
  */
 #pragma once
 
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <set>
+
+#include <QVariant>
+
 #include "ExternalOrderImporter.h"
 #include "ExternalOrder.h"
 #include "Repository.h"
@@ -27,12 +34,27 @@ namespace Evernus
         : public Repository<ExternalOrder>
     {
     public:
-        using Repository::Repository;
+        using OrderRefList = std::vector<std::reference_wrapper<const ExternalOrder>>;
+
+        struct DeltaResult
+        {
+            std::size_t mInserted = 0;
+            std::size_t mUpdated = 0;
+            std::size_t mDeleted = 0;
+            std::size_t mUnchanged = 0;
+            qint64 mWriteTime = 0;          // ms
+            qint64 mIndexRebuildTime = 0;   // ms, bulk loads only
+        };
+
+        ExternalOrderRepository(bool partitioned, const DatabaseConnectionProvider &connectionProvider);
         virtual ~ExternalOrderRepository() = default;
 
         virtual QString getTableName() const override;
         virtual QString getIdColumn() const override;
 
+        // table or view with orders of all regions; getTableName() is only the base table when partitioned
+        QString getReadTableName() const;
+
         virtual EntityPtr populate(const QSqlRecord &record) const override;
 
         void create() const;
@@ -74,16 +96,55 @@ namespace Evernus
         std::vector<quint64> fetchUniqueStationsBySolarSystem(uint solarSystemId) const;
 
         void removeObsolete(const TypeLocationPairs &set) const;
+        // replaces orders for given type/region pairs, but writes only rows which have actually changed
+        // tables receiving a large share of their rows get all but the narrow indexes dropped for the duration of
+        // the write and rebuilt afterwards
+        DeltaResult applyDelta(const OrderRefList &orders, const TypeLocationPairs &set) const;
         void removeForType(ExternalOrder::TypeIdType typeId) const;
         void removeAll() const;
 
         void fixMissingData(const Repository<Citadel> &citadelRepo) const;
 
     private:
+        // positions in getColumns()
+        enum Column
+        {
+            IdColumn,
+            TypeColumn,
+            TypeIdColumn,
+            LocationIdColumn,
+            SolarSystemIdColumn,
+            RegionIdColumn,
+            RangeColumn,
+            UpdateTimeColumn,
+            ValueColumn,
+            VolumeEnteredColumn,
+            VolumeRemainingColumn,
+            MinVolumeColumn,
+            IssuedColumn,
+            DurationColumn
+        };
+
+        // loads smaller than this never rebuild indexes
+        static const std::size_t bulkLoadMinOrders = 10000;
+        // ...and bigger ones only if they are at least 1/n of the stored rows
+        static const std::size_t bulkLoadTableFraction = 4;
+
+        bool mPartitioned = false;
+
+        mutable std::mutex mPartitionMutex;
+        mutable std::set<uint> mPartitions;
+
         virtual QStringList getColumns() const override;
         virtual void bindValues(const ExternalOrder &entity, QSqlQuery &query) const override;
         virtual void bindPositionalValues(const ExternalOrder &entity, QSqlQuery &query) const override;
 
+        virtual EntityPtr populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const override;
+
+        // single decoder for both populate() and populateRow(), so the two cannot drift apart
+        template<class Row>
+        EntityPtr decodeRow(const Row &row, const ColumnOrdinals &ordinals) const;
+
         EntityList fetchByType(ExternalOrder::TypeIdType typeId, ExternalOrder::Type type) const;
         EntityList fetchByTypeAndStation(ExternalOrder::TypeIdType typeId,
                                          quint64 stationId,
@@ -97,5 +158,27 @@ namespace Evernus
 
         template<class T>
         std::vector<T> fetchUniqueColumn(const QString &column) const;
+
+        void applyDelta(const QString &tableName,
+                        const OrderRefList &orders,
+                        const TypeLocationPairs &set,
+                        DeltaResult &result) const;
+        void storeInto(const QString &tableName, const OrderRefList &orders) const;
+
+        void createTable(const QString &tableName, bool partition) const;
+        void createIndexes(const QString &tableName, bool partition) const;
+        bool isBulkLoad(const QString &tableName, std::size_t incomingOrders) const;
+        void dropWideIndexes(const QString &tableName) const;
+        void setupPartitions() const;
+        void ensurePartition(uint regionId) const;
+        // requires mPartitionMutex to be locked
+        void createPartitionView() const;
+
+        QString getRegionTableName(uint regionId) const;
+        QStringList getWritableTableNames() const;
+
+        static QString getBaseTableName();
+        static QString getPartitionViewName();
+        static QString getPartitionName(uint regionId);
     };
 }
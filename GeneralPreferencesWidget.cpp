@@ -20,6 +20,7 @@
 #include <QComboBox>
 #include <QSettings>
 #include <QSqlQuery>
+#include <QSpinBox>
 #include <QLabel>
 
 #include "LanguageComboBox.h"
@@ -118,6 +119,30 @@ namespace Evernus
         mDbSynchronousEdit->setCurrentIndex(mDbSynchronousEdit->findData(
             settings.value(DbSettings::synchronousKey, DbSettings::synchronousDefault).toInt()));
 
+        mDbUseWALBtn = new QCheckBox{tr("Use write-ahead logging for the database (requires restart)"), this};
+        generalFormLayout->addRow(mDbUseWALBtn);
+        mDbUseWALBtn->setToolTip(tr("Lets the interface read data while updates are being written in the background."));
+        mDbUseWALBtn->setChecked(settings.value(DbSettings::useWALKey, DbSettings::useWALDefault).toBool());
+
+        mDbPartitionExternalOrdersBtn = new QCheckBox{tr("Store market orders separately for each region (requires restart)"), this};
+        generalFormLayout->addRow(mDbPartitionExternalOrdersBtn);
+        mDbPartitionExternalOrdersBtn->setToolTip(tr("Speeds up importing whole regions, at the cost of slightly slower queries spanning many regions."));
+        mDbPartitionExternalOrdersBtn->setChecked(
+            settings.value(DbSettings::partitionExternalOrdersKey, DbSettings::partitionExternalOrdersDefault).toBool());
+
+        mDbSlowQueryThresholdEdit = new QSpinBox{this};
+        generalFormLayout->addRow(tr("Log database queries slower than:"), mDbSlowQueryThresholdEdit);
+        mDbSlowQueryThresholdEdit->setRange(0, 600000);
+        mDbSlowQueryThresholdEdit->setSuffix(QStringLiteral("ms"));
+        mDbSlowQueryThresholdEdit->setSpecialValueText(tr("disabled"));
+        mDbSlowQueryThresholdEdit->setValue(settings.value(DbSettings::slowQueryThresholdKey, DbSettings::slowQueryThresholdDefault).toInt());
+
+        mDbCollectQueryStatisticsBtn = new QCheckBox{tr("Collect database query statistics"), this};
+        generalFormLayout->addRow(mDbCollectQueryStatisticsBtn);
+        mDbCollectQueryStatisticsBtn->setToolTip(tr("Gathers timings of all database queries for the statistics dump. Slightly slows down the application."));
+        mDbCollectQueryStatisticsBtn->setChecked(
+            settings.value(DbSettings::collectQueryStatisticsKey, DbSettings::collectQueryStatisticsDefault).toBool());
+
         mainLayout->addStretch();
     }
 
@@ -139,5 +164,9 @@ namespace Evernus
         settings.setValue(UISettings::applyDateFormatToGraphsKey, mApplyDateFormatToGraphsBtn->isChecked());
         settings.setValue(UISettings::columnDelimiterKey, mColumnDelimiterEdit->currentData().value<char>());
         settings.setValue(DbSettings::synchronousKey, synchronousFlag);
+        settings.setValue(DbSettings::useWALKey, mDbUseWALBtn->isChecked());
+        settings.setValue(DbSettings::partitionExternalOrdersKey, mDbPartitionExternalOrdersBtn->isChecked());
+        settings.setValue(DbSettings::slowQueryThresholdKey, mDbSlowQueryThresholdEdit->value());
+        settings.setValue(DbSettings::collectQueryStatisticsKey, mDbCollectQueryStatisticsBtn->isChecked());
     }
 }
@@ -18,6 +18,7 @@
 #include <QWidget>
 
 class QCheckBox;
+class QSpinBox;
 class QLineEdit;
 class QComboBox;
 
@@ -51,5 +52,9 @@ namespace Evernus
         QCheckBox *mApplyDateFormatToGraphsBtn = nullptr;
         QComboBox *mColumnDelimiterEdit = nullptr;
         QComboBox *mDbSynchronousEdit = nullptr;
+        QCheckBox *mDbUseWALBtn = nullptr;
+        QCheckBox *mDbPartitionExternalOrdersBtn = nullptr;
+        QSpinBox *mDbSlowQueryThresholdEdit = nullptr;
+        QCheckBox *mDbCollectQueryStatisticsBtn = nullptr;
     };
 }
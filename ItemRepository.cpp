@@ -85,55 +85,28 @@ namespace Evernus
         if (map.empty())
             return;
 
-        const auto maxRowsPerInsert = 100;
-        const auto totalRows = std::begin(map)->size();
-        const auto batches = totalRows / maxRowsPerInsert;
-
+        const auto maxRowsPerInsert = 100u;
         const auto columns = getColumns();
-        const auto baseQueryStr = QStringLiteral("REPLACE INTO %1 (%2) VALUES %3").arg(getTableName()).arg(columns.join(QStringLiteral(", ")));
-
-        QStringList columnBindings;
-        for (auto i = 0; i < columns.count(); ++i)
-            columnBindings << QStringLiteral("?");
-
-        const auto bindings = QStringLiteral("(%1)").arg(columnBindings.join(QStringLiteral(", ")));
 
-        QStringList batchBindings;
-        for (auto i = 0; i < maxRowsPerInsert; ++i)
-            batchBindings << bindings;
+        // resolve column value lists once, instead of a hash lookup per bound value
+        std::vector<const QVariantList *> columnValues;
+        columnValues.reserve(columns.size());
 
-        const auto batchQueryStr = baseQueryStr.arg(batchBindings.join(QStringLiteral(", ")));
-
-        for (auto batch = 0; batch < batches; ++batch)
+        for (const auto &column : columns)
         {
-            auto query = prepare(batchQueryStr);
-
-            for (auto row = batch * maxRowsPerInsert; row < (batch + 1) * maxRowsPerInsert; ++row)
-            {
-                for (const auto &column : columns)
-                    query.addBindValue(map[column][row]);
-            }
+            const auto values = map.find(column);
+            Q_ASSERT(values != std::end(map));
 
-            DatabaseUtils::execQuery(query);
+            columnValues.emplace_back(&values.value());
         }
 
-        if ((totalRows % maxRowsPerInsert) != 0)
-        {
-            QStringList restBindings;
-            for (auto i = 0; i < totalRows % maxRowsPerInsert; ++i)
-                restBindings << bindings;
-
-            const auto restQueryStr = baseQueryStr.arg(restBindings.join(QStringLiteral(", ")));
-            auto query = prepare(restQueryStr);
+        auto row = 0;
+        execBatchReplace(getTableName(), columns, std::begin(map)->size(), maxRowsPerInsert, [&](auto &query) {
+            for (const auto values : columnValues)
+                query.addBindValue(values->at(row));
 
-            for (auto row = batches * maxRowsPerInsert; row < totalRows; ++row)
-            {
-                for (const auto &column : columns)
-                    query.addBindValue(map[column][row]);
-            }
-
-            DatabaseUtils::execQuery(query);
-        }
+            ++row;
+        });
     }
 
     void ItemRepository::fillCustomValues(AssetList &assets) const
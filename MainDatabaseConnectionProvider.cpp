@@ -58,8 +58,24 @@ namespace Evernus
             db.exec(QStringLiteral("PRAGMA synchronous = %1").arg(
                 settings.value(DbSettings::synchronousKey, DbSettings::synchronousDefault).toInt()
             ));
+
+            // WAL lets readers work on a consistent snapshot while the writer thread commits
+            if (settings.value(DbSettings::useWALKey, DbSettings::useWALDefault).toBool())
+                db.exec(QStringLiteral("PRAGMA journal_mode = WAL"));
+            else
+                db.exec(QStringLiteral("PRAGMA journal_mode = DELETE"));
         }
 
         return db;
     }
+
+    DatabaseWriter *MainDatabaseConnectionProvider::getWriter() const noexcept
+    {
+        return mWriter;
+    }
+
+    void MainDatabaseConnectionProvider::setWriter(DatabaseWriter *writer) noexcept
+    {
+        mWriter = writer;
+    }
 }
@@ -28,8 +28,14 @@ namespace Evernus
         virtual ~MainDatabaseConnectionProvider() = default;
 
         virtual QSqlDatabase getConnection() const override;
+        virtual DatabaseWriter *getWriter() const noexcept override;
+
+        void setWriter(DatabaseWriter *writer) noexcept;
 
         MainDatabaseConnectionProvider &operator =(const MainDatabaseConnectionProvider &) = default;
         MainDatabaseConnectionProvider &operator =(MainDatabaseConnectionProvider &&) = default;
+
+    private:
+        DatabaseWriter *mWriter = nullptr;
     };
 }
@@ -19,16 +19,19 @@
 #include <QNetworkInterface>
 #include <QDesktopServices>
 #include <QApplication>
+#include <QFileDialog>
 #include <QCloseEvent>
 #include <QMessageBox>
 #include <QScrollArea>
 #include <QClipboard>
 #include <QStatusBar>
 #include <QTabWidget>
+#include <QTextStream>
 #include <QSettings>
 #include <QMenuBar>
 #include <QTabBar>
 #include <QLabel>
+#include <QFile>
 
 #ifdef Q_OS_WIN
 #   include <sys/utime.h>
@@ -38,6 +41,7 @@
 #endif
 
 #include "WalletTransactionsWidget.h"
+#include "CacheStatisticsProvider.h"
 #include "CharacterManagerDialog.h"
 #include "NewCharacterController.h"
 #include "MarketAnalysisWidget.h"
@@ -51,6 +55,7 @@
 #include "ActiveTasksDialog.h"
 #include "PreferencesDialog.h"
 #include "MarketOrderWidget.h"
+#include "PreparedQueryCache.h"
 #include "MarginToolDialog.h"
 #include "StatisticsWidget.h"
 #include "CharacterWidget.h"
@@ -62,6 +67,7 @@
 #include "ImportSettings.h"
 #include "ClickableLabel.h"
 #include "MenuBarWidget.h"
+#include "QueryStatistics.h"
 #include "PriceSettings.h"
 #include "SSOMessageBox.h"
 #include "SyncSettings.h"
@@ -96,12 +102,15 @@ namespace Evernus
                            const LMeveDataProvider &lMeveDataProvider,
                            ESIInterfaceManager &interfaceManager,
                            TaskManager &taskManager,
+                           const CacheStatisticsProvider &cacheStatisticsProvider,
                            QWidget *parent,
                            Qt::WindowFlags flags)
         : QMainWindow{parent, flags}
         , mRepositoryProvider{repositoryProvider}
         , mItemCostProvider{itemCostProvider}
         , mEveDataProvider{eveDataProvider}
+        , mCacheStatisticsProvider{cacheStatisticsProvider}
+        , mInterfaceManager{interfaceManager}
         , mCitadelAccessCache{interfaceManager.getCitadelAccessCache()}
         , mTrayIcon{new QSystemTrayIcon{QIcon{QStringLiteral(":/images/main-icon.png")}, this}}
         , mStatusActiveTasksThrobber{QStringLiteral(":/images/loader.gif")}
@@ -504,6 +513,74 @@ namespace Evernus
         QMessageBox::information(this, tr("Evernus"), tr("HTTP link was copied to the clipboard."));
     }
 
+    void MainWindow::saveDatabaseStatistics()
+    {
+        const auto fileName = QFileDialog::getSaveFileName(this, tr("Save database statistics"), QString{}, tr("Text files (*.txt)"));
+        if (fileName.isEmpty())
+            return;
+
+        QFile file{fileName};
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            QMessageBox::warning(this, tr("Error"), tr("Error saving database statistics."));
+            return;
+        }
+
+        QTextStream stream{&file};
+        QueryStatistics::dump(stream);
+
+        stream << "\nprepared statement cache hits: " << PreparedQueryCache::getHits()
+               << ", misses: " << PreparedQueryCache::getMisses() << '\n';
+
+        stream << "\nhits\tmisses\thit ratio\tcontentions\tevictions\tentries\tbytes\tbudget\tcache\n";
+        for (const auto &cache : mCacheStatisticsProvider.getCacheStatistics())
+        {
+            const auto &stats = cache.mStats;
+            stream << stats.mHits << '\t'
+                   << stats.mMisses << '\t'
+                   << stats.getHitRatio() << '\t'
+                   << stats.mContentions << '\t'
+                   << stats.mEvictions << '\t'
+                   << stats.mEntries << '\t'
+                   << stats.mBytes << '\t'
+                   << stats.mBudget << '\t'
+                   << cache.mName << '\n';
+        }
+
+        const auto rateLimits = mInterfaceManager.getRateLimiterStats();
+
+        stream << "\nESI error limit remain: " << rateLimits.mErrorLimitRemain
+               << ", reset in: " << rateLimits.mErrorLimitReset.count()
+               << "s, reserve: " << rateLimits.mErrorLimitReserve
+               << ", waits: " << rateLimits.mErrorLimitWaits << '\n';
+
+        stream << "tokens\tlimit\twindow\trequests\twaits\trejections\ttotal wait\tqueued\tgroup\n";
+        for (const auto &group : rateLimits.mGroups)
+        {
+            stream << group.mTokens << '\t'
+                   << group.mLimit << '\t'
+                   << group.mWindow.count() << '\t'
+                   << group.mRequests << '\t'
+                   << group.mWaits << '\t'
+                   << group.mRejections << '\t'
+                   << group.mTotalWait.count() << '\t'
+                   << group.mQueued << '\t'
+                   << group.mGroup << '\n';
+        }
+
+        stream << "\nrequests\tcancelled\tactive\tqueued\ttotal wait\tmax wait\tpriority\n";
+        for (const auto &priority : mInterfaceManager.getRequestSchedulerStats())
+        {
+            stream << priority.mRequests << '\t'
+                   << priority.mCancelled << '\t'
+                   << priority.mActive << '\t'
+                   << priority.mQueued << '\t'
+                   << priority.mTotalWait.count() << '\t'
+                   << priority.mMaxWait.count() << '\t'
+                   << ESIRequestScheduler::getPriorityName(priority.mPriority) << '\n';
+        }
+    }
+
     void MainWindow::showMarketBrowser(EveType::IdType typeId)
     {
         mMainTabs->setCurrentIndex(mMarketBrowserTabIndex);
@@ -624,6 +701,7 @@ namespace Evernus
         toolsMenu->addAction(tr("Custom &Fast Price Copy"), this, &MainWindow::showCustomFPC);
         toolsMenu->addSeparator();
         toolsMenu->addAction(tr("Copy HTTP link"), this, &MainWindow::copyHTTPLink);
+        toolsMenu->addAction(tr("Save database statistics..."), this, &MainWindow::saveDatabaseStatistics);
 #ifdef EVERNUS_DROPBOX_ENABLED
         toolsMenu->addSeparator();
         toolsMenu->addAction(QIcon{":/images/arrow_refresh.png"}, tr("Upload data to cloud..."), this, &MainWindow::performSync);
@@ -39,6 +39,7 @@ class QWinTaskbarButton;
 
 namespace Evernus
 {
+    class CacheStatisticsProvider;
     class CharacterManagerDialog;
     class MarketOrderProvider;
     class ESIInterfaceManager;
@@ -78,6 +79,7 @@ namespace Evernus
                    const LMeveDataProvider &lMeveDataProvider,
                    ESIInterfaceManager &interfaceManager,
                    TaskManager &taskManager,
+                   const CacheStatisticsProvider &cacheStatisticsProvider,
                    QWidget *parent = nullptr,
                    Qt::WindowFlags flags = 0);
         virtual ~MainWindow() = default;
@@ -194,6 +196,7 @@ namespace Evernus
 
         void activateTrayIcon(QSystemTrayIcon::ActivationReason reason);
         void copyHTTPLink();
+        void saveDatabaseStatistics();
 
         void showMarketBrowser(EveType::IdType typeId);
 
@@ -226,6 +229,8 @@ namespace Evernus
         ItemCostProvider &mItemCostProvider;
 
         EveDataProvider &mEveDataProvider;
+        const CacheStatisticsProvider &mCacheStatisticsProvider;
+        const ESIInterfaceManager &mInterfaceManager;
 
         CitadelAccessCache &mCitadelAccessCache;
 
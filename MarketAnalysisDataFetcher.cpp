@@ -34,7 +34,7 @@ namespace Evernus
                                                          QObject *parent)
         : QObject{parent}
         , mDataProvider{dataProvider}
-        , mESIManager{mDataProvider, interfaceManager}
+        , mESIManager{mDataProvider, interfaceManager, ESIRequestScheduler::Priority::BulkMarket}
     {
         connect(&mESIManager, &ESIManager::error, this, &MarketAnalysisDataFetcher::genericError);
     }
@@ -58,6 +58,21 @@ namespace Evernus
             this_->mPreparingRequests = false;
         } BOOST_SCOPE_EXIT_END
 
+        if (!mOrderCounter.isEmpty() || !mHistoryCounter.isEmpty())
+        {
+            qDebug() << "Superseding market analysis import with" << mOrderCounter.getCount() << mHistoryCounter.getCount() << "requests pending.";
+
+            // the new import replaces the old one, so there's no point in waiting for what's still queued
+            ++mGeneration;
+            mESIManager.cancelPendingRequests();
+
+            mOrderCounter.reset();
+            mHistoryCounter.reset();
+
+            mAggregatedOrderErrors.clear();
+            mAggregatedHistoryErrors.clear();
+        }
+
         if (mOrderCounter.isEmpty())
         {
             mOrders = std::make_shared<OrderResultType::element_type>();
@@ -78,14 +93,23 @@ namespace Evernus
         if (!useWholeMarketImport && marketImportType == ImportSettings::MarketOrderImportType::Auto)
             useWholeMarketImport = SSOUtils::useWholeMarketImport(pairs, mDataProvider);
 
+        // processing events while making requests can start a newer import, which takes over from here
+        const auto generation = mGeneration;
+
         if (useWholeMarketImport)
             importWholeMarketData(pairs, ignored);
         else
             importIndividualData(pairs, ignored);
 
+        if (generation != mGeneration)
+            return;
+
         if (settings.value(OrderSettings::importFromCitadelsKey, OrderSettings::importFromCitadelsDefault).toBool())
             importCitadelData(pairs, ignored, charId);
 
+        if (generation != mGeneration)
+            return;
+
         qDebug() << "Making" << mOrderCounter.getCount() << mHistoryCounter.getCount() << "order and history requests...";
 
         emit orderStatusUpdated(tr("Waiting for %1 order server replies...").arg(mOrderCounter.getCount()));
@@ -97,8 +121,11 @@ namespace Evernus
             finishHistoryImport();
     }
 
-    void MarketAnalysisDataFetcher::processOrders(std::vector<ExternalOrder> &&orders, const QString &errorText)
+    void MarketAnalysisDataFetcher::processOrders(uint generation, std::vector<ExternalOrder> &&orders, const QString &errorText)
     {
+        if (generation != mGeneration)
+            return;
+
         if (mOrderCounter.advanceAndCheckBatch())
             emit orderStatusUpdated(tr("Waiting for %1 order server replies...").arg(mOrderCounter.getCount()));
 
@@ -124,8 +151,11 @@ namespace Evernus
     }
 
     void MarketAnalysisDataFetcher
-    ::processHistory(uint regionId, EveType::IdType typeId, std::map<QDate, MarketHistoryEntry> &&history, const QString &errorText)
+    ::processHistory(uint generation, uint regionId, EveType::IdType typeId, std::map<QDate, MarketHistoryEntry> &&history, const QString &errorText)
     {
+        if (generation != mGeneration)
+            return;
+
         if (mHistoryCounter.advanceAndCheckBatch())
             emit historyStatusUpdated(tr("Waiting for %1 history server replies...").arg(mHistoryCounter.getCount()));
 
@@ -150,6 +180,8 @@ namespace Evernus
     void MarketAnalysisDataFetcher::importWholeMarketData(const TypeLocationPairs &pairs,
                                                           const TypeLocationPairs &ignored)
     {
+        const auto generation = mGeneration;
+
         std::unordered_set<uint> regions;
         for (const auto &pair : pairs)
         {
@@ -159,11 +191,13 @@ namespace Evernus
             mHistoryCounter.incCount();
             mESIManager.fetchMarketHistory(pair.second, pair.first, [=](auto &&history, const auto &error, const auto &expires) {
                 Q_UNUSED(expires);
-                processHistory(pair.second, pair.first, std::move(history), error);
+                processHistory(generation, pair.second, pair.first, std::move(history), error);
             });
 
             regions.insert(pair.second);
             processEvents();
+            if (generation != mGeneration)
+                return;
         }
 
         mOrderCounter.addCount(regions.size());
@@ -174,16 +208,20 @@ namespace Evernus
                 Q_UNUSED(expires);
 
                 filterOrders(orders, pairs);
-                processOrders(std::move(orders), error);
+                processOrders(generation, std::move(orders), error);
             });
 
             processEvents();
+            if (generation != mGeneration)
+                return;
         }
     }
 
     void MarketAnalysisDataFetcher::importIndividualData(const TypeLocationPairs &pairs,
                                                          const TypeLocationPairs &ignored)
     {
+        const auto generation = mGeneration;
+
         for (const auto &pair : pairs)
         {
             if (ignored.find(pair) != std::end(ignored))
@@ -194,15 +232,17 @@ namespace Evernus
 
             mESIManager.fetchMarketOrders(pair.second, pair.first, [=](auto &&orders, const auto &error, const auto &expires) {
                 Q_UNUSED(expires);
-                processOrders(std::move(orders), error);
+                processOrders(generation, std::move(orders), error);
             });
 
             mESIManager.fetchMarketHistory(pair.second, pair.first, [=](auto &&history, const auto &error, const auto &expires) {
                 Q_UNUSED(expires);
-                processHistory(pair.second, pair.first, std::move(history), error);
+                processHistory(generation, pair.second, pair.first, std::move(history), error);
             });
 
             processEvents();
+            if (generation != mGeneration)
+                return;
         }
     }
 
@@ -210,6 +250,8 @@ namespace Evernus
                                                       const TypeLocationPairs &ignored,
                                                       Character::IdType charId)
     {
+        const auto generation = mGeneration;
+
         std::unordered_set<uint> regions;
         for (const auto &pair : pairs)
         {
@@ -234,10 +276,12 @@ namespace Evernus
                     Q_UNUSED(expires);
 
                     filterOrders(orders, pairs);
-                    processOrders(std::move(orders), error);
+                    processOrders(generation, std::move(orders), error);
                 });
 
                 processEvents();
+                if (generation != mGeneration)
+                    return;
             }
         }
     }
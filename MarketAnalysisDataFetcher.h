@@ -74,6 +74,9 @@ namespace Evernus
         ProgressiveCounter mOrderCounter, mHistoryCounter;
         bool mPreparingRequests = false;
 
+        // replies from superseded imports carry an older generation and are ignored
+        uint mGeneration = 0;
+
         QStringList mAggregatedOrderErrors, mAggregatedHistoryErrors;
 
         OrderResultType mOrders;
@@ -81,8 +84,8 @@ namespace Evernus
 
         AggregatedEventProcessor mEventProcessor;
 
-        void processOrders(std::vector<ExternalOrder> &&orders, const QString &errorText);
-        void processHistory(uint regionId, EveType::IdType typeId, std::map<QDate, MarketHistoryEntry> &&history, const QString &errorText);
+        void processOrders(uint generation, std::vector<ExternalOrder> &&orders, const QString &errorText);
+        void processHistory(uint generation, uint regionId, EveType::IdType typeId, std::map<QDate, MarketHistoryEntry> &&history, const QString &errorText);
 
         void importWholeMarketData(const TypeLocationPairs &pairs,
                                    const TypeLocationPairs &ignored);
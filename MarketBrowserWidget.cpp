@@ -756,7 +756,7 @@ namespace Evernus
             "SELECT type_id, location_id FROM %2 WHERE state = ? "
             "UNION "
             "SELECT type_id, location_id FROM %3"
-        ") ids"}.arg(mOrderRepo.getTableName()).arg(mCorpOrderRepo.getTableName()).arg(mExternalOrderRepo.getTableName()));
+        ") ids"}.arg(mOrderRepo.getTableName()).arg(mCorpOrderRepo.getTableName()).arg(mExternalOrderRepo.getReadTableName()));
 
         query.addBindValue(static_cast<int>(MarketOrder::State::Active));
         query.addBindValue(static_cast<int>(MarketOrder::State::Active));
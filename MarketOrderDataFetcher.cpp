@@ -35,7 +35,7 @@ namespace Evernus
                                                    QObject *parent)
         : QObject{parent}
         , mDataProvider{dataProvider}
-        , mESIManager{mDataProvider, interfaceManager}
+        , mESIManager{mDataProvider, interfaceManager, ESIRequestScheduler::Priority::Interactive}
     {
         connect(&mESIManager, &ESIManager::error, this, &MarketOrderDataFetcher::genericError);
     }
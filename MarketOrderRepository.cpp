@@ -36,47 +36,65 @@ namespace Evernus
         return QStringLiteral("id");
     }
 
-    MarketOrderRepository::EntityPtr MarketOrderRepository::populate(const QSqlRecord &record) const
+    template<class Row>
+    MarketOrderRepository::EntityPtr MarketOrderRepository::decodeRow(const Row &row, const ColumnOrdinals &ordinals) const
     {
-        auto issued = record.value(QStringLiteral("issued")).toDateTime();
+        auto issued = row.value(ordinals[IssuedColumn]).toDateTime();
         issued.setTimeSpec(Qt::UTC);
 
-        auto firstSeen = record.value(QStringLiteral("first_seen")).toDateTime();
+        auto firstSeen = row.value(ordinals[FirstSeenColumn]).toDateTime();
         firstSeen.setTimeSpec(Qt::UTC);
 
-        auto lastSeen = record.value(QStringLiteral("last_seen")).toDateTime();
+        auto lastSeen = row.value(ordinals[LastSeenColumn]).toDateTime();
         lastSeen.setTimeSpec(Qt::UTC);
 
-        auto marketOrder = std::make_shared<MarketOrder>(record.value(getIdColumn()).value<MarketOrder::IdType>());
-        marketOrder->setCharacterId(record.value(QStringLiteral("character_id")).value<Character::IdType>());
-        marketOrder->setStationId(record.value(QStringLiteral("location_id")).toULongLong());
-        marketOrder->setVolumeEntered(record.value(QStringLiteral("volume_entered")).toUInt());
-        marketOrder->setVolumeRemaining(record.value(QStringLiteral("volume_remaining")).toUInt());
-        marketOrder->setMinVolume(record.value(QStringLiteral("min_volume")).toUInt());
-        marketOrder->setDelta(record.value(QStringLiteral("delta")).toInt());
-        marketOrder->setState(static_cast<MarketOrder::State>(record.value(QStringLiteral("state")).toInt()));
-        marketOrder->setTypeId(record.value(QStringLiteral("type_id")).value<EveType::IdType>());
-        marketOrder->setRange(record.value(QStringLiteral("range")).value<short>());
-        marketOrder->setAccountKey(record.value(QStringLiteral("account_key")).value<short>());
-        marketOrder->setDuration(record.value(QStringLiteral("duration")).value<short>());
-        marketOrder->setEscrow(record.value(QStringLiteral("escrow")).toDouble());
-        marketOrder->setPrice(record.value(QStringLiteral("price")).toDouble());
-        marketOrder->setType(static_cast<MarketOrder::Type>(record.value(QStringLiteral("type")).toInt()));
+        auto marketOrder = std::make_shared<MarketOrder>(row.value(ordinals[IdColumn]).value<MarketOrder::IdType>());
+        marketOrder->setCharacterId(row.value(ordinals[CharacterIdColumn]).value<Character::IdType>());
+        marketOrder->setStationId(row.value(ordinals[LocationIdColumn]).toULongLong());
+        marketOrder->setVolumeEntered(row.value(ordinals[VolumeEnteredColumn]).toUInt());
+        marketOrder->setVolumeRemaining(row.value(ordinals[VolumeRemainingColumn]).toUInt());
+        marketOrder->setMinVolume(row.value(ordinals[MinVolumeColumn]).toUInt());
+        marketOrder->setDelta(row.value(ordinals[DeltaColumn]).toInt());
+        marketOrder->setState(static_cast<MarketOrder::State>(row.value(ordinals[StateColumn]).toInt()));
+        marketOrder->setTypeId(row.value(ordinals[TypeIdColumn]).value<EveType::IdType>());
+        marketOrder->setRange(row.value(ordinals[RangeColumn]).value<short>());
+        marketOrder->setAccountKey(row.value(ordinals[AccountKeyColumn]).value<short>());
+        marketOrder->setDuration(row.value(ordinals[DurationColumn]).value<short>());
+        marketOrder->setEscrow(row.value(ordinals[EscrowColumn]).toDouble());
+        marketOrder->setPrice(row.value(ordinals[PriceColumn]).toDouble());
+        marketOrder->setType(static_cast<MarketOrder::Type>(row.value(ordinals[TypeColumn]).toInt()));
         marketOrder->setIssued(issued);
         marketOrder->setFirstSeen(firstSeen);
         marketOrder->setLastSeen(lastSeen);
-        marketOrder->setCorporationId(record.value(QStringLiteral("corporation_id")).toULongLong());
-        if (!record.value(QStringLiteral("notes")).isNull())
-            marketOrder->setNotes(record.value(QStringLiteral("notes")).toString());
-        if (!record.value(QStringLiteral("custom_location_id")).isNull())
-            marketOrder->setCustomStationId(record.value(QStringLiteral("custom_location_id")).toULongLong());
-        if (!record.value(QStringLiteral("color_tag")).isNull())
-            marketOrder->setColorTag(record.value(QStringLiteral("color_tag")).toString());
+        marketOrder->setCorporationId(row.value(ordinals[CorporationIdColumn]).toULongLong());
+
+        const auto notes = row.value(ordinals[NotesColumn]);
+        if (!notes.isNull())
+            marketOrder->setNotes(notes.toString());
+
+        const auto customLocationId = row.value(ordinals[CustomLocationIdColumn]);
+        if (!customLocationId.isNull())
+            marketOrder->setCustomStationId(customLocationId.toULongLong());
+
+        const auto colorTag = row.value(ordinals[ColorTagColumn]);
+        if (!colorTag.isNull())
+            marketOrder->setColorTag(colorTag.toString());
+
         marketOrder->setNew(false);
 
         return marketOrder;
     }
 
+    MarketOrderRepository::EntityPtr MarketOrderRepository::populate(const QSqlRecord &record) const
+    {
+        return decodeRow(record, getColumnOrdinals(record));
+    }
+
+    MarketOrderRepository::EntityPtr MarketOrderRepository::populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const
+    {
+        return decodeRow(query, ordinals);
+    }
+
     void MarketOrderRepository::create(const Repository<Character> &characterRepo) const
     {
         exec(QStringLiteral("CREATE TABLE IF NOT EXISTS %1 ("
@@ -307,7 +325,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchForCharacter(Character::IdType characterId, MarketOrder::Type type) const
@@ -318,7 +336,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchForCorporation(uint corporationId, MarketOrder::Type type) const
@@ -329,7 +347,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchArchivedForCharacter(Character::IdType characterId) const
@@ -339,7 +357,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchArchivedForCorporation(uint corporationId) const
@@ -349,7 +367,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchFulfilled(const QDate &from, const QDate &to) const
@@ -361,7 +379,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchFulfilledForCharacter(const QDate &from, const QDate &to, Character::IdType characterId) const
@@ -374,7 +392,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        return populate(query);
+        return populateAll(query);
     }
 
     MarketOrderRepository::EntityList MarketOrderRepository::fetchFulfilledForCorporation(const QDate &from, const QDate &to, uint corporationId) const
@@ -385,7 +403,7 @@ namespace Evernus
         query.addBindValue(to);
         query.addBindValue(static_cast<int>(MarketOrder::State::Fulfilled));
 
-        return populate(query);
+        return populateAll(query);
     }
 
     TypeLocationPairs MarketOrderRepository::fetchActiveTypes() const
@@ -403,6 +421,21 @@ namespace Evernus
         return result;
     }
 
+    MarketOrderRepository::OrderIdList MarketOrderRepository::fetchActiveIds() const
+    {
+        auto query = prepare(QStringLiteral("SELECT %1 FROM %2 WHERE state = ?").arg(getIdColumn()).arg(getTableName()));
+        query.bindValue(0, static_cast<int>(MarketOrder::State::Active));
+
+        DatabaseUtils::execQuery(query);
+
+        OrderIdList result;
+
+        while (query.next())
+            result.insert(query.value(0).value<MarketOrder::IdType>());
+
+        return result;
+    }
+
     void MarketOrderRepository::archive(const std::vector<MarketOrder::IdType> &ids) const
     {
         const auto baseQuery = QStringLiteral("UPDATE %1 SET "
@@ -441,29 +474,35 @@ namespace Evernus
 
     void MarketOrderRepository::setNotes(MarketOrder::IdType id, const QString &notes) const
     {
-        auto query = prepare(QStringLiteral("UPDATE %1 SET notes = ? WHERE %2 = ?").arg(getTableName()).arg(getIdColumn()));
-        query.bindValue(0, notes);
-        query.bindValue(1, id);
+        execWrite([&] {
+            auto query = prepare(QStringLiteral("UPDATE %1 SET notes = ? WHERE %2 = ?").arg(getTableName()).arg(getIdColumn()));
+            query.bindValue(0, notes);
+            query.bindValue(1, id);
 
-        DatabaseUtils::execQuery(query);
+            DatabaseUtils::execQuery(query);
+        });
     }
 
     void MarketOrderRepository::setStation(MarketOrder::IdType orderId, uint stationId) const
     {
-        auto query = prepare(QStringLiteral("UPDATE %1 SET custom_location_id = ? WHERE %2 = ?").arg(getTableName()).arg(getIdColumn()));
-        query.bindValue(0, (stationId != 0) ? (stationId) : (QVariant{QVariant::UInt}));
-        query.bindValue(1, orderId);
+        execWrite([&] {
+            auto query = prepare(QStringLiteral("UPDATE %1 SET custom_location_id = ? WHERE %2 = ?").arg(getTableName()).arg(getIdColumn()));
+            query.bindValue(0, (stationId != 0) ? (stationId) : (QVariant{QVariant::UInt}));
+            query.bindValue(1, orderId);
 
-        DatabaseUtils::execQuery(query);
+            DatabaseUtils::execQuery(query);
+        });
     }
 
     void MarketOrderRepository::setColorTag(MarketOrder::IdType orderId, const QColor &color) const
     {
-        auto query = prepare(QStringLiteral("UPDATE %1 SET color_tag = ? WHERE %2 = ?").arg(getTableName()).arg(getIdColumn()));
-        query.bindValue(0, (color.isValid()) ? (color.name()) : (QVariant{QVariant::String}));
-        query.bindValue(1, orderId);
+        execWrite([&] {
+            auto query = prepare(QStringLiteral("UPDATE %1 SET color_tag = ? WHERE %2 = ?").arg(getTableName()).arg(getIdColumn()));
+            query.bindValue(0, (color.isValid()) ? (color.name()) : (QVariant{QVariant::String}));
+            query.bindValue(1, orderId);
 
-        DatabaseUtils::execQuery(query);
+            DatabaseUtils::execQuery(query);
+        });
     }
 
     QStringList MarketOrderRepository::getColumns() const
@@ -557,11 +596,7 @@ namespace Evernus
     {
         const auto batches = ids.size() / maxBatchSize;
 
-        QStringList list;
-        for (auto i = 0u; i < std::min(maxBatchSize, ids.size()); ++i)
-            list << QStringLiteral("?");
-
-        auto query = prepare(baseQuery.arg(list.join(QStringLiteral(", "))));
+        auto query = prepare(baseQuery.arg(DatabaseUtils::getPlaceholders(std::min(maxBatchSize, ids.size()))));
 
         auto executeBatch = [&](auto begin, auto end) {
             for (auto it = begin; it != end; ++it)
@@ -581,28 +616,10 @@ namespace Evernus
         const auto reminderBegin = std::next(std::begin(ids), batches * maxBatchSize);
         if (reminderBegin != std::end(ids))
         {
-            list.clear();
-            for (auto it = reminderBegin; it != std::end(ids); ++it)
-                list << "?";
-
-            query = prepare(baseQuery.arg(list.join(QStringLiteral(", "))));
+            query = prepare(baseQuery.arg(DatabaseUtils::getPlaceholders(std::distance(reminderBegin, std::end(ids)))));
 
             valueBinder(query);
             executeBatch(reminderBegin, std::end(ids));
         }
     }
-
-    MarketOrderRepository::EntityList MarketOrderRepository::populate(QSqlQuery &query) const
-    {
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
-    }
 }
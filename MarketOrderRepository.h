@@ -108,6 +108,7 @@ namespace Evernus
                                                 uint corporationId) const;
 
         TypeLocationPairs fetchActiveTypes() const;
+        OrderIdList fetchActiveIds() const;
 
         void archive(const std::vector<MarketOrder::IdType> &ids) const;
         void fulfill(const std::vector<MarketOrder::IdType> &ids) const;
@@ -120,16 +121,47 @@ namespace Evernus
     private:
         bool mCorp = false;
 
+        // positions in getColumns()
+        enum Column
+        {
+            IdColumn,
+            CharacterIdColumn,
+            LocationIdColumn,
+            VolumeEnteredColumn,
+            VolumeRemainingColumn,
+            MinVolumeColumn,
+            DeltaColumn,
+            StateColumn,
+            TypeIdColumn,
+            RangeColumn,
+            AccountKeyColumn,
+            DurationColumn,
+            EscrowColumn,
+            PriceColumn,
+            TypeColumn,
+            IssuedColumn,
+            FirstSeenColumn,
+            LastSeenColumn,
+            CorporationIdColumn,
+            NotesColumn,
+            CustomLocationIdColumn,
+            ColorTagColumn
+        };
+
         virtual QStringList getColumns() const override;
         virtual void bindValues(const MarketOrder &entity, QSqlQuery &query) const override;
         virtual void bindPositionalValues(const MarketOrder &entity, QSqlQuery &query) const override;
 
+        virtual EntityPtr populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const override;
+
+        // single decoder for both populate() and populateRow(), so the two cannot drift apart
+        template<class Row>
+        EntityPtr decodeRow(const Row &row, const ColumnOrdinals &ordinals) const;
+
         template<class Binder>
         void execBoundValueBatch(size_t maxBatchSize,
                                  const QString &baseQuery,
                                  const std::vector<MarketOrder::IdType> &ids,
                                  const Binder &valueBinder) const;
-
-        EntityList populate(QSqlQuery &query) const;
     };
 }
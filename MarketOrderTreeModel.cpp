@@ -273,6 +273,15 @@ namespace Evernus
 
         std::unordered_map<quintptr, TreeItem *> groupItems;
 
+        EveDataProvider::LocationList locationIds;
+        for (const auto &order : data)
+        {
+            locationIds.emplace(order->getStationId());
+            locationIds.emplace(order->getEffectiveStationId());
+        }
+
+        mDataProvider.precacheLocations(locationIds);
+
         for (const auto &order : data)
         {
             auto item = std::make_unique<TreeItem>();
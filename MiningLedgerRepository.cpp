@@ -72,16 +72,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        EntityList result;
-
-        const auto size = query.size();
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     MiningLedgerRepository::TypeQuantityMap MiningLedgerRepository::fetchTypesForCharacter(Character::IdType characterId,
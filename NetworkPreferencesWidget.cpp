@@ -107,6 +107,25 @@ namespace Evernus
         mMaxRetriesEdit->setValue(
             settings.value(NetworkSettings::maxRetriesKey, NetworkSettings::maxRetriesDefault).toUInt());
 
+        mMaxConcurrentPageRequestsEdit = new QSpinBox{this};
+        miscGroupLayout->addRow(tr("Max. concurrent page requests:"), mMaxConcurrentPageRequestsEdit);
+        mMaxConcurrentPageRequestsEdit->setRange(1, 200);
+        mMaxConcurrentPageRequestsEdit->setValue(
+            settings.value(NetworkSettings::maxConcurrentPageRequestsKey, NetworkSettings::maxConcurrentPageRequestsDefault).toUInt());
+
+        mMaxConcurrentRequestsEdit = new QSpinBox{this};
+        miscGroupLayout->addRow(tr("Max. concurrent requests:"), mMaxConcurrentRequestsEdit);
+        mMaxConcurrentRequestsEdit->setRange(1, 200);
+        mMaxConcurrentRequestsEdit->setValue(
+            settings.value(NetworkSettings::maxConcurrentRequestsKey, NetworkSettings::maxConcurrentRequestsDefault).toUInt());
+
+        mErrorLimitReserveEdit = new QSpinBox{this};
+        miscGroupLayout->addRow(tr("ESI error reserve:"), mErrorLimitReserveEdit);
+        mErrorLimitReserveEdit->setRange(0, 99);
+        mErrorLimitReserveEdit->setToolTip(tr("Requests are held back when ESI allows only this many more errors before a temporary ban."));
+        mErrorLimitReserveEdit->setValue(
+            settings.value(NetworkSettings::errorLimitReserveKey, NetworkSettings::errorLimitReserveDefault).toUInt());
+
         mIgnoreSslErrors = new QCheckBox{tr("Ignore certificate errors"), this};
         miscGroupLayout->addRow(mIgnoreSslErrors);
         mIgnoreSslErrors->setChecked(
@@ -162,6 +181,9 @@ namespace Evernus
 
         settings.setValue(NetworkSettings::maxReplyTimeKey, mMaxReplyTimeEdit->value());
         settings.setValue(NetworkSettings::maxRetriesKey, mMaxRetriesEdit->value());
+        settings.setValue(NetworkSettings::maxConcurrentPageRequestsKey, mMaxConcurrentPageRequestsEdit->value());
+        settings.setValue(NetworkSettings::maxConcurrentRequestsKey, mMaxConcurrentRequestsEdit->value());
+        settings.setValue(NetworkSettings::errorLimitReserveKey, mErrorLimitReserveEdit->value());
         settings.setValue(NetworkSettings::ignoreSslErrorsKey, mIgnoreSslErrors->isChecked());
         settings.setValue(NetworkSettings::logESIRepliesKey, mLogESIReplies->isChecked());
         settings.setValue(NetworkSettings::useHTTP2Key, mUseHTTP2->isChecked());
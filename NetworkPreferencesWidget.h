@@ -53,6 +53,9 @@ namespace Evernus
 
         QSpinBox *mMaxReplyTimeEdit = nullptr;
         QSpinBox *mMaxRetriesEdit = nullptr;
+        QSpinBox *mMaxConcurrentPageRequestsEdit = nullptr;
+        QSpinBox *mMaxConcurrentRequestsEdit = nullptr;
+        QSpinBox *mErrorLimitReserveEdit = nullptr;
         QCheckBox *mIgnoreSslErrors = nullptr;
         QCheckBox *mLogESIReplies = nullptr;
         QCheckBox *mUseHTTP2 = nullptr;
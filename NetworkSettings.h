@@ -27,6 +27,9 @@ namespace Evernus
         const auto maxReplyTimeDefault = 1800u;
         const auto ignoreSslErrorsDefault = false;
         const auto maxRetriesDefault = 3u;
+        const auto maxConcurrentPageRequestsDefault = 16u;
+        const auto maxConcurrentRequestsDefault = 32u;
+        const auto errorLimitReserveDefault = 10u;
         const auto logESIRepliesDefault = false;
         const auto useHTTP2Default = true;
 
@@ -41,6 +44,9 @@ namespace Evernus
         const auto maxReplyTimeKey = QStringLiteral("network/maxReplyTime");
         const auto ignoreSslErrorsKey = QStringLiteral("network/security/ignoreSslErrors");
         const auto maxRetriesKey = QStringLiteral("network/maxRetries");
+        const auto maxConcurrentPageRequestsKey = QStringLiteral("network/maxConcurrentPageRequests");
+        const auto maxConcurrentRequestsKey = QStringLiteral("network/maxConcurrentRequests");
+        const auto errorLimitReserveKey = QStringLiteral("network/errorLimitReserve");
         const auto logESIRepliesKey = QStringLiteral("network/logESIReplies");
         const auto useHTTP2Key = QStringLiteral("network/useHTTP2");
     }
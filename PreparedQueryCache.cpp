@@ -0,0 +1,173 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdexcept>
+#include <vector>
+#include <atomic>
+#include <list>
+
+#include <boost/throw_exception.hpp>
+
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QHash>
+
+#include <QtDebug>
+
+#include "PreparedQueryCache.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        struct Statement
+        {
+            std::vector<QSqlQuery> mIdle;
+            std::list<QString>::iterator mLruPosition;
+        };
+
+        struct ConnectionStatements
+        {
+            // statements of a closed or re-added connection are useless, so they are dropped when this changes
+            const QSqlDriver *mDriver = nullptr;
+            QHash<QString, Statement> mStatements;
+            // most recently used first
+            std::list<QString> mLru;
+        };
+
+        thread_local QHash<QString, ConnectionStatements> queryCache;
+
+        std::atomic<quint64> cacheHits{0};
+        std::atomic<quint64> cacheMisses{0};
+    }
+
+    PreparedQueryCache::Handle::Handle(QSqlQuery query, QString connectionName, QString queryStr, bool cached)
+        : mQuery{std::move(query)}
+        , mConnectionName{std::move(connectionName)}
+        , mQueryStr{std::move(queryStr)}
+        , mCached{cached}
+    {
+    }
+
+    PreparedQueryCache::Handle::Handle(Handle &&other)
+        : mQuery{other.mQuery}
+        , mConnectionName{std::move(other.mConnectionName)}
+        , mQueryStr{std::move(other.mQueryStr)}
+        , mCached{other.mCached}
+    {
+        other.mCached = false;
+    }
+
+    PreparedQueryCache::Handle::~Handle()
+    {
+        if (!mCached)
+            return;
+
+        // release the statement (and any read lock it holds), but keep it compiled
+        mQuery.finish();
+
+        // the statement might have been evicted or its connection replaced in the meantime
+        const auto connection = queryCache.find(mConnectionName);
+        if (connection == std::end(queryCache) || connection->mDriver != mQuery.driver())
+            return;
+
+        const auto statement = connection->mStatements.find(mQueryStr);
+        if (statement != std::end(connection->mStatements) && statement->mIdle.size() < maxIdleQueriesPerStatement)
+            statement->mIdle.emplace_back(mQuery);
+    }
+
+    QSqlQuery &PreparedQueryCache::Handle::operator *() noexcept
+    {
+        return mQuery;
+    }
+
+    QSqlQuery *PreparedQueryCache::Handle::operator ->() noexcept
+    {
+        return &mQuery;
+    }
+
+    PreparedQueryCache::Handle PreparedQueryCache::acquire(const QSqlDatabase &db, const QString &queryStr)
+    {
+        auto connectionName = db.connectionName();
+        auto &connection = queryCache[connectionName];
+
+        const auto driver = db.driver();
+        if (connection.mDriver != driver || !db.isOpen())
+        {
+            connection.mStatements.clear();
+            connection.mLru.clear();
+            connection.mDriver = driver;
+        }
+
+        auto &statements = connection.mStatements;
+
+        auto it = statements.find(queryStr);
+        if (it != std::end(statements))
+        {
+            connection.mLru.splice(std::begin(connection.mLru), connection.mLru, it->mLruPosition);
+
+            if (!it->mIdle.empty())
+            {
+                ++cacheHits;
+
+                auto query = it->mIdle.back();
+                it->mIdle.pop_back();
+
+                return Handle{std::move(query), std::move(connectionName), queryStr, true};
+            }
+        }
+
+        ++cacheMisses;
+
+        QSqlQuery query{db};
+        if (!query.prepare(queryStr))
+        {
+            const auto error = query.lastError().text();
+
+            qCritical() << error;
+            BOOST_THROW_EXCEPTION(std::runtime_error{error.toStdString()});
+        }
+
+        if (it == std::end(statements))
+        {
+            // don't let ad-hoc statements grow the cache without bounds - make room by dropping the least recently used one
+            if (statements.size() >= maxStatementsPerConnection)
+            {
+                statements.remove(connection.mLru.back());
+                connection.mLru.pop_back();
+            }
+
+            connection.mLru.push_front(queryStr);
+            statements.insert(queryStr, Statement{{}, std::begin(connection.mLru)});
+        }
+
+        return Handle{std::move(query), std::move(connectionName), queryStr, true};
+    }
+
+    void PreparedQueryCache::removeConnection(const QString &connectionName)
+    {
+        queryCache.remove(connectionName);
+    }
+
+    quint64 PreparedQueryCache::getHits() noexcept
+    {
+        return cacheHits;
+    }
+
+    quint64 PreparedQueryCache::getMisses() noexcept
+    {
+        return cacheMisses;
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <QSqlQuery>
+#include <QString>
+
+class QSqlDatabase;
+
+namespace Evernus
+{
+    // Per-thread pool of prepared statements, keyed by connection and query text. Connections are per-thread, so
+    // pooled queries never cross threads and no locking is needed. Least recently used statements are dropped once a
+    // connection holds too many, and everything pooled for a connection is dropped once it gets closed or replaced.
+    class PreparedQueryCache final
+    {
+    public:
+        // Exclusive lease of a prepared query - returns it to the pool when destroyed.
+        class Handle final
+        {
+        public:
+            Handle(QSqlQuery query, QString connectionName, QString queryStr, bool cached);
+            Handle(const Handle &) = delete;
+            Handle(Handle &&other);
+            ~Handle();
+
+            QSqlQuery &operator *() noexcept;
+            QSqlQuery *operator ->() noexcept;
+
+            Handle &operator =(const Handle &) = delete;
+            Handle &operator =(Handle &&) = delete;
+
+        private:
+            QSqlQuery mQuery;
+            QString mConnectionName;
+            QString mQueryStr;
+            bool mCached = false;
+        };
+
+        PreparedQueryCache() = delete;
+
+        static Handle acquire(const QSqlDatabase &db, const QString &queryStr);
+        // drops this thread's statements for a connection about to be closed or removed
+        static void removeConnection(const QString &connectionName);
+
+        static quint64 getHits() noexcept;
+        static quint64 getMisses() noexcept;
+
+    private:
+        static const int maxStatementsPerConnection = 256;
+        static const size_t maxIdleQueriesPerStatement = 4;
+    };
+}
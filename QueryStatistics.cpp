@@ -0,0 +1,232 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QSqlDriver>
+#include <QSqlRecord>
+#include <QSqlResult>
+#include <QSqlQuery>
+#include <QHash>
+
+#include <QtDebug>
+
+#include "QueryStatistics.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        std::mutex statsMutex;
+        // keyed by the statement text as executed; normalizing on every exec would cost more than the bookkeeping
+        QHash<QString, QueryStatistics::Entry> stats;
+
+        std::atomic_bool statsEnabled{false};
+        std::atomic_int slowQueryThreshold{0};
+
+        // upper bucket bounds, in us
+        const qint64 bucketBounds[QueryStatistics::histogramBuckets - 1] = { 100, 1000, 10000, 100000, 1000000 };
+    }
+
+    void QueryStatistics::recordExec(const QString &statement, qint64 elapsed, int rowsAffected, const QSqlQuery &query)
+    {
+        const auto threshold = slowQueryThreshold.load(std::memory_order_relaxed);
+        if (threshold > 0 && elapsed >= threshold * 1000)
+            logSlowQuery(statement, elapsed, query);
+
+        if (!statsEnabled.load(std::memory_order_relaxed))
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock{statsMutex};
+
+            auto &entry = stats[statement];
+            if (entry.mStatement.isEmpty())
+                entry.mStatement = statement;
+
+            ++entry.mCount;
+            entry.mTotalTime += elapsed;
+            entry.mMaxTime = std::max(entry.mMaxTime, elapsed);
+            ++entry.mHistogram[getHistogramBucket(elapsed)];
+
+            if (rowsAffected > 0)
+                entry.mRows += rowsAffected;
+        }
+    }
+
+    void QueryStatistics::recordPopulate(const QString &statement, qint64 elapsed, std::size_t rows)
+    {
+        if (!statsEnabled.load(std::memory_order_relaxed))
+            return;
+
+        std::lock_guard<std::mutex> lock{statsMutex};
+
+        auto &entry = stats[statement];
+        if (entry.mStatement.isEmpty())
+            entry.mStatement = statement;
+
+        entry.mRows += rows;
+        entry.mPopulateTime += elapsed;
+    }
+
+    std::vector<QueryStatistics::Entry> QueryStatistics::getEntries()
+    {
+        QHash<QString, Entry> statsCopy;
+
+        {
+            std::lock_guard<std::mutex> lock{statsMutex};
+            statsCopy = stats;
+        }
+
+        // batches of different sizes should end up in one entry
+        QHash<QString, Entry> aggregated;
+        for (const auto &entry : statsCopy)
+        {
+            const auto normalized = normalizeStatement(entry.mStatement);
+
+            auto &target = aggregated[normalized];
+            target.mStatement = normalized;
+            target.mCount += entry.mCount;
+            target.mTotalTime += entry.mTotalTime;
+            target.mMaxTime = std::max(target.mMaxTime, entry.mMaxTime);
+            target.mRows += entry.mRows;
+            target.mPopulateTime += entry.mPopulateTime;
+
+            for (auto i = 0u; i < histogramBuckets; ++i)
+                target.mHistogram[i] += entry.mHistogram[i];
+        }
+
+        std::vector<Entry> result;
+        result.reserve(aggregated.size());
+
+        for (const auto &entry : aggregated)
+            result.emplace_back(entry);
+
+        std::sort(std::begin(result), std::end(result), [](const auto &a, const auto &b) {
+            return a.mTotalTime + a.mPopulateTime > b.mTotalTime + b.mPopulateTime;
+        });
+
+        return result;
+    }
+
+    void QueryStatistics::reset()
+    {
+        std::lock_guard<std::mutex> lock{statsMutex};
+        stats.clear();
+    }
+
+    void QueryStatistics::dump(QTextStream &stream)
+    {
+        const auto entries = getEntries();
+
+        stream << "count\ttotal [ms]\tavg [us]\tmax [us]\trows\tpopulate [ms]";
+        for (auto i = 0u; i < histogramBuckets; ++i)
+            stream << '\t' << getHistogramBucketLabel(i);
+
+        stream << "\tstatement\n";
+
+        for (const auto &entry : entries)
+        {
+            stream
+                << entry.mCount << '\t'
+                << entry.mTotalTime / 1000 << '\t'
+                << ((entry.mCount > 0) ? (entry.mTotalTime / static_cast<qint64>(entry.mCount)) : (0)) << '\t'
+                << entry.mMaxTime << '\t'
+                << entry.mRows << '\t'
+                << entry.mPopulateTime / 1000;
+
+            for (const auto count : entry.mHistogram)
+                stream << '\t' << count;
+
+            stream << '\t' << entry.mStatement.simplified() << '\n';
+        }
+    }
+
+    void QueryStatistics::setEnabled(bool enabled) noexcept
+    {
+        statsEnabled = enabled;
+    }
+
+    void QueryStatistics::setSlowQueryThreshold(int threshold) noexcept
+    {
+        slowQueryThreshold = threshold;
+    }
+
+    QString QueryStatistics::normalizeStatement(const QString &statement)
+    {
+        static const QRegularExpression placeholderList{QStringLiteral(R"(\?(?:\s*,\s*\?)+)")};
+        static const QRegularExpression rowList{QStringLiteral(R"(\(\?[^()]*\)(?:\s*,\s*\(\?[^()]*\))+)")};
+        static const QRegularExpression numbers{QStringLiteral(R"((?<![\w.])\d+(?:\.\d+)?)")};
+
+        auto result = statement;
+
+        if (result.contains(QLatin1Char{'?'}))
+        {
+            result.replace(placeholderList, QStringLiteral("?, ..."));
+            result.replace(rowList, QStringLiteral("(?, ...), ..."));
+        }
+
+        if (std::any_of(std::begin(result), std::end(result), [](auto c) { return c.isDigit(); }))
+            result.replace(numbers, QStringLiteral("#"));
+
+        return result;
+    }
+
+    void QueryStatistics::logSlowQuery(const QString &statement, qint64 elapsed, const QSqlQuery &query)
+    {
+        qWarning() << "Slow SQL query:" << elapsed / 1000 << "ms:" << statement;
+
+        const auto driver = query.driver();
+        if (driver == nullptr)
+            return;
+
+        // a new result on the same driver shares the connection of the original query
+        QSqlQuery explain{driver->createResult()};
+        if (!explain.prepare(QStringLiteral("EXPLAIN QUERY PLAN ") + statement))
+            return;
+
+        // the plan can depend on the values, so explain exactly what has been run
+        const auto boundValues = query.boundValues().size();
+        for (auto i = 0; i < boundValues; ++i)
+            explain.bindValue(i, query.boundValue(i));
+
+        if (!explain.exec())
+            return;
+
+        while (explain.next())
+        {
+            const auto record = explain.record();
+            qWarning() << "  plan:" << record.value(record.count() - 1).toString();
+        }
+    }
+
+    std::size_t QueryStatistics::getHistogramBucket(qint64 elapsed) noexcept
+    {
+        return std::upper_bound(std::begin(bucketBounds), std::end(bucketBounds), elapsed) - std::begin(bucketBounds);
+    }
+
+    QString QueryStatistics::getHistogramBucketLabel(std::size_t bucket)
+    {
+        if (bucket == 0)
+            return QStringLiteral("<%1us").arg(bucketBounds[0]);
+        if (bucket >= histogramBuckets - 1)
+            return QStringLiteral(">=%1us").arg(bucketBounds[histogramBuckets - 2]);
+
+        return QStringLiteral("<%1us").arg(bucketBounds[bucket]);
+    }
+}
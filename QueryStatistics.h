@@ -0,0 +1,67 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <array>
+
+#include <QString>
+
+class QTextStream;
+class QSqlQuery;
+
+namespace Evernus
+{
+    // Process-wide SQL timings, recorded per statement text and aggregated per statement template (placeholder lists and
+    // numeric literals collapsed) when read.
+    class QueryStatistics final
+    {
+    public:
+        static const std::size_t histogramBuckets = 6;
+
+        struct Entry
+        {
+            QString mStatement;
+            quint64 mCount = 0;
+            qint64 mTotalTime = 0;      // us
+            qint64 mMaxTime = 0;        // us
+            quint64 mRows = 0;          // affected or populated
+            qint64 mPopulateTime = 0;   // us
+            std::array<quint64, histogramBuckets> mHistogram{};
+        };
+
+        QueryStatistics() = delete;
+
+        // query has to be the executed one - slow queries are explained with its bound values
+        static void recordExec(const QString &statement, qint64 elapsed, int rowsAffected, const QSqlQuery &query);
+        static void recordPopulate(const QString &statement, qint64 elapsed, std::size_t rows);
+
+        static std::vector<Entry> getEntries();
+        static void reset();
+        static void dump(QTextStream &stream);
+
+        static void setEnabled(bool enabled) noexcept;
+        // in ms, 0 disables slow query logging
+        static void setSlowQueryThreshold(int threshold) noexcept;
+
+        static QString normalizeStatement(const QString &statement);
+
+    private:
+        static void logSlowQuery(const QString &statement, qint64 elapsed, const QSqlQuery &query);
+        static std::size_t getHistogramBucket(qint64 elapsed) noexcept;
+        static QString getHistogramBucketLabel(std::size_t bucket);
+    };
+}
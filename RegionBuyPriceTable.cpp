@@ -0,0 +1,127 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <unordered_set>
+#include <algorithm>
+#include <iterator>
+
+#include "SystemDistanceTable.h"
+#include "ExternalOrder.h"
+
+#include "RegionBuyPriceTable.h"
+
+namespace Evernus
+{
+    RegionBuyPriceTable::RegionBuyPriceTable(const ExternalOrderRepository::EntityList &orders,
+                                             const std::vector<uint> &regionSystems,
+                                             const SystemDistanceTable &distances)
+        : mDistances{&distances}
+    {
+        mOrders.reserve(orders.size());
+        std::copy_if(std::begin(orders), std::end(orders), std::back_inserter(mOrders), [](const auto &order) {
+            return order->getPrice() > 0.;
+        });
+
+        // stable, so equal prices resolve to the first order like a linear scan would
+        std::stable_sort(std::begin(mOrders), std::end(mOrders), [](const auto &a, const auto &b) {
+            return a->getPrice() > b->getPrice();
+        });
+
+        // systems without in-region jumps can still have orders of their own
+        std::unordered_set<uint> systems{std::begin(regionSystems), std::end(regionSystems)};
+        for (const auto &order : mOrders)
+        {
+            systems.emplace(order->getSolarSystemId());
+
+            if (order->getRange() == -1)
+                mStationOrders.emplace(order->getStationId(), order);
+        }
+
+        mSystems.assign(std::begin(systems), std::end(systems));
+    }
+
+    ExternalOrderRepository::EntityPtr RegionBuyPriceTable::getBestOrder(quint64 stationId, uint solarSystemId, int range) const
+    {
+        const auto &systemOrders = getSystemOrders(range);
+
+        const auto systemOrder = systemOrders.find(solarSystemId);
+        auto result = (systemOrder == std::end(systemOrders)) ? (ExternalOrderRepository::EntityPtr{}) : (systemOrder->second);
+
+        if (range == -1)
+        {
+            const auto stationOrder = mStationOrders.find(stationId);
+            if (stationOrder != std::end(mStationOrders) && (!result || stationOrder->second->getPrice() > result->getPrice()))
+                result = stationOrder->second;
+        }
+
+        return result;
+    }
+
+    bool RegionBuyPriceTable::hasRange(int range) const
+    {
+        std::lock_guard<std::mutex> lock{mSystemOrdersMutex};
+        return mSystemOrders.find(range) != std::end(mSystemOrders);
+    }
+
+    std::size_t RegionBuyPriceTable::getMemoryUsage() const
+    {
+        const auto nodeSize = sizeof(quint64) + sizeof(ExternalOrderRepository::EntityPtr) + 2 * sizeof(void *);
+
+        auto usage = sizeof(*this)
+                   + mOrders.capacity() * sizeof(ExternalOrderRepository::EntityPtr)
+                   + mSystems.capacity() * sizeof(uint)
+                   + mStationOrders.size() * nodeSize;
+
+        std::lock_guard<std::mutex> lock{mSystemOrdersMutex};
+
+        for (const auto &systemOrders : mSystemOrders)
+            usage += sizeof(systemOrders) + systemOrders.second.size() * nodeSize;
+
+        return usage;
+    }
+
+    const RegionBuyPriceTable::SystemOrderMap &RegionBuyPriceTable::getSystemOrders(int range) const
+    {
+        std::lock_guard<std::mutex> lock{mSystemOrdersMutex};
+
+        const auto it = mSystemOrders.find(range);
+        if (it != std::end(mSystemOrders))
+            return it->second;
+
+        auto &result = mSystemOrders[range];
+
+        // orders are sorted by price, so the first one reaching a system is the best for it
+        const uint realRange = (range < 0) ? (0) : (range);
+        for (const auto &order : mOrders)
+        {
+            if (result.size() == mSystems.size())
+                break;
+
+            // station orders for station-only queries are resolved separately
+            if (order->getRange() == -1 && range == -1)
+                continue;
+
+            const auto orderSystem = order->getSolarSystemId();
+            const auto reach = (order->getRange() == -1) ? (realRange) : (order->getRange() + realRange);
+
+            for (const auto system : mSystems)
+            {
+                if (result.find(system) == std::end(result) && mDistances->getDistance(system, orderSystem) <= reach)
+                    result.emplace(system, order);
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "ExternalOrderRepository.h"
+
+namespace Evernus
+{
+    class SystemDistanceTable;
+
+    // best reachable buy order of a single type for every station in a region
+    // per-range tables are built on first use, under a lock of this table only
+    class RegionBuyPriceTable final
+    {
+    public:
+        RegionBuyPriceTable(const ExternalOrderRepository::EntityList &orders,
+                            const std::vector<uint> &regionSystems,
+                            const SystemDistanceTable &distances);
+        RegionBuyPriceTable(const RegionBuyPriceTable &) = delete;
+        RegionBuyPriceTable(RegionBuyPriceTable &&) = delete;
+        ~RegionBuyPriceTable() = default;
+
+        // range follows market order semantics: -1 means station only; yields null if nothing reaches the station
+        ExternalOrderRepository::EntityPtr getBestOrder(quint64 stationId, uint solarSystemId, int range) const;
+        bool hasRange(int range) const;
+
+        // grows as tables for new ranges get built; orders are shared with the source and not counted
+        std::size_t getMemoryUsage() const;
+
+        RegionBuyPriceTable &operator =(const RegionBuyPriceTable &) = delete;
+        RegionBuyPriceTable &operator =(RegionBuyPriceTable &&) = delete;
+
+    private:
+        using SystemOrderMap = std::unordered_map<uint, ExternalOrderRepository::EntityPtr>;
+
+        const SystemDistanceTable *mDistances = nullptr;
+
+        ExternalOrderRepository::EntityList mOrders;
+        std::vector<uint> mSystems;
+        std::unordered_map<quint64, ExternalOrderRepository::EntityPtr> mStationOrders;
+
+        mutable std::mutex mSystemOrdersMutex;
+        // elements are never removed, so references to them stay valid without the lock
+        mutable std::unordered_map<int, SystemOrderMap> mSystemOrders;
+
+        const SystemOrderMap &getSystemOrders(int range) const;
+    };
+}
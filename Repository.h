@@ -14,10 +14,15 @@
  */
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <memory>
 
 #include <QSqlDatabase>
+#include <QVariant>
+#include <QFuture>
+
+#include "PreparedQueryCache.h"
 
 namespace Evernus
 {
@@ -42,6 +47,7 @@ namespace Evernus
 
         QSqlQuery exec(const QString &query) const;
         QSqlQuery prepare(const QString &queryStr) const;
+        PreparedQueryCache::Handle prepareCached(const QString &queryStr) const;
         void store(T &entity) const;
 
         template<class U>
@@ -54,14 +60,52 @@ namespace Evernus
 
         template<class Id>
         EntityPtr find(Id &&id) const;
+        // resolves a whole id set in chunked IN queries; ids not found are omitted
+        template<class Ids>
+        EntityList findMany(const Ids &ids) const;
+
+        // async reads run on DatabaseWorkerPool and async writes on the DatabaseWriter, if the connection has one
+        // use DatabaseWorkerPool::onFinished() to get results on the caller thread
+        QFuture<EntityList> fetchAllAsync() const;
+        // yields null if not found
+        QFuture<EntityPtr> findAsync(typename T::IdType id) const;
+
+        template<class U>
+        QFuture<void> batchStoreAsync(U entities, bool hasId, bool wrapIntransaction = true) const;
+
+        template<class Derived, class R, class... Params, class... Args>
+        QFuture<R> fetchAsync(R (Derived::*method)(Params...) const, Args... args) const;
 
         QSqlDatabase getDatabase() const;
 
         typename T::IdType getLastInsertId() const;
 
     protected:
+        using ColumnOrdinals = std::vector<int>;
+
         const size_t maxSqliteBoundVariables = 999;
 
+        EntityList populateAll(QSqlQuery &query) const;
+        ColumnOrdinals getColumnOrdinals(const QSqlRecord &record) const;
+
+        // queryStr must contain a %1 placeholder for the IN list, bound after leadingValues; callback is invoked with
+        // each executed chunk
+        template<class Ids, class Callback>
+        void execForIdChunks(const QString &queryStr,
+                             const Ids &ids,
+                             const Callback &callback,
+                             const QVariantList &leadingValues = QVariantList{}) const;
+
+        // runs a write on the DatabaseWriter, if the connection has one, and waits for it
+        void execWrite(const std::function<void ()> &write) const;
+
+        template<class RowBinder>
+        void execBatchReplace(const QString &tableName,
+                              const QStringList &columns,
+                              size_t totalRows,
+                              size_t maxRowsPerBatch,
+                              const RowBinder &rowBinder) const;
+
     private:
         const DatabaseConnectionProvider &mConnectionProvider;
 
@@ -72,6 +116,8 @@ namespace Evernus
         virtual void bindValues(const T &entity, QSqlQuery &query) const = 0;
         virtual void bindPositionalValues(const T &entity, QSqlQuery &query) const = 0;
 
+        virtual EntityPtr populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const;
+
         virtual void preStore(T &entity) const;
         virtual void postStore(T &entity) const;
 
@@ -13,7 +13,9 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stdexcept>
+#include <iterator>
 
+#include <QElapsedTimer>
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -21,6 +23,9 @@
 #include <QtDebug>
 
 #include "DatabaseConnectionProvider.h"
+#include "DatabaseWorkerPool.h"
+#include "DatabaseWriter.h"
+#include "QueryStatistics.h"
 #include "DatabaseUtils.h"
 
 namespace Evernus
@@ -34,10 +39,11 @@ namespace Evernus
     template<class T>
     QSqlQuery Repository<T>::exec(const QString &query) const
     {
-        qDebug() << "SQL:" << query;
-
         const auto db = getDatabase();
 
+        QElapsedTimer timer;
+        timer.start();
+
         auto result = db.exec(query);
         const auto error = db.lastError();
 
@@ -45,10 +51,15 @@ namespace Evernus
         {
             const auto errorText = error.text();
 
-            qCritical() << errorText;
+            qCritical() << errorText << query;
             throw std::runtime_error{errorText.toStdString()};
         }
 
+        QueryStatistics::recordExec(query,
+                                    timer.nsecsElapsed() / 1000,
+                                    (result.isSelect()) ? (0) : (result.numRowsAffected()),
+                                    result);
+
         return result;
     }
 
@@ -67,20 +78,28 @@ namespace Evernus
         return query;
     }
 
+    template<class T>
+    PreparedQueryCache::Handle Repository<T>::prepareCached(const QString &queryStr) const
+    {
+        return PreparedQueryCache::acquire(getDatabase(), queryStr);
+    }
+
     template<class T>
     void Repository<T>::store(T &entity) const
     {
-        preStore(entity);
+        execWrite([&] {
+            preStore(entity);
 
-        if (entity.isNew())
-            insert(entity);
-        else
-            update(entity);
+            if (entity.isNew())
+                insert(entity);
+            else
+                update(entity);
 
-        entity.updateOriginalId();
-        entity.setNew(false);
+            entity.updateOriginalId();
+            entity.setNew(false);
 
-        postStore(entity);
+            postStore(entity);
+        });
     }
 
     template<class T>
@@ -90,117 +109,260 @@ namespace Evernus
         if (entities.empty())
             return;
 
-        const auto maxRowsPerInsert = getMaxRowsPerInsert();
-        const auto totalRows = entities.size();
-        const auto batches = totalRows / maxRowsPerInsert;
+        execWrite([&] {
+            auto columns = getColumns();
+            if (!hasId)
+                columns.removeOne(getIdColumn());
 
-        auto columns = getColumns();
-
-        QStringList columnBindings;
-        for (auto i = 0; i < columns.size(); ++i)
-            columnBindings << "?";
+            auto db = getDatabase();
 
-        if (!hasId)
-        {
-            columns.removeOne(getIdColumn());
-            columnBindings.removeLast();
-        }
+            if (wrapIntransaction)
+                db.transaction();
 
-        const auto bindingStr = QStringLiteral("(") + columnBindings.join(QStringLiteral(", ")) + QStringLiteral(")");
+            try
+            {
+                auto row = std::begin(entities);
+                execBatchReplace(getTableName(), columns, entities.size(), getMaxRowsPerInsert(), [&](auto &query) {
+                    bindPositionalValues(*row, query);
+                    ++row;
+                });
+            }
+            catch (...)
+            {
+                if (wrapIntransaction)
+                    db.rollback();
 
-        const auto baseQueryStr = QStringLiteral("REPLACE INTO %1 (%2) VALUES %3")
-            .arg(getTableName())
-            .arg(columns.join(QStringLiteral(", ")));
+                throw;
+            }
 
-        QStringList batchBindings;
-        for (auto i = 0u; i < maxRowsPerInsert; ++i)
-            batchBindings << bindingStr;
+            if (wrapIntransaction)
+                db.commit();
+        });
+    }
 
-        const auto batchQueryStr = baseQueryStr.arg(batchBindings.join(", "));
+    template<class T>
+    template<class Id>
+    void Repository<T>::remove(Id &&id) const
+    {
+        execWrite([&] {
+            auto query = prepareCached(QStringLiteral("DELETE FROM %1 WHERE %2 = :id").arg(getTableName()).arg(getIdColumn()));
+            query->bindValue(QStringLiteral(":id"), id);
+            DatabaseUtils::execQuery(*query);
+        });
+    }
 
-        auto db = getDatabase();
+    template<class T>
+    typename Repository<T>::EntityList Repository<T>::fetchAll() const
+    {
+        auto result = exec(QStringLiteral("SELECT * FROM %1").arg(getTableName()));
+        return populateAll(result);
+    }
 
-        if (wrapIntransaction)
-            db.transaction();
+    template<class T>
+    template<class Id>
+    typename Repository<T>::EntityPtr Repository<T>::find(Id &&id) const
+    {
+        auto query = prepareCached(QStringLiteral("SELECT * FROM %1 WHERE %2 = :id").arg(getTableName()).arg(getIdColumn()));
+        query->bindValue(QStringLiteral(":id"), id);
+        DatabaseUtils::execQuery(*query);
 
-        try
-        {
-            for (auto batch = 0u; batch < batches; ++batch)
-            {
-                auto query = prepare(batchQueryStr);
+        if (!query->next())
+            throw NotFoundException{};
 
-                const auto end = std::next(std::begin(entities), (batch + 1) * maxRowsPerInsert);
-                for (auto row = std::next(std::begin(entities), batch * maxRowsPerInsert); row != end; ++row)
-                    bindPositionalValues(*row, query);
+        return populate(query->record());
+    }
 
-                DatabaseUtils::execQuery(query);
-            }
+    template<class T>
+    template<class Ids>
+    typename Repository<T>::EntityList Repository<T>::findMany(const Ids &ids) const
+    {
+        EntityList result;
+        result.reserve(ids.size());
 
-            const auto reminder = totalRows % maxRowsPerInsert;
-            if (reminder > 0)
-            {
-                QStringList restBindings;
-                for (auto i = 0u; i < reminder; ++i)
-                    restBindings << bindingStr;
+        // multi-arg substitution leaves the inserted %1 for the IN list untouched
+        const auto queryStr = QStringLiteral("SELECT * FROM %1 WHERE %2 IN (%3)").arg(getTableName(), getIdColumn(), QStringLiteral("%1"));
+        execForIdChunks(queryStr, ids, [&](auto &query) {
+            auto chunk = populateAll(query);
+            result.insert(std::end(result), std::make_move_iterator(std::begin(chunk)), std::make_move_iterator(std::end(chunk)));
+        });
 
-                const auto restQueryStr = baseQueryStr.arg(restBindings.join(", "));
-                auto query = prepare(restQueryStr);
+        return result;
+    }
 
-                for (auto row = std::next(std::begin(entities), batches * maxRowsPerInsert); row != std::end(entities); ++row)
-                    bindPositionalValues(*row, query);
+    template<class T>
+    QFuture<typename Repository<T>::EntityList> Repository<T>::fetchAllAsync() const
+    {
+        return DatabaseWorkerPool::run([=] {
+            return fetchAll();
+        });
+    }
 
-                DatabaseUtils::execQuery(query);
+    template<class T>
+    QFuture<typename Repository<T>::EntityPtr> Repository<T>::findAsync(typename T::IdType id) const
+    {
+        return DatabaseWorkerPool::run([=] {
+            try
+            {
+                return find(id);
             }
-        }
-        catch (...)
-        {
-            if (wrapIntransaction)
-                db.rollback();
+            catch (const NotFoundException &)
+            {
+                return EntityPtr{};
+            }
+        });
+    }
 
-            throw;
+    template<class T>
+    template<class U>
+    QFuture<void> Repository<T>::batchStoreAsync(U entities, bool hasId, bool wrapIntransaction) const
+    {
+        // writes queue up with all other async writes instead of fighting them for the write lock
+        const auto writer = mConnectionProvider.getWriter();
+        if (writer != nullptr)
+        {
+            return writer->submit([=, entities = std::move(entities)] {
+                batchStore(entities, hasId, wrapIntransaction);
+            });
         }
 
-        if (wrapIntransaction)
-            db.commit();
+        return DatabaseWorkerPool::run([=, entities = std::move(entities)] {
+            batchStore(entities, hasId, wrapIntransaction);
+        });
     }
 
     template<class T>
-    template<class Id>
-    void Repository<T>::remove(Id &&id) const
+    template<class Derived, class R, class... Params, class... Args>
+    QFuture<R> Repository<T>::fetchAsync(R (Derived::*method)(Params...) const, Args... args) const
     {
-        auto query = prepare(QStringLiteral("DELETE FROM %1 WHERE %2 = :id").arg(getTableName()).arg(getIdColumn()));
-        query.bindValue(QStringLiteral(":id"), id);
-        DatabaseUtils::execQuery(query);
+        static_assert(std::is_base_of_v<Repository<T>, Derived>, "Method must belong to this repository.");
+
+        const auto repo = static_cast<const Derived *>(this);
+        return DatabaseWorkerPool::run([=] {
+            return (repo->*method)(args...);
+        });
     }
 
     template<class T>
-    typename Repository<T>::EntityList Repository<T>::fetchAll() const
+    typename Repository<T>::EntityList Repository<T>::populateAll(QSqlQuery &query) const
     {
-        EntityList out;
+        EntityList result;
 
-        auto result = exec(QStringLiteral("SELECT * FROM %1").arg(getTableName()));
-        const auto size = result.size();
-        if (size != -1)
-            out.reserve(size);
+        const auto size = query.size();
+        if (size > 0)
+            result.reserve(size);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // resolve column positions once per result set instead of looking them up by name for every row
+        const auto ordinals = getColumnOrdinals(query.record());
+        while (query.next())
+            result.emplace_back(populateRow(query, ordinals));
 
-        while (result.next())
-            out.emplace_back(populate(result.record()));
+        QueryStatistics::recordPopulate(query.lastQuery(), timer.nsecsElapsed() / 1000, result.size());
 
-        return out;
+        return result;
     }
 
     template<class T>
-    template<class Id>
-    typename Repository<T>::EntityPtr Repository<T>::find(Id &&id) const
+    typename Repository<T>::ColumnOrdinals Repository<T>::getColumnOrdinals(const QSqlRecord &record) const
     {
-        auto query = prepare(QStringLiteral("SELECT * FROM %1 WHERE %2 = :id").arg(getTableName()).arg(getIdColumn()));
-        query.bindValue(QStringLiteral(":id"), id);
-        DatabaseUtils::execQuery(query);
+        const auto columns = getColumns();
 
-        if (!query.next())
-            throw NotFoundException{};
+        ColumnOrdinals ordinals;
+        ordinals.reserve(columns.size());
 
-        return populate(query.record());
+        for (const auto &column : columns)
+            ordinals.emplace_back(record.indexOf(column));
+
+        return ordinals;
+    }
+
+    template<class T>
+    template<class Ids, class Callback>
+    void Repository<T>::execForIdChunks(const QString &queryStr,
+                                        const Ids &ids,
+                                        const Callback &callback,
+                                        const QVariantList &leadingValues) const
+    {
+        if (ids.empty())
+            return;
+
+        const auto maxIdsPerChunk = maxSqliteBoundVariables - leadingValues.size();
+
+        const auto execChunk = [&](auto &query, auto &it, auto count) {
+            for (const auto &value : leadingValues)
+                query.addBindValue(value);
+
+            for (auto i = 0u; i < count; ++i, ++it)
+                query.addBindValue(*it);
+
+            DatabaseUtils::execQuery(query);
+            callback(query);
+        };
+
+        auto it = std::begin(ids);
+
+        const auto chunks = ids.size() / maxIdsPerChunk;
+        if (chunks > 0)
+        {
+            auto query = prepareCached(queryStr.arg(DatabaseUtils::getPlaceholders(maxIdsPerChunk)));
+            for (auto chunk = 0u; chunk < chunks; ++chunk)
+                execChunk(*query, it, maxIdsPerChunk);
+        }
+
+        const auto reminder = ids.size() % maxIdsPerChunk;
+        if (reminder > 0)
+        {
+            auto query = prepare(queryStr.arg(DatabaseUtils::getPlaceholders(reminder)));
+            execChunk(query, it, reminder);
+        }
+    }
+
+    template<class T>
+    void Repository<T>::execWrite(const std::function<void ()> &write) const
+    {
+        const auto writer = mConnectionProvider.getWriter();
+        if (writer != nullptr)
+            writer->run(write);
+        else
+            write();
+    }
+
+    template<class T>
+    template<class RowBinder>
+    void Repository<T>::execBatchReplace(const QString &tableName,
+                                         const QStringList &columns,
+                                         size_t totalRows,
+                                         size_t maxRowsPerBatch,
+                                         const RowBinder &rowBinder) const
+    {
+        const auto baseQueryStr = QStringLiteral("REPLACE INTO %1 (%2) VALUES ")
+            .arg(tableName)
+            .arg(columns.join(QStringLiteral(", ")));
+
+        const auto execRows = [&](auto &query, auto rows) {
+            for (auto row = 0u; row < rows; ++row)
+                rowBinder(query);
+
+            DatabaseUtils::execQuery(query);
+        };
+
+        const auto batches = totalRows / maxRowsPerBatch;
+        if (batches > 0)
+        {
+            // all full batches share one statement, which only needs rebinding
+            auto query = prepareCached(baseQueryStr + DatabaseUtils::getRowPlaceholders(columns.size(), maxRowsPerBatch));
+            for (auto batch = 0u; batch < batches; ++batch)
+                execRows(*query, maxRowsPerBatch);
+        }
+
+        const auto reminder = totalRows % maxRowsPerBatch;
+        if (reminder > 0)
+        {
+            auto query = prepare(baseQueryStr + DatabaseUtils::getRowPlaceholders(columns.size(), reminder));
+            execRows(query, reminder);
+        }
     }
 
     template<class T>
@@ -230,21 +392,21 @@ namespace Evernus
             .arg(columns.join(QStringLiteral(", ")))
             .arg(prefixedColumns.join(QStringLiteral(", ")));
 
-        auto query = prepare(queryStr);
-        bindValues(entity, query);
-        DatabaseUtils::execQuery(query);
+        auto query = prepareCached(queryStr);
+        bindValues(entity, *query);
+        DatabaseUtils::execQuery(*query);
 
         if (setNewId)
         {
-            const auto rowId = query.lastInsertId();
+            const auto rowId = query->lastInsertId();
             if (!rowId.isNull())
             {
-                auto query = prepare(QStringLiteral("SELECT %1 FROM %2 WHERE ROWID = :id").arg(getIdColumn()).arg(getTableName()));
-                query.bindValue(QStringLiteral(":id"), rowId);
-                DatabaseUtils::execQuery(query);
-                query.next();
+                auto query = prepareCached(QStringLiteral("SELECT %1 FROM %2 WHERE ROWID = :id").arg(getIdColumn()).arg(getTableName()));
+                query->bindValue(QStringLiteral(":id"), rowId);
+                DatabaseUtils::execQuery(*query);
+                query->next();
 
-                entity.setId(query.value(0).template value<typename T::IdType>());
+                entity.setId(query->value(0).template value<typename T::IdType>());
             }
         }
     }
@@ -263,11 +425,11 @@ namespace Evernus
             .arg(updateList.join(", "))
             .arg(getIdColumn());
 
-        auto query = prepare(queryStr);
-        query.bindValue(QStringLiteral(":id_for_update"), entity.getOriginalId());
+        auto query = prepareCached(queryStr);
+        query->bindValue(QStringLiteral(":id_for_update"), entity.getOriginalId());
 
-        bindValues(entity, query);
-        DatabaseUtils::execQuery(query);
+        bindValues(entity, *query);
+        DatabaseUtils::execQuery(*query);
     }
 
     template<class T>
@@ -282,6 +444,13 @@ namespace Evernus
         Q_UNUSED(entity);
     }
 
+    template<class T>
+    typename Repository<T>::EntityPtr Repository<T>::populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const
+    {
+        Q_UNUSED(ordinals);
+        return populate(query.record());
+    }
+
     template<class T>
     size_t Repository<T>::getMaxRowsPerInsert() const
     {
@@ -0,0 +1,620 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <unordered_set>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <vector>
+
+#include <QSqlDatabase>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QDir>
+
+#include <QtDebug>
+
+#include "DatabaseUtils.h"
+
+#include "SdeSnapshot.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        const quint32 fileMagic = 0x53444553;
+        const quint32 fileVersion = 1;
+
+        const qint64 headerSize = 16;
+        const qint64 sectionEntrySize = 16;
+        const qint64 sectionAlignment = 8;
+
+        template<class T>
+        T readValue(const uchar *data, qint64 offset)
+        {
+            T value;
+            std::memcpy(&value, data + offset, sizeof(value));
+            return value;
+        }
+
+        template<class T>
+        void appendValue(QByteArray &data, T value)
+        {
+            data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        void align(QByteArray &data)
+        {
+            while (data.size() % sectionAlignment != 0)
+                data.append('\0');
+        }
+
+        class StringPool final
+        {
+        public:
+            SdeSnapshot::StringRef add(const QString &value)
+            {
+                const SdeSnapshot::StringRef ref{static_cast<quint32>(mData.size()), static_cast<quint32>(value.size())};
+                mData.append(value);
+
+                return ref;
+            }
+
+            const QString &getData() const noexcept
+            {
+                return mData;
+            }
+
+            QString get(const SdeSnapshot::StringRef &ref) const
+            {
+                return mData.mid(static_cast<int>(ref.mOffset), static_cast<int>(ref.mLength));
+            }
+
+        private:
+            QString mData;
+        };
+
+        template<class T, class Compare>
+        std::vector<quint32> getOrder(const std::vector<T> &values, Compare compare)
+        {
+            std::vector<quint32> order(values.size());
+            for (auto i = 0u; i < order.size(); ++i)
+                order[i] = i;
+
+            std::stable_sort(std::begin(order), std::end(order), [&](auto a, auto b) {
+                return compare(values[a], values[b]);
+            });
+
+            return order;
+        }
+
+        template<class T>
+        void sortById(std::vector<T> &values)
+        {
+            std::sort(std::begin(values), std::end(values), [](const auto &a, const auto &b) {
+                return a.mId < b.mId;
+            });
+        }
+
+        template<class T, class Id>
+        const T *findById(const SdeSnapshot::Range<T> &range, Id id) noexcept
+        {
+            const auto it = std::lower_bound(std::begin(range), std::end(range), id, [](const auto &value, auto key) {
+                return value.mId < key;
+            });
+
+            return (it != std::end(range) && it->mId == id) ? (it) : (nullptr);
+        }
+
+        QSqlQuery execSelect(const QSqlDatabase &db, const QString &queryStr)
+        {
+            QSqlQuery query{db};
+            query.setForwardOnly(true);
+            query.prepare(queryStr);
+
+            DatabaseUtils::execQuery(query);
+            return query;
+        }
+
+        uint findManufacturingActivity(const QSqlDatabase &db)
+        {
+            QSqlQuery query{db};
+            query.prepare(QStringLiteral("SELECT activityID FROM ramActivities WHERE activityName = ?"));
+            query.bindValue(0, QStringLiteral("Manufacturing"));
+
+            DatabaseUtils::execQuery(query);
+            if (query.next())
+                return query.value(0).toUInt();
+
+            const auto fallback = 1u; // fallback id at the time of writing
+            qWarning() << "Manufacturing activity id not found - assuming:" << fallback;
+
+            return fallback;
+        }
+    }
+
+    void SdeSnapshot::load(const QSqlDatabase &db, const QString &sdeVersion)
+    {
+        std::fill(std::begin(mSections), std::end(mSections), SectionLocation{});
+        mData.clear();
+
+        if (mFile.isOpen())
+            mFile.close();
+
+        const auto fingerprint = getFingerprint(db, sdeVersion);
+
+        mFile.setFileName(getFileName(db));
+        if (mapFile(fingerprint))
+            return;
+
+        qDebug() << "Building SDE snapshot:" << mFile.fileName();
+
+        mData = build(db, fingerprint);
+
+        QSaveFile snapshotFile{mFile.fileName()};
+        if (snapshotFile.open(QIODevice::WriteOnly) && snapshotFile.write(mData) == mData.size() && snapshotFile.commit())
+        {
+            if (mapFile(fingerprint))
+            {
+                mData.clear();
+                return;
+            }
+        }
+        else
+        {
+            qWarning() << "Cannot write SDE snapshot:" << mFile.fileName();
+        }
+
+        // keep working from memory when the file can't be used
+        if (!parse(reinterpret_cast<const uchar *>(mData.constData()), mData.size(), fingerprint))
+            qCritical() << "Invalid SDE snapshot built.";
+    }
+
+    QString SdeSnapshot::getString(const StringRef &ref) const
+    {
+        const auto &strings = mSections[static_cast<std::size_t>(Section::Strings)];
+        if (strings.mData == nullptr || static_cast<quint64>(ref.mOffset) + ref.mLength > strings.mCount)
+            return QString{};
+
+        return QString{reinterpret_cast<const QChar *>(strings.mData) + ref.mOffset, static_cast<int>(ref.mLength)};
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::Region> SdeSnapshot::getRegions() const noexcept
+    {
+        return getSection<Region>(Section::Regions);
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::Constellation> SdeSnapshot::getConstellations() const noexcept
+    {
+        return getSection<Constellation>(Section::Constellations);
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::SolarSystem> SdeSnapshot::getSolarSystems() const noexcept
+    {
+        return getSection<SolarSystem>(Section::SolarSystems);
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::Station> SdeSnapshot::getStations() const noexcept
+    {
+        return getSection<Station>(Section::Stations);
+    }
+
+    SdeSnapshot::Order SdeSnapshot::getRegionNameOrder() const noexcept
+    {
+        return getSection<quint32>(Section::RegionNameOrder);
+    }
+
+    SdeSnapshot::Order SdeSnapshot::getConstellationNameOrder() const noexcept
+    {
+        return getSection<quint32>(Section::ConstellationNameOrder);
+    }
+
+    SdeSnapshot::Order SdeSnapshot::getSolarSystemNameOrder() const noexcept
+    {
+        return getSection<quint32>(Section::SolarSystemNameOrder);
+    }
+
+    SdeSnapshot::Order SdeSnapshot::getStationSolarSystemOrder() const noexcept
+    {
+        return getSection<quint32>(Section::StationSolarSystemOrder);
+    }
+
+    const SdeSnapshot::Region *SdeSnapshot::findRegion(quint32 id) const noexcept
+    {
+        return findById(getRegions(), id);
+    }
+
+    const SdeSnapshot::Constellation *SdeSnapshot::findConstellation(quint32 id) const noexcept
+    {
+        return findById(getConstellations(), id);
+    }
+
+    const SdeSnapshot::SolarSystem *SdeSnapshot::findSolarSystem(quint32 id) const noexcept
+    {
+        return findById(getSolarSystems(), id);
+    }
+
+    const SdeSnapshot::Station *SdeSnapshot::findStation(quint64 id) const noexcept
+    {
+        return findById(getStations(), id);
+    }
+
+    SdeSnapshot::Order SdeSnapshot::getSolarSystemStations(quint32 solarSystemId) const noexcept
+    {
+        const auto stations = getStations();
+        const auto order = getStationSolarSystemOrder();
+
+        const auto begin = std::partition_point(std::begin(order), std::end(order), [&](auto index) {
+            return stations[index].mSolarSystemId < solarSystemId;
+        });
+        const auto end = std::partition_point(begin, std::end(order), [&](auto index) {
+            return stations[index].mSolarSystemId == solarSystemId;
+        });
+
+        return Order{begin, end};
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::Jump> SdeSnapshot::getJumps() const noexcept
+    {
+        return getSection<Jump>(Section::Jumps);
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::ReprocessingMaterial> SdeSnapshot::getReprocessingMaterials() const noexcept
+    {
+        return getSection<ReprocessingMaterial>(Section::ReprocessingMaterials);
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::ReprocessingMaterial> SdeSnapshot::getReprocessingMaterials(quint32 typeId) const noexcept
+    {
+        const auto materials = getReprocessingMaterials();
+        const auto begin = std::lower_bound(std::begin(materials), std::end(materials), typeId, [](const auto &material, auto key) {
+            return material.mTypeId < key;
+        });
+        const auto end = std::upper_bound(begin, std::end(materials), typeId, [](auto key, const auto &material) {
+            return key < material.mTypeId;
+        });
+
+        return Range<ReprocessingMaterial>{begin, end};
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::ManufacturingMaterial> SdeSnapshot::getManufacturingMaterials() const noexcept
+    {
+        return getSection<ManufacturingMaterial>(Section::ManufacturingMaterials);
+    }
+
+    SdeSnapshot::Range<SdeSnapshot::BlueprintProduct> SdeSnapshot::getBlueprintProducts() const noexcept
+    {
+        return getSection<BlueprintProduct>(Section::BlueprintProducts);
+    }
+
+    bool SdeSnapshot::write(const QSqlDatabase &db, const QString &sdeVersion)
+    {
+        const auto fileName = getFileName(db);
+        qDebug() << "Writing SDE snapshot:" << fileName;
+
+        const auto data = build(db, getFingerprint(db, sdeVersion));
+
+        QSaveFile file{fileName};
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        {
+            qWarning() << "Cannot write SDE snapshot:" << fileName;
+            return false;
+        }
+
+        return true;
+    }
+
+    QString SdeSnapshot::getFileName(const QSqlDatabase &db)
+    {
+        const QFileInfo info{db.databaseName()};
+        return info.dir().filePath(info.completeBaseName() + QStringLiteral(".snapshot"));
+    }
+
+    template<class T>
+    SdeSnapshot::Range<T> SdeSnapshot::getSection(Section section) const noexcept
+    {
+        const auto &location = mSections[static_cast<std::size_t>(section)];
+        const auto begin = reinterpret_cast<const T *>(location.mData);
+
+        return Range<T>{begin, begin + location.mCount};
+    }
+
+    bool SdeSnapshot::parse(const uchar *data, qint64 size, const QByteArray &fingerprint)
+    {
+        std::fill(std::begin(mSections), std::end(mSections), SectionLocation{});
+
+        const auto sectionCount = static_cast<quint32>(Section::Count);
+
+        if (data == nullptr || size < headerSize)
+            return false;
+        if (readValue<quint32>(data, 0) != fileMagic || readValue<quint32>(data, 4) != fileVersion)
+            return false;
+        if (readValue<quint32>(data, 12) != sectionCount)
+            return false;
+
+        const auto fingerprintSize = readValue<quint32>(data, 8);
+        const auto fingerprintOffset = headerSize + sectionCount * sectionEntrySize;
+        if (fingerprintOffset + fingerprintSize > size ||
+            QByteArray::fromRawData(reinterpret_cast<const char *>(data + fingerprintOffset), fingerprintSize) != fingerprint)
+        {
+            return false;
+        }
+
+        // element sizes, in section order
+        const quint64 elementSizes[] = {
+            sizeof(QChar),
+            sizeof(Region),
+            sizeof(quint32),
+            sizeof(Constellation),
+            sizeof(quint32),
+            sizeof(SolarSystem),
+            sizeof(quint32),
+            sizeof(Station),
+            sizeof(quint32),
+            sizeof(Jump),
+            sizeof(ReprocessingMaterial),
+            sizeof(ManufacturingMaterial),
+            sizeof(BlueprintProduct),
+        };
+        static_assert(std::size(elementSizes) == static_cast<std::size_t>(Section::Count));
+
+        SectionLocation sections[static_cast<std::size_t>(Section::Count)];
+        for (auto section = 0u; section < sectionCount; ++section)
+        {
+            const auto entryOffset = headerSize + section * sectionEntrySize;
+            const auto offset = readValue<quint64>(data, entryOffset);
+            const auto count = readValue<quint64>(data, entryOffset + 8);
+
+            if (offset % sectionAlignment != 0 || offset > static_cast<quint64>(size) ||
+                count > (static_cast<quint64>(size) - offset) / elementSizes[section])
+            {
+                return false;
+            }
+
+            sections[section].mData = data + offset;
+            sections[section].mCount = count;
+        }
+
+        std::copy(std::begin(sections), std::end(sections), std::begin(mSections));
+        return true;
+    }
+
+    bool SdeSnapshot::mapFile(const QByteArray &fingerprint)
+    {
+        if (!mFile.open(QIODevice::ReadOnly))
+            return false;
+
+        const auto size = mFile.size();
+        if (parse(mFile.map(0, size), size, fingerprint))
+            return true;
+
+        mFile.close();
+        return false;
+    }
+
+    QByteArray SdeSnapshot::getFingerprint(const QSqlDatabase &db, const QString &sdeVersion)
+    {
+        // the version alone doesn't catch a database replaced by hand
+        return QStringLiteral("%1:%2").arg(sdeVersion).arg(QFileInfo{db.databaseName()}.size()).toUtf8();
+    }
+
+    QByteArray SdeSnapshot::build(const QSqlDatabase &db, const QByteArray &fingerprint)
+    {
+        StringPool strings;
+
+        std::vector<Region> regions;
+        auto query = execSelect(db, QStringLiteral("SELECT regionID, regionName FROM mapRegions"));
+        while (query.next())
+            regions.emplace_back(Region{query.value(0).toUInt(), strings.add(query.value(1).toString())});
+
+        std::vector<Constellation> constellations;
+        query = execSelect(db, QStringLiteral("SELECT constellationID, regionID, constellationName FROM mapConstellations"));
+        while (query.next())
+        {
+            constellations.emplace_back(Constellation{
+                query.value(0).toUInt(),
+                query.value(1).toUInt(),
+                strings.add(query.value(2).toString())
+            });
+        }
+
+        std::vector<SolarSystem> solarSystems;
+        query = execSelect(db, QStringLiteral("SELECT solarSystemID, constellationID, regionID, solarSystemName, security FROM mapSolarSystems"));
+        while (query.next())
+        {
+            solarSystems.emplace_back(SolarSystem{
+                query.value(0).toUInt(),
+                query.value(1).toUInt(),
+                query.value(2).toUInt(),
+                strings.add(query.value(3).toString()),
+                query.value(4).toDouble()
+            });
+        }
+
+        std::vector<Station> stations;
+        query = execSelect(db, QStringLiteral("SELECT stationID, solarSystemID, regionID, stationName FROM staStations"));
+        while (query.next())
+        {
+            stations.emplace_back(Station{
+                query.value(0).toULongLong(),
+                query.value(1).toUInt(),
+                query.value(2).toUInt(),
+                strings.add(query.value(3).toString())
+            });
+        }
+
+        std::unordered_set<quint64> stationIds;
+        for (const auto &station : stations)
+            stationIds.emplace(station.mId);
+
+        // stations are in both tables - keep the station table name
+        query = execSelect(db, QStringLiteral("SELECT itemID, solarSystemID, regionID, itemName FROM mapDenormalize"));
+        while (query.next())
+        {
+            const auto id = query.value(0).toULongLong();
+            if (stationIds.find(id) != std::end(stationIds))
+                continue;
+
+            stations.emplace_back(Station{
+                id,
+                query.value(1).toUInt(),
+                query.value(2).toUInt(),
+                strings.add(query.value(3).toString())
+            });
+        }
+
+        sortById(regions);
+        sortById(constellations);
+        sortById(solarSystems);
+        sortById(stations);
+
+        const auto compareNames = [&](const auto &a, const auto &b) {
+            return strings.get(a.mName) < strings.get(b.mName);
+        };
+
+        const auto regionNameOrder = getOrder(regions, compareNames);
+        const auto constellationNameOrder = getOrder(constellations, compareNames);
+        const auto solarSystemNameOrder = getOrder(solarSystems, compareNames);
+        const auto stationSolarSystemOrder = getOrder(stations, [](const auto &a, const auto &b) {
+            return a.mSolarSystemId < b.mSolarSystemId;
+        });
+
+        std::vector<Jump> jumps;
+        query = execSelect(db, QStringLiteral(
+            "SELECT fromRegionID, fromSolarSystemID, toSolarSystemID FROM mapSolarSystemJumps WHERE fromRegionID = toRegionID"));
+        while (query.next())
+            jumps.emplace_back(Jump{query.value(0).toUInt(), query.value(1).toUInt(), query.value(2).toUInt()});
+
+        std::vector<ReprocessingMaterial> reprocessingMaterials;
+        query = execSelect(db, QStringLiteral(R"(
+SELECT m.typeID, m.materialTypeID, m.quantity, t.portionSize, t.groupID FROM invTypeMaterials m
+    INNER JOIN invTypes t
+        ON t.typeID = m.typeID AND t.marketGroupID IS NOT NULL
+        )"));
+        while (query.next())
+        {
+            reprocessingMaterials.emplace_back(ReprocessingMaterial{
+                query.value(0).toUInt(),
+                query.value(1).toUInt(),
+                query.value(2).toUInt(),
+                query.value(3).toUInt(),
+                query.value(4).toUInt()
+            });
+        }
+
+        std::stable_sort(std::begin(reprocessingMaterials), std::end(reprocessingMaterials), [](const auto &a, const auto &b) {
+            return a.mTypeId < b.mTypeId;
+        });
+
+        const auto manufacturingActivityId = findManufacturingActivity(db);
+
+        std::vector<ManufacturingMaterial> manufacturingMaterials;
+
+        query = QSqlQuery{db};
+        query.setForwardOnly(true);
+        query.prepare(QStringLiteral(R"(
+SELECT p.productTypeID, m.materialTypeID, m.quantity, p.quantity, a.time, s.skillID FROM industryActivityMaterials m
+    INNER JOIN industryActivityProducts p
+        ON m.typeID = p.typeID AND m.activityID = p.activityID AND p.activityID = ?
+    INNER JOIN industryActivity a
+        ON a.typeID = p.typeID AND a.activityID = m.activityID
+    INNER JOIN industryActivitySkills s
+        ON s.typeID = p.typeID AND s.activityID = m.activityID
+        )"));
+        query.addBindValue(manufacturingActivityId);
+
+        DatabaseUtils::execQuery(query);
+
+        while (query.next())
+        {
+            manufacturingMaterials.emplace_back(ManufacturingMaterial{
+                query.value(0).toUInt(),
+                query.value(1).toUInt(),
+                query.value(2).toUInt(),
+                query.value(3).toUInt(),
+                query.value(4).toUInt(),
+                query.value(5).toUInt()
+            });
+        }
+
+        std::stable_sort(std::begin(manufacturingMaterials), std::end(manufacturingMaterials), [](const auto &a, const auto &b) {
+            return a.mProductTypeId < b.mProductTypeId;
+        });
+
+        std::vector<BlueprintProduct> blueprintProducts;
+
+        query = QSqlQuery{db};
+        query.setForwardOnly(true);
+        query.prepare(QStringLiteral("SELECT typeID, productTypeID FROM industryActivityProducts WHERE activityID = ?"));
+        query.addBindValue(manufacturingActivityId);
+
+        DatabaseUtils::execQuery(query);
+
+        while (query.next())
+            blueprintProducts.emplace_back(BlueprintProduct{query.value(0).toUInt(), query.value(1).toUInt()});
+
+        std::stable_sort(std::begin(blueprintProducts), std::end(blueprintProducts), [](const auto &a, const auto &b) {
+            return a.mBlueprintTypeId < b.mBlueprintTypeId;
+        });
+
+        QByteArray data;
+
+        const auto sectionCount = static_cast<quint32>(Section::Count);
+
+        appendValue(data, fileMagic);
+        appendValue(data, fileVersion);
+        appendValue(data, static_cast<quint32>(fingerprint.size()));
+        appendValue(data, sectionCount);
+
+        // section entries are filled in once offsets are known
+        data.append(static_cast<int>(sectionCount * sectionEntrySize), '\0');
+        data.append(fingerprint);
+
+        const auto addSection = [&](Section section, const void *values, quint64 count, std::size_t elementSize) {
+            align(data);
+
+            const auto offset = static_cast<quint64>(data.size());
+            const auto entryOffset = headerSize + static_cast<qint64>(section) * sectionEntrySize;
+
+            std::memcpy(data.data() + entryOffset, &offset, sizeof(offset));
+            std::memcpy(data.data() + entryOffset + 8, &count, sizeof(count));
+
+            data.append(reinterpret_cast<const char *>(values), static_cast<int>(count * elementSize));
+        };
+
+        const auto addVector = [&](Section section, const auto &values) {
+            addSection(section, values.data(), values.size(), sizeof(values.front()));
+        };
+
+        addSection(Section::Strings, strings.getData().constData(), strings.getData().size(), sizeof(QChar));
+        addVector(Section::Regions, regions);
+        addVector(Section::RegionNameOrder, regionNameOrder);
+        addVector(Section::Constellations, constellations);
+        addVector(Section::ConstellationNameOrder, constellationNameOrder);
+        addVector(Section::SolarSystems, solarSystems);
+        addVector(Section::SolarSystemNameOrder, solarSystemNameOrder);
+        addVector(Section::Stations, stations);
+        addVector(Section::StationSolarSystemOrder, stationSolarSystemOrder);
+        addVector(Section::Jumps, jumps);
+        addVector(Section::ReprocessingMaterials, reprocessingMaterials);
+        addVector(Section::ManufacturingMaterials, manufacturingMaterials);
+        addVector(Section::BlueprintProducts, blueprintProducts);
+
+        qDebug() << "SDE snapshot size:" << data.size() << "bytes," << stations.size() << "stations," << solarSystems.size() << "solar systems.";
+
+        return data;
+    }
+}
@@ -0,0 +1,218 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+
+class QSqlDatabase;
+
+namespace Evernus
+{
+    // read-only image of static map, station and industry data, memory-mapped next to the SDE database
+    class SdeSnapshot final
+    {
+    public:
+        struct StringRef
+        {
+            quint32 mOffset;
+            quint32 mLength;
+        };
+
+        struct Region
+        {
+            quint32 mId;
+            StringRef mName;
+        };
+
+        struct Constellation
+        {
+            quint32 mId;
+            quint32 mRegionId;
+            StringRef mName;
+        };
+
+        struct SolarSystem
+        {
+            quint32 mId;
+            quint32 mConstellationId;
+            quint32 mRegionId;
+            StringRef mName;
+            double mSecurity;
+        };
+
+        // stations and other celestials
+        struct Station
+        {
+            quint64 mId;
+            quint32 mSolarSystemId;
+            quint32 mRegionId;
+            StringRef mName;
+        };
+
+        struct Jump
+        {
+            quint32 mRegionId;
+            quint32 mFromSolarSystemId;
+            quint32 mToSolarSystemId;
+        };
+
+        struct ReprocessingMaterial
+        {
+            quint32 mTypeId;
+            quint32 mMaterialTypeId;
+            quint32 mQuantity;
+            quint32 mPortionSize;
+            quint32 mGroupId;
+        };
+
+        // one row per material and required skill, like the SDE join it comes from
+        struct ManufacturingMaterial
+        {
+            quint32 mProductTypeId;
+            quint32 mMaterialTypeId;
+            quint32 mMaterialQuantity;
+            quint32 mProductQuantity;
+            quint32 mTime;
+            quint32 mSkillId;
+        };
+
+        struct BlueprintProduct
+        {
+            quint32 mBlueprintTypeId;
+            quint32 mProductTypeId;
+        };
+
+        template<class T>
+        class Range
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+        public:
+            Range() = default;
+            Range(const T *begin, const T *end) noexcept
+                : mBegin{begin}
+                , mEnd{end}
+            {
+            }
+
+            const T *begin() const noexcept { return mBegin; }
+            const T *end() const noexcept { return mEnd; }
+
+            std::size_t size() const noexcept { return static_cast<std::size_t>(mEnd - mBegin); }
+            bool empty() const noexcept { return mBegin == mEnd; }
+
+            const T &operator [](std::size_t index) const noexcept { return mBegin[index]; }
+
+        private:
+            const T *mBegin = nullptr;
+            const T *mEnd = nullptr;
+        };
+
+        // indexes into the matching id-sorted range
+        using Order = Range<quint32>;
+
+        SdeSnapshot() = default;
+        SdeSnapshot(const SdeSnapshot &) = delete;
+        SdeSnapshot(SdeSnapshot &&) = delete;
+        ~SdeSnapshot() = default;
+
+        // maps the snapshot of db, rebuilding it first if it is missing or was made from different data
+        void load(const QSqlDatabase &db, const QString &sdeVersion);
+
+        QString getString(const StringRef &ref) const;
+
+        // sorted by id
+        Range<Region> getRegions() const noexcept;
+        Range<Constellation> getConstellations() const noexcept;
+        Range<SolarSystem> getSolarSystems() const noexcept;
+        Range<Station> getStations() const noexcept;
+
+        // sorted by name
+        Order getRegionNameOrder() const noexcept;
+        Order getConstellationNameOrder() const noexcept;
+        Order getSolarSystemNameOrder() const noexcept;
+        // sorted by solar system
+        Order getStationSolarSystemOrder() const noexcept;
+
+        const Region *findRegion(quint32 id) const noexcept;
+        const Constellation *findConstellation(quint32 id) const noexcept;
+        const SolarSystem *findSolarSystem(quint32 id) const noexcept;
+        const Station *findStation(quint64 id) const noexcept;
+        Order getSolarSystemStations(quint32 solarSystemId) const noexcept;
+
+        // jumps within a single region
+        Range<Jump> getJumps() const noexcept;
+
+        // sorted by type; only types on the market
+        Range<ReprocessingMaterial> getReprocessingMaterials() const noexcept;
+        Range<ReprocessingMaterial> getReprocessingMaterials(quint32 typeId) const noexcept;
+
+        // sorted by product
+        Range<ManufacturingMaterial> getManufacturingMaterials() const noexcept;
+        // sorted by blueprint
+        Range<BlueprintProduct> getBlueprintProducts() const noexcept;
+
+        SdeSnapshot &operator =(const SdeSnapshot &) = delete;
+        SdeSnapshot &operator =(SdeSnapshot &&) = delete;
+
+        static bool write(const QSqlDatabase &db, const QString &sdeVersion);
+        static QString getFileName(const QSqlDatabase &db);
+
+    private:
+        enum class Section
+        {
+            Strings,
+            Regions,
+            RegionNameOrder,
+            Constellations,
+            ConstellationNameOrder,
+            SolarSystems,
+            SolarSystemNameOrder,
+            Stations,
+            StationSolarSystemOrder,
+            Jumps,
+            ReprocessingMaterials,
+            ManufacturingMaterials,
+            BlueprintProducts,
+
+            Count
+        };
+
+        struct SectionLocation
+        {
+            const uchar *mData = nullptr;
+            quint64 mCount = 0;
+        };
+
+        QFile mFile;
+        QByteArray mData;
+
+        SectionLocation mSections[static_cast<std::size_t>(Section::Count)];
+
+        template<class T>
+        Range<T> getSection(Section section) const noexcept;
+
+        bool parse(const uchar *data, qint64 size, const QByteArray &fingerprint);
+        bool mapFile(const QByteArray &fingerprint);
+
+        static QByteArray getFingerprint(const QSqlDatabase &db, const QString &sdeVersion);
+        static QByteArray build(const QSqlDatabase &db, const QByteArray &fingerprint);
+    };
+}
@@ -0,0 +1,322 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#include <QtConcurrent>
+
+#include <QtDebug>
+
+#include "SystemDistanceTable.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        const quint32 fileMagic = 0x45534454;
+        const quint32 fileVersion = 1;
+
+        const qint64 headerSize = 24;
+        const qint64 regionEntrySize = 24;
+
+        // distances are stored as bytes; no region comes near this many jumps across
+        const uchar unreachableDistance = 0xff;
+        const uchar maxDistance = unreachableDistance - 1;
+
+        struct RegionTable
+        {
+            uint mRegionId;
+            std::vector<quint32> mSystems;
+            std::vector<uchar> mMatrix;
+        };
+
+        template<class T>
+        T readValue(const uchar *data, qint64 offset)
+        {
+            T value;
+            std::memcpy(&value, data + offset, sizeof(value));
+
+            return value;
+        }
+
+        template<class T>
+        void appendValue(QByteArray &data, T value)
+        {
+            data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        void fillRegionTable(RegionTable &table, const std::unordered_multimap<uint, uint> &jumps)
+        {
+            auto &systems = table.mSystems;
+            systems.reserve(jumps.size());
+
+            for (const auto &jump : jumps)
+            {
+                systems.emplace_back(jump.first);
+                systems.emplace_back(jump.second);
+            }
+
+            std::sort(std::begin(systems), std::end(systems));
+            systems.erase(std::unique(std::begin(systems), std::end(systems)), std::end(systems));
+
+            const auto size = systems.size();
+            const auto getOrdinal = [&](auto system) {
+                return static_cast<quint32>(std::lower_bound(std::begin(systems), std::end(systems), system) - std::begin(systems));
+            };
+
+            std::vector<std::vector<quint32>> neighbors(size);
+            for (const auto &jump : jumps)
+                neighbors[getOrdinal(jump.first)].emplace_back(getOrdinal(jump.second));
+
+            table.mMatrix.assign(size * size, unreachableDistance);
+
+            std::vector<quint32> queue;
+            queue.reserve(size);
+
+            // plain BFS from every system; the graph is unweighted so this gives exact jump counts
+            for (auto start = 0u; start < size; ++start)
+            {
+                const auto row = table.mMatrix.data() + start * size;
+
+                queue.clear();
+                queue.emplace_back(start);
+                row[start] = 0;
+
+                for (auto i = 0u; i < queue.size(); ++i)
+                {
+                    const auto current = queue[i];
+                    const auto depth = static_cast<uchar>(std::min<uint>(row[current] + 1u, maxDistance));
+
+                    for (const auto next : neighbors[current])
+                    {
+                        if (row[next] != unreachableDistance)
+                            continue;
+
+                        row[next] = depth;
+                        queue.emplace_back(next);
+                    }
+                }
+            }
+        }
+    }
+
+    void SystemDistanceTable::load(const QString &fileName, const JumpMap &jumps)
+    {
+        mSystems.clear();
+        mData.clear();
+
+        if (mFile.isOpen())
+            mFile.close();
+
+        const auto fingerprint = getFingerprint(jumps);
+
+        mFile.setFileName(fileName);
+        if (mapFile(fingerprint))
+            return;
+
+        qDebug() << "Building system distance tables for" << jumps.size() << "regions.";
+
+        mData = build(jumps, fingerprint);
+
+        QFile cacheFile{fileName};
+        if (cacheFile.open(QIODevice::WriteOnly) && cacheFile.write(mData) == mData.size())
+        {
+            cacheFile.close();
+
+            if (mapFile(fingerprint))
+            {
+                mData.clear();
+                return;
+            }
+        }
+        else
+        {
+            qWarning() << "Cannot write system distance cache:" << fileName;
+        }
+
+        // fall back to the in-memory copy
+        parse(reinterpret_cast<const uchar *>(mData.constData()), mData.size(), fingerprint);
+    }
+
+    uint SystemDistanceTable::getDistance(uint startSystem, uint endSystem) const noexcept
+    {
+        if (startSystem == endSystem)
+            return 0;
+
+        const auto start = mSystems.find(startSystem);
+        if (start == std::end(mSystems))
+            return unreachable;
+
+        const auto end = mSystems.find(endSystem);
+        if (end == std::end(mSystems) || end->second.mMatrix != start->second.mMatrix)
+            return unreachable;
+
+        const auto distance = start->second.mMatrix[static_cast<std::size_t>(start->second.mOrdinal) * start->second.mSize + end->second.mOrdinal];
+        return (distance == unreachableDistance) ? (unreachable) : (distance);
+    }
+
+    const std::vector<uint> &SystemDistanceTable::getRegionSystems(uint regionId) const
+    {
+        static const std::vector<uint> empty;
+
+        const auto it = mRegionSystems.find(regionId);
+        return (it == std::end(mRegionSystems)) ? (empty) : (it->second);
+    }
+
+    bool SystemDistanceTable::parse(const uchar *data, qint64 size, quint64 fingerprint)
+    {
+        mSystems.clear();
+        mRegionSystems.clear();
+
+        if (data == nullptr || size < headerSize)
+            return false;
+        if (readValue<quint32>(data, 0) != fileMagic || readValue<quint32>(data, 4) != fileVersion)
+            return false;
+        if (readValue<quint64>(data, 8) != fingerprint)
+            return false;
+
+        const auto regionCount = readValue<quint32>(data, 16);
+        if (headerSize + regionCount * regionEntrySize > size)
+            return false;
+
+        for (auto region = 0u; region < regionCount; ++region)
+        {
+            const auto entryOffset = headerSize + region * regionEntrySize;
+            const auto regionId = readValue<quint32>(data, entryOffset);
+            const auto systemCount = readValue<quint32>(data, entryOffset + 4);
+            const auto systemsOffset = readValue<quint64>(data, entryOffset + 8);
+            const auto matrixOffset = readValue<quint64>(data, entryOffset + 16);
+
+            const auto matrixSize = static_cast<quint64>(systemCount) * systemCount;
+            if (systemsOffset + systemCount * sizeof(quint32) > static_cast<quint64>(size) ||
+                matrixOffset + matrixSize > static_cast<quint64>(size))
+            {
+                mSystems.clear();
+                mRegionSystems.clear();
+                return false;
+            }
+
+            auto &regionSystems = mRegionSystems[regionId];
+            regionSystems.reserve(systemCount);
+
+            for (auto ordinal = 0u; ordinal < systemCount; ++ordinal)
+            {
+                const auto systemId = readValue<quint32>(data, systemsOffset + ordinal * sizeof(quint32));
+                regionSystems.emplace_back(systemId);
+
+                auto &location = mSystems[systemId];
+                location.mMatrix = data + matrixOffset;
+                location.mSize = systemCount;
+                location.mOrdinal = ordinal;
+            }
+        }
+
+        return true;
+    }
+
+    bool SystemDistanceTable::mapFile(quint64 fingerprint)
+    {
+        if (!mFile.open(QIODevice::ReadOnly))
+            return false;
+
+        const auto size = mFile.size();
+        if (parse(mFile.map(0, size), size, fingerprint))
+            return true;
+
+        mFile.close();
+        return false;
+    }
+
+    quint64 SystemDistanceTable::getFingerprint(const JumpMap &jumps)
+    {
+        std::vector<std::tuple<uint, uint, uint>> sortedJumps;
+        for (const auto &region : jumps)
+        {
+            for (const auto &jump : region.second)
+                sortedJumps.emplace_back(region.first, jump.first, jump.second);
+        }
+
+        std::sort(std::begin(sortedJumps), std::end(sortedJumps));
+
+        // FNV-1a, so the value is stable between runs and platforms
+        auto hash = Q_UINT64_C(14695981039346656037);
+        const auto combine = [&](quint32 value) {
+            for (auto i = 0u; i < sizeof(value); ++i)
+            {
+                hash ^= (value >> (i * 8)) & 0xff;
+                hash *= Q_UINT64_C(1099511628211);
+            }
+        };
+
+        for (const auto &jump : sortedJumps)
+        {
+            combine(std::get<0>(jump));
+            combine(std::get<1>(jump));
+            combine(std::get<2>(jump));
+        }
+
+        return hash;
+    }
+
+    QByteArray SystemDistanceTable::build(const JumpMap &jumps, quint64 fingerprint)
+    {
+        std::vector<RegionTable> tables;
+        tables.reserve(jumps.size());
+
+        for (const auto &region : jumps)
+            tables.emplace_back(RegionTable{region.first, {}, {}});
+
+        QtConcurrent::blockingMap(tables, [&](auto &table) {
+            fillRegionTable(table, jumps.at(table.mRegionId));
+        });
+
+        QByteArray data;
+
+        appendValue(data, fileMagic);
+        appendValue(data, fileVersion);
+        appendValue(data, fingerprint);
+        appendValue(data, static_cast<quint32>(tables.size()));
+        appendValue(data, quint32{0});
+
+        auto systemsOffset = static_cast<quint64>(headerSize + tables.size() * regionEntrySize);
+        auto matrixOffset = systemsOffset;
+
+        for (const auto &table : tables)
+            matrixOffset += table.mSystems.size() * sizeof(quint32);
+
+        for (const auto &table : tables)
+        {
+            appendValue(data, static_cast<quint32>(table.mRegionId));
+            appendValue(data, static_cast<quint32>(table.mSystems.size()));
+            appendValue(data, systemsOffset);
+            appendValue(data, matrixOffset);
+
+            systemsOffset += table.mSystems.size() * sizeof(quint32);
+            matrixOffset += table.mMatrix.size();
+        }
+
+        for (const auto &table : tables)
+        {
+            for (const auto system : table.mSystems)
+                appendValue(data, system);
+        }
+
+        for (const auto &table : tables)
+            data.append(reinterpret_cast<const char *>(table.mMatrix.data()), static_cast<int>(table.mMatrix.size()));
+
+        return data;
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <limits>
+
+#include <QByteArray>
+#include <QFile>
+
+namespace Evernus
+{
+    // all-pairs jump distances within each region, stored as dense byte matrices in a memory-mapped cache file
+    class SystemDistanceTable final
+    {
+    public:
+        // region id -> (from system id -> to system id)
+        using JumpMap = std::unordered_map<uint, std::unordered_multimap<uint, uint>>;
+
+        static const uint unreachable = std::numeric_limits<uint>::max();
+
+        SystemDistanceTable() = default;
+        SystemDistanceTable(const SystemDistanceTable &) = delete;
+        SystemDistanceTable(SystemDistanceTable &&) = delete;
+        ~SystemDistanceTable() = default;
+
+        // maps the table from fileName, rebuilding the file first if it is missing or doesn't match the jumps
+        void load(const QString &fileName, const JumpMap &jumps);
+
+        uint getDistance(uint startSystem, uint endSystem) const noexcept;
+        // systems connected by at least one jump inside the region
+        const std::vector<uint> &getRegionSystems(uint regionId) const;
+
+        SystemDistanceTable &operator =(const SystemDistanceTable &) = delete;
+        SystemDistanceTable &operator =(SystemDistanceTable &&) = delete;
+
+    private:
+        struct SystemLocation
+        {
+            const uchar *mMatrix = nullptr;
+            quint32 mSize = 0;
+            quint32 mOrdinal = 0;
+        };
+
+        QFile mFile;
+        QByteArray mData;
+
+        std::unordered_map<uint, SystemLocation> mSystems;
+        std::unordered_map<uint, std::vector<uint>> mRegionSystems;
+
+        bool parse(const uchar *data, qint64 size, quint64 fingerprint);
+        bool mapFile(quint64 fingerprint);
+
+        static quint64 getFingerprint(const JumpMap &jumps);
+        static QByteArray build(const JumpMap &jumps, quint64 fingerprint);
+    };
+}
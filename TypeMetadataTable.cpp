@@ -0,0 +1,297 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <unordered_set>
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include <QtDebug>
+
+#include "DatabaseUtils.h"
+
+#include "TypeMetadataTable.h"
+
+namespace Evernus
+{
+    namespace
+    {
+        const EveDataProvider::ManufacturingInfo emptyManufacturingInfo{0};
+    }
+
+    void TypeMetadataTable::load(const QSqlDatabase &db, const SdeSnapshot &snapshot)
+    {
+        std::vector<MarketGroup::IdType> typeMarketGroups;
+        std::vector<uint> typeMetaGroups;
+
+        loadTypes(db, typeMarketGroups, typeMetaGroups);
+        loadMarketGroups(db, typeMarketGroups);
+        loadMetaGroups(db, typeMetaGroups);
+        loadManufacturingInfo(snapshot);
+        loadBlueprintOutputs(snapshot);
+
+        mStrings.squeeze();
+
+        qDebug() << "Loaded metadata of" << mOrdinals.size() << "types," << mMarketGroupIds.size() << "market groups and"
+                 << mManufacturingInfos.size() << "manufacturing recipes.";
+    }
+
+    TypeMetadataTable::Ordinal TypeMetadataTable::getOrdinal(EveType::IdType id) const noexcept
+    {
+        const auto ordinal = mOrdinals.find(id);
+        return (ordinal != std::end(mOrdinals)) ? (ordinal->second) : (invalidOrdinal);
+    }
+
+    QString TypeMetadataTable::getName(Ordinal ordinal) const
+    {
+        return (ordinal < mNames.size()) ? (getString(mNames[ordinal])) : (QString{});
+    }
+
+    uint TypeMetadataTable::getGroupId(Ordinal ordinal) const noexcept
+    {
+        return (ordinal < mGroupIds.size()) ? (mGroupIds[ordinal]) : (0);
+    }
+
+    double TypeMetadataTable::getVolume(Ordinal ordinal) const noexcept
+    {
+        return (ordinal < mVolumes.size()) ? (mVolumes[ordinal]) : (0.);
+    }
+
+    MarketGroup::IdType TypeMetadataTable::getMarketGroupId(Ordinal ordinal) const noexcept
+    {
+        if (ordinal >= mMarketGroups.size() || mMarketGroups[ordinal] == noIndex)
+            return MarketGroup::invalidId;
+
+        return mMarketGroupIds[mMarketGroups[ordinal]];
+    }
+
+    QString TypeMetadataTable::getMarketGroupName(Ordinal ordinal) const
+    {
+        if (ordinal >= mMarketGroups.size() || mMarketGroups[ordinal] == noIndex)
+            return QString{};
+
+        return getString(mMarketGroupNames[mMarketGroups[ordinal]]);
+    }
+
+    MarketGroup::IdType TypeMetadataTable::getMarketGroupParentId(Ordinal ordinal) const noexcept
+    {
+        if (ordinal >= mMarketGroups.size() || mMarketGroups[ordinal] == noIndex)
+            return MarketGroup::invalidId;
+
+        const auto parent = mMarketGroupParents[mMarketGroups[ordinal]];
+        return (parent != noIndex) ? (mMarketGroupIds[parent]) : (MarketGroup::invalidId);
+    }
+
+    QString TypeMetadataTable::getMarketGroupParentName(Ordinal ordinal) const
+    {
+        if (ordinal >= mMarketGroups.size() || mMarketGroups[ordinal] == noIndex)
+            return QString{};
+
+        const auto parent = mMarketGroupParents[mMarketGroups[ordinal]];
+        return (parent != noIndex) ? (getString(mMarketGroupNames[parent])) : (QString{});
+    }
+
+    QString TypeMetadataTable::getMetaGroupName(Ordinal ordinal) const
+    {
+        if (ordinal >= mMetaGroups.size() || mMetaGroups[ordinal] == noIndex)
+            return QString{};
+
+        return getString(mMetaGroupNames[mMetaGroups[ordinal]]);
+    }
+
+    const EveDataProvider::ManufacturingInfo &TypeMetadataTable::getManufacturingInfo(Ordinal ordinal) const noexcept
+    {
+        if (ordinal >= mManufacturingInfo.size() || mManufacturingInfo[ordinal] == noIndex)
+            return emptyManufacturingInfo;
+
+        return mManufacturingInfos[mManufacturingInfo[ordinal]];
+    }
+
+    EveType::IdType TypeMetadataTable::getBlueprintOutputType(Ordinal ordinal) const noexcept
+    {
+        return (ordinal < mBlueprintOutputs.size()) ? (mBlueprintOutputs[ordinal]) : (EveType::invalidId);
+    }
+
+    TypeMetadataTable::StringRef TypeMetadataTable::addString(const QString &value)
+    {
+        StringRef ref;
+        ref.mOffset = static_cast<quint32>(mStrings.size());
+        ref.mLength = static_cast<quint32>(value.size());
+
+        mStrings.append(value);
+        return ref;
+    }
+
+    QString TypeMetadataTable::getString(const StringRef &ref) const
+    {
+        return mStrings.mid(static_cast<int>(ref.mOffset), static_cast<int>(ref.mLength));
+    }
+
+    void TypeMetadataTable::loadTypes(const QSqlDatabase &db,
+                                      std::vector<MarketGroup::IdType> &typeMarketGroups,
+                                      std::vector<uint> &typeMetaGroups)
+    {
+        QSqlQuery query{db};
+        query.setForwardOnly(true);
+        query.prepare(QStringLiteral(R"(
+SELECT t.typeID, t.groupID, t.typeName, t.volume, t.marketGroupID, m.metaGroupID FROM invTypes t
+    LEFT OUTER JOIN invMetaTypes m
+        ON m.typeID = t.typeID
+        )"));
+
+        DatabaseUtils::execQuery(query);
+
+        while (query.next())
+        {
+            const auto id = query.value(0).value<EveType::IdType>();
+            if (!mOrdinals.emplace(id, static_cast<Ordinal>(mNames.size())).second)
+                continue;
+
+            mGroupIds.emplace_back(query.value(1).toUInt());
+            mNames.emplace_back(addString(query.value(2).toString()));
+            mVolumes.emplace_back(query.value(3).toDouble());
+
+            const auto marketGroupId = query.value(4);
+            typeMarketGroups.emplace_back((marketGroupId.isNull()) ? (MarketGroup::invalidId) : (marketGroupId.value<MarketGroup::IdType>()));
+            typeMetaGroups.emplace_back(query.value(5).toUInt());
+        }
+
+        mGroupIds.shrink_to_fit();
+        mNames.shrink_to_fit();
+        mVolumes.shrink_to_fit();
+    }
+
+    void TypeMetadataTable::loadMarketGroups(const QSqlDatabase &db, const std::vector<MarketGroup::IdType> &typeMarketGroups)
+    {
+        QSqlQuery query{db};
+        query.setForwardOnly(true);
+        query.prepare(QStringLiteral("SELECT marketGroupID, parentGroupID, marketGroupName FROM invMarketGroups"));
+
+        DatabaseUtils::execQuery(query);
+
+        std::unordered_map<MarketGroup::IdType, quint32> indexes;
+        std::vector<MarketGroup::IdType> parentIds;
+
+        while (query.next())
+        {
+            const auto id = query.value(0).value<MarketGroup::IdType>();
+            if (!indexes.emplace(id, static_cast<quint32>(mMarketGroupIds.size())).second)
+                continue;
+
+            const auto parentId = query.value(1);
+
+            mMarketGroupIds.emplace_back(id);
+            mMarketGroupNames.emplace_back(addString(query.value(2).toString()));
+            parentIds.emplace_back((parentId.isNull()) ? (MarketGroup::invalidId) : (parentId.value<MarketGroup::IdType>()));
+        }
+
+        const auto getIndex = [&](auto id) {
+            const auto index = indexes.find(id);
+            return (index != std::end(indexes)) ? (index->second) : (noIndex);
+        };
+
+        mMarketGroupParents.reserve(parentIds.size());
+        for (const auto parentId : parentIds)
+            mMarketGroupParents.emplace_back(getIndex(parentId));
+
+        mMarketGroups.reserve(typeMarketGroups.size());
+        for (const auto marketGroupId : typeMarketGroups)
+            mMarketGroups.emplace_back(getIndex(marketGroupId));
+    }
+
+    void TypeMetadataTable::loadMetaGroups(const QSqlDatabase &db, const std::vector<uint> &typeMetaGroups)
+    {
+        QSqlQuery query{db};
+        query.setForwardOnly(true);
+        query.prepare(QStringLiteral("SELECT metaGroupID, metaGroupName FROM invMetaGroups"));
+
+        DatabaseUtils::execQuery(query);
+
+        std::unordered_map<uint, quint32> indexes;
+        while (query.next())
+        {
+            if (indexes.emplace(query.value(0).toUInt(), static_cast<quint32>(mMetaGroupNames.size())).second)
+                mMetaGroupNames.emplace_back(addString(query.value(1).toString()));
+        }
+
+        mMetaGroups.reserve(typeMetaGroups.size());
+        for (const auto metaGroupId : typeMetaGroups)
+        {
+            const auto index = indexes.find(metaGroupId);
+            mMetaGroups.emplace_back((index != std::end(indexes)) ? (index->second) : (noIndex));
+        }
+    }
+
+    void TypeMetadataTable::loadManufacturingInfo(const SdeSnapshot &snapshot)
+    {
+        mManufacturingInfo.assign(mNames.size(), noIndex);
+
+        EveDataProvider::ManufacturingInfo *info = nullptr;
+        auto currentProduct = EveType::invalidId;
+
+        std::unordered_set<EveType::IdType> usedMaterials;
+
+        // rows are grouped by product
+        for (const auto &material : snapshot.getManufacturingMaterials())
+        {
+            if (material.mProductTypeId != currentProduct)
+            {
+                currentProduct = material.mProductTypeId;
+                usedMaterials.clear();
+
+                const auto ordinal = getOrdinal(currentProduct);
+                if (ordinal == invalidOrdinal)
+                {
+                    info = nullptr;
+                }
+                else
+                {
+                    mManufacturingInfo[ordinal] = static_cast<quint32>(mManufacturingInfos.size());
+                    info = &mManufacturingInfos.emplace_back(EveDataProvider::ManufacturingInfo{0});
+                }
+            }
+
+            if (info == nullptr)
+                continue;
+
+            if (material.mSkillId != EveDataProvider::industrySkillId && material.mSkillId != EveDataProvider::advancedIndustrySkillId)
+                info->mAdditionalsSkills.insert(material.mSkillId);
+
+            if (!usedMaterials.emplace(material.mMaterialTypeId).second)
+                continue;
+
+            if (info->mQuantity == 0)
+            {
+                info->mQuantity = material.mProductQuantity;
+                info->mTime = std::chrono::seconds{material.mTime};
+            }
+
+            info->mMaterials.emplace_back(EveDataProvider::MaterialInfo{material.mMaterialTypeId, material.mMaterialQuantity});
+        }
+    }
+
+    void TypeMetadataTable::loadBlueprintOutputs(const SdeSnapshot &snapshot)
+    {
+        mBlueprintOutputs.assign(mNames.size(), EveType::invalidId);
+
+        for (const auto &product : snapshot.getBlueprintProducts())
+        {
+            const auto ordinal = getOrdinal(product.mBlueprintTypeId);
+
+            // keep the first product, like single lookups did
+            if (ordinal != invalidOrdinal && mBlueprintOutputs[ordinal] == EveType::invalidId)
+                mBlueprintOutputs[ordinal] = product.mProductTypeId;
+        }
+    }
+}
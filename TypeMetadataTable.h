@@ -0,0 +1,112 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <limits>
+
+#include <QString>
+
+#include "EveDataProvider.h"
+#include "SdeSnapshot.h"
+#include "MarketGroup.h"
+#include "EveType.h"
+
+class QSqlDatabase;
+
+namespace Evernus
+{
+    // static type data from the SDE, bulk loaded into arrays indexed by a dense type ordinal
+    class TypeMetadataTable final
+    {
+    public:
+        using Ordinal = quint32;
+
+        static const Ordinal invalidOrdinal = std::numeric_limits<Ordinal>::max();
+
+        TypeMetadataTable() = default;
+        TypeMetadataTable(const TypeMetadataTable &) = delete;
+        TypeMetadataTable(TypeMetadataTable &&) = delete;
+        ~TypeMetadataTable() = default;
+
+        // not thread-safe - meant to be called once, before any reads
+        // recipes come from the snapshot, everything else from db
+        void load(const QSqlDatabase &db, const SdeSnapshot &snapshot);
+
+        Ordinal getOrdinal(EveType::IdType id) const noexcept;
+
+        // getters accept invalidOrdinal and return empty values for it
+        QString getName(Ordinal ordinal) const;
+        uint getGroupId(Ordinal ordinal) const noexcept;
+        double getVolume(Ordinal ordinal) const noexcept;
+
+        MarketGroup::IdType getMarketGroupId(Ordinal ordinal) const noexcept;
+        QString getMarketGroupName(Ordinal ordinal) const;
+        MarketGroup::IdType getMarketGroupParentId(Ordinal ordinal) const noexcept;
+        QString getMarketGroupParentName(Ordinal ordinal) const;
+
+        QString getMetaGroupName(Ordinal ordinal) const;
+
+        const EveDataProvider::ManufacturingInfo &getManufacturingInfo(Ordinal ordinal) const noexcept;
+        EveType::IdType getBlueprintOutputType(Ordinal ordinal) const noexcept;
+
+        TypeMetadataTable &operator =(const TypeMetadataTable &) = delete;
+        TypeMetadataTable &operator =(TypeMetadataTable &&) = delete;
+
+    private:
+        static const quint32 noIndex = std::numeric_limits<quint32>::max();
+
+        // range in mStrings
+        struct StringRef
+        {
+            quint32 mOffset = 0;
+            quint32 mLength = 0;
+        };
+
+        // all names share one buffer instead of a heap block each
+        QString mStrings;
+
+        std::unordered_map<EveType::IdType, Ordinal> mOrdinals;
+
+        std::vector<StringRef> mNames;
+        std::vector<uint> mGroupIds;
+        std::vector<double> mVolumes;
+        // indexes into the market group, meta group and manufacturing arrays below
+        std::vector<quint32> mMarketGroups;
+        std::vector<quint32> mMetaGroups;
+        std::vector<quint32> mManufacturingInfo;
+        std::vector<EveType::IdType> mBlueprintOutputs;
+
+        std::vector<MarketGroup::IdType> mMarketGroupIds;
+        std::vector<StringRef> mMarketGroupNames;
+        std::vector<quint32> mMarketGroupParents;
+
+        std::vector<StringRef> mMetaGroupNames;
+
+        std::vector<EveDataProvider::ManufacturingInfo> mManufacturingInfos;
+
+        StringRef addString(const QString &value);
+        QString getString(const StringRef &ref) const;
+
+        void loadTypes(const QSqlDatabase &db,
+                       std::vector<MarketGroup::IdType> &typeMarketGroups,
+                       std::vector<uint> &typeMetaGroups);
+        void loadMarketGroups(const QSqlDatabase &db, const std::vector<MarketGroup::IdType> &typeMarketGroups);
+        void loadMetaGroups(const QSqlDatabase &db, const std::vector<uint> &typeMetaGroups);
+        void loadManufacturingInfo(const SdeSnapshot &snapshot);
+        void loadBlueprintOutputs(const SdeSnapshot &snapshot);
+    };
+}
@@ -35,40 +35,50 @@ namespace Evernus
         return QStringLiteral("id");
     }
 
-    WalletJournalEntryRepository::EntityPtr WalletJournalEntryRepository::populate(const QSqlRecord &record) const
+    template<class Row>
+    WalletJournalEntryRepository::EntityPtr WalletJournalEntryRepository::decodeRow(const Row &row, const ColumnOrdinals &ordinals) const
     {
-        const auto taxReceiverId = record.value(QStringLiteral("tax_receiver_id"));
-        const auto extraInfoId = record.value(QStringLiteral("extra_info_id"));
-        const auto firstPartyId = record.value(QStringLiteral("first_party_id"));
-        const auto secondPartyId = record.value(QStringLiteral("second_party_id"));
-        const auto taxAmount = record.value(QStringLiteral("tax_amount"));
-        const auto balance = record.value(QStringLiteral("balance"));
-        const auto amount = record.value(QStringLiteral("amount"));
-        const auto contextId = record.value(QStringLiteral("context_id"));
-
-        auto timestamp = record.value(QStringLiteral("timestamp")).toDateTime();
+        const auto taxReceiverId = row.value(ordinals[TaxReceiverIdColumn]);
+        const auto firstPartyId = row.value(ordinals[FirstPartyIdColumn]);
+        const auto secondPartyId = row.value(ordinals[SecondPartyIdColumn]);
+        const auto taxAmount = row.value(ordinals[TaxAmountColumn]);
+        const auto balance = row.value(ordinals[BalanceColumn]);
+        const auto amount = row.value(ordinals[AmountColumn]);
+        const auto contextId = row.value(ordinals[ContextIdColumn]);
+
+        auto timestamp = row.value(ordinals[TimestampColumn]).toDateTime();
         timestamp.setTimeSpec(Qt::UTC);
 
-        auto walletJournalEntry = std::make_shared<WalletJournalEntry>(record.value(getIdColumn()).value<WalletJournalEntry::IdType>());
-        walletJournalEntry->setCharacterId(record.value(QStringLiteral("character_id")).value<Character::IdType>());
+        auto walletJournalEntry = std::make_shared<WalletJournalEntry>(row.value(ordinals[IdColumn]).value<WalletJournalEntry::IdType>());
+        walletJournalEntry->setCharacterId(row.value(ordinals[CharacterIdColumn]).value<Character::IdType>());
         walletJournalEntry->setTimestamp(timestamp);
         walletJournalEntry->setFirstPartyId((firstPartyId.isNull()) ? (WalletJournalEntry::PartyIdType{}) : (firstPartyId.toULongLong()));
         walletJournalEntry->setSecondPartyId((secondPartyId.isNull()) ? (WalletJournalEntry::PartyIdType{}) : (secondPartyId.toULongLong()));
         walletJournalEntry->setAmount((amount.isNull()) ? (WalletJournalEntry::ISKType{}) : (amount.toDouble()));
         walletJournalEntry->setBalance((balance.isNull()) ? (WalletJournalEntry::ISKType{}) : (balance.toDouble()));
-        walletJournalEntry->setReason(record.value(QStringLiteral("reason")).toString());
+        walletJournalEntry->setReason(row.value(ordinals[ReasonColumn]).toString());
         walletJournalEntry->setTaxReceiverId((taxReceiverId.isNull()) ? (WalletJournalEntry::TaxReceiverType{}) : (taxReceiverId.toULongLong()));
         walletJournalEntry->setTaxAmount((taxAmount.isNull()) ? (WalletJournalEntry::ISKType{}) : (taxAmount.toDouble()));
-        walletJournalEntry->setCorporationId(record.value(QStringLiteral("corporation_id")).toULongLong());
-        walletJournalEntry->setIgnored(record.value(QStringLiteral("ignored")).toBool());
-        walletJournalEntry->setRefType(record.value(QStringLiteral("ref_type")).toString());
+        walletJournalEntry->setCorporationId(row.value(ordinals[CorporationIdColumn]).toULongLong());
+        walletJournalEntry->setIgnored(row.value(ordinals[IgnoredColumn]).toBool());
+        walletJournalEntry->setRefType(row.value(ordinals[RefTypeColumn]).toString());
         walletJournalEntry->setContextId((contextId.isNull()) ? (WalletJournalEntry::ContextIdType{}) : (contextId.toULongLong()));
-        walletJournalEntry->setContextIdType(record.value(QStringLiteral("context_id_type")).toString());
+        walletJournalEntry->setContextIdType(row.value(ordinals[ContextIdTypeColumn]).toString());
         walletJournalEntry->setNew(false);
 
         return walletJournalEntry;
     }
 
+    WalletJournalEntryRepository::EntityPtr WalletJournalEntryRepository::populate(const QSqlRecord &record) const
+    {
+        return decodeRow(record, getColumnOrdinals(record));
+    }
+
+    WalletJournalEntryRepository::EntityPtr WalletJournalEntryRepository::populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const
+    {
+        return decodeRow(query, ordinals);
+    }
+
     void WalletJournalEntryRepository::create(const Repository<Character> &characterRepo) const
     {
         exec(QStringLiteral("CREATE TABLE IF NOT EXISTS %1 ("
@@ -161,16 +171,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        const auto size = query.size();
-
-        EntityList result;
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     WalletJournalEntryRepository::EntityList WalletJournalEntryRepository
@@ -290,15 +291,6 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        const auto size = query.size();
-
-        EntityList result;
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 }
@@ -64,10 +64,36 @@ namespace Evernus
     private:
         bool mCorp = false;
 
+        // positions in getColumns()
+        enum Column
+        {
+            IdColumn,
+            CharacterIdColumn,
+            TimestampColumn,
+            FirstPartyIdColumn,
+            SecondPartyIdColumn,
+            AmountColumn,
+            BalanceColumn,
+            ReasonColumn,
+            TaxReceiverIdColumn,
+            TaxAmountColumn,
+            CorporationIdColumn,
+            IgnoredColumn,
+            RefTypeColumn,
+            ContextIdColumn,
+            ContextIdTypeColumn
+        };
+
         virtual QStringList getColumns() const override;
         virtual void bindValues(const WalletJournalEntry &entity, QSqlQuery &query) const override;
         virtual void bindPositionalValues(const WalletJournalEntry &entity, QSqlQuery &query) const override;
 
+        virtual EntityPtr populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const override;
+
+        // single decoder for both populate() and populateRow(), so the two cannot drift apart
+        template<class Row>
+        EntityPtr decodeRow(const Row &row, const ColumnOrdinals &ordinals) const;
+
         template<class T>
         EntityList fetchForColumnInRange(T id,
                                          const QDateTime &from,
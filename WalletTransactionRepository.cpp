@@ -35,28 +35,39 @@ namespace Evernus
         return QStringLiteral("id");
     }
 
-    WalletTransactionRepository::EntityPtr WalletTransactionRepository::populate(const QSqlRecord &record) const
+    template<class Row>
+    WalletTransactionRepository::EntityPtr WalletTransactionRepository::decodeRow(const Row &row, const ColumnOrdinals &ordinals) const
     {
-        auto timestamp = record.value(QStringLiteral("timestamp")).toDateTime();
+        auto timestamp = row.value(ordinals[TimestampColumn]).toDateTime();
         timestamp.setTimeSpec(Qt::UTC);
 
-        auto walletTransaction = std::make_shared<WalletTransaction>(record.value(QStringLiteral("id")).value<WalletTransaction::IdType>());
-        walletTransaction->setCharacterId(record.value(QStringLiteral("character_id")).value<Character::IdType>());
+        auto walletTransaction = std::make_shared<WalletTransaction>(row.value(ordinals[IdColumn]).value<WalletTransaction::IdType>());
+        walletTransaction->setCharacterId(row.value(ordinals[CharacterIdColumn]).value<Character::IdType>());
         walletTransaction->setTimestamp(timestamp);
-        walletTransaction->setQuantity(record.value(QStringLiteral("quantity")).toUInt());
-        walletTransaction->setTypeId(record.value(QStringLiteral("type_id")).value<EveType::IdType>());
-        walletTransaction->setPrice(record.value(QStringLiteral("price")).toDouble());
-        walletTransaction->setClientId(record.value(QStringLiteral("client_id")).toULongLong());
-        walletTransaction->setLocationId(record.value(QStringLiteral("location_id")).toULongLong());
-        walletTransaction->setType(static_cast<WalletTransaction::Type>(record.value(QStringLiteral("type")).toInt()));
-        walletTransaction->setJournalId(record.value(QStringLiteral("journal_id")).value<WalletJournalEntry::IdType>());
-        walletTransaction->setCorporationId(record.value(QStringLiteral("corporation_id")).toULongLong());
-        walletTransaction->setIgnored(record.value(QStringLiteral("ignored")).toBool());
+        walletTransaction->setQuantity(row.value(ordinals[QuantityColumn]).toUInt());
+        walletTransaction->setTypeId(row.value(ordinals[TypeIdColumn]).value<EveType::IdType>());
+        walletTransaction->setPrice(row.value(ordinals[PriceColumn]).toDouble());
+        walletTransaction->setClientId(row.value(ordinals[ClientIdColumn]).toULongLong());
+        walletTransaction->setLocationId(row.value(ordinals[LocationIdColumn]).toULongLong());
+        walletTransaction->setType(static_cast<WalletTransaction::Type>(row.value(ordinals[TypeColumn]).toInt()));
+        walletTransaction->setJournalId(row.value(ordinals[JournalIdColumn]).value<WalletJournalEntry::IdType>());
+        walletTransaction->setCorporationId(row.value(ordinals[CorporationIdColumn]).toULongLong());
+        walletTransaction->setIgnored(row.value(ordinals[IgnoredColumn]).toBool());
         walletTransaction->setNew(false);
 
         return walletTransaction;
     }
 
+    WalletTransactionRepository::EntityPtr WalletTransactionRepository::populate(const QSqlRecord &record) const
+    {
+        return decodeRow(record, getColumnOrdinals(record));
+    }
+
+    WalletTransactionRepository::EntityPtr WalletTransactionRepository::populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const
+    {
+        return decodeRow(query, ordinals);
+    }
+
     void WalletTransactionRepository::create(const Repository<Character> &characterRepo) const
     {
         exec(QStringLiteral("CREATE TABLE IF NOT EXISTS %1 ("
@@ -157,16 +168,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        const auto size = query.size();
-
-        EntityList result;
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     WalletTransactionRepository::EntityList WalletTransactionRepository
@@ -196,16 +198,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        const auto size = query.size();
-
-        EntityList result;
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     WalletTransactionRepository::EntityList WalletTransactionRepository
@@ -217,16 +210,7 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        const auto size = query.size();
-
-        EntityList result;
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 
     QStringList WalletTransactionRepository::getColumns() const
@@ -313,15 +297,6 @@ namespace Evernus
 
         DatabaseUtils::execQuery(query);
 
-        const auto size = query.size();
-
-        EntityList result;
-        if (size > 0)
-            result.reserve(size);
-
-        while (query.next())
-            result.emplace_back(populate(query.record()));
-
-        return result;
+        return populateAll(query);
     }
 }
@@ -68,10 +68,33 @@ namespace Evernus
     private:
         bool mCorp = false;
 
+        // positions in getColumns()
+        enum Column
+        {
+            IdColumn,
+            CharacterIdColumn,
+            TimestampColumn,
+            QuantityColumn,
+            TypeIdColumn,
+            PriceColumn,
+            ClientIdColumn,
+            LocationIdColumn,
+            TypeColumn,
+            JournalIdColumn,
+            CorporationIdColumn,
+            IgnoredColumn
+        };
+
         virtual QStringList getColumns() const override;
         virtual void bindValues(const WalletTransaction &entity, QSqlQuery &query) const override;
         virtual void bindPositionalValues(const WalletTransaction &entity, QSqlQuery &query) const override;
 
+        virtual EntityPtr populateRow(const QSqlQuery &query, const ColumnOrdinals &ordinals) const override;
+
+        // single decoder for both populate() and populateRow(), so the two cannot drift apart
+        template<class Row>
+        EntityPtr decodeRow(const Row &row, const ColumnOrdinals &ordinals) const;
+
         template<class T>
         EntityList fetchForColumnInRange(T id,
                                          const QDateTime &from,
@@ -373,6 +373,12 @@ namespace Evernus
     {
         mData.reserve(entries.size());
 
+        EveDataProvider::LocationList locationIds;
+        for (const auto &entry : entries)
+            locationIds.emplace(entry->getLocationId());
+
+        mDataProvider.precacheLocations(locationIds);
+
         for (const auto &entry : entries)
         {
             mData.emplace_back();
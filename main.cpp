@@ -332,6 +332,7 @@ int main(int argc, char *argv[])
                                         app,
                                         app,
                                         app.getESIInterfaceManager(),
+                                        app,
                                         app};
 
             QObject::connect(&mainWnd, &Evernus::MainWindow::refreshCharacters,
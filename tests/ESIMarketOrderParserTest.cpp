@@ -0,0 +1,268 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QtTest>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#   include <sys/resource.h>
+#   include <sys/wait.h>
+#   include <unistd.h>
+#endif
+
+#include "ESIMarketOrderParser.h"
+
+namespace Evernus
+{
+    class ESIMarketOrderParserTest final
+        : public QObject
+    {
+        Q_OBJECT
+
+    private slots:
+        void initTestCase();
+
+        void parsersAgreeOnRecordedPage();
+        void rangesAndTimestampsAreDecoded();
+        void reportParseTimeAndPeakMemory();
+
+    private:
+        static const uint regionId = 10000002;
+        // enough copies of the recorded page to resemble a full region download
+        static const int benchmarkCopies = 1000;
+
+        QByteArray mPage;
+        QDateTime mUpdateTime = QDateTime::currentDateTimeUtc();
+
+        std::vector<ExternalOrder> parseFast(const QByteArray &data) const;
+        std::vector<ExternalOrder> parseJson(const QByteArray &data) const;
+
+        QByteArray makeLargePage() const;
+
+        template<class Parse>
+        static long getPeakMemoryGrowth(const Parse &parse);
+    };
+
+    void ESIMarketOrderParserTest::initTestCase()
+    {
+        QFile file{QFINDTESTDATA("data/market_orders_page.json")};
+        QVERIFY(file.open(QIODevice::ReadOnly));
+
+        mPage = file.readAll();
+        QVERIFY(!mPage.isEmpty());
+    }
+
+    void ESIMarketOrderParserTest::parsersAgreeOnRecordedPage()
+    {
+        const auto fast = parseFast(mPage);
+        const auto json = parseJson(mPage);
+
+        QVERIFY(!fast.empty());
+        QCOMPARE(fast.size(), json.size());
+
+        for (auto i = 0u; i < fast.size(); ++i)
+        {
+            const auto &fastOrder = fast[i];
+            const auto &jsonOrder = json[i];
+
+            QCOMPARE(fastOrder.getId(), jsonOrder.getId());
+            QCOMPARE(fastOrder.getType(), jsonOrder.getType());
+            QCOMPARE(fastOrder.getTypeId(), jsonOrder.getTypeId());
+            QCOMPARE(fastOrder.getStationId(), jsonOrder.getStationId());
+            QCOMPARE(fastOrder.getSolarSystemId(), jsonOrder.getSolarSystemId());
+            QCOMPARE(fastOrder.getRegionId(), jsonOrder.getRegionId());
+            QCOMPARE(fastOrder.getRange(), jsonOrder.getRange());
+            QCOMPARE(fastOrder.getUpdateTime(), jsonOrder.getUpdateTime());
+            // exact, QCOMPARE is fuzzy for doubles
+            QVERIFY2(fastOrder.getPrice() == jsonOrder.getPrice(), qPrintable(QString::number(fastOrder.getId())));
+            QCOMPARE(fastOrder.getVolumeEntered(), jsonOrder.getVolumeEntered());
+            QCOMPARE(fastOrder.getVolumeRemaining(), jsonOrder.getVolumeRemaining());
+            QCOMPARE(fastOrder.getMinVolume(), jsonOrder.getMinVolume());
+            QCOMPARE(fastOrder.getIssued().toString(Qt::ISODateWithMs), jsonOrder.getIssued().toString(Qt::ISODateWithMs));
+            QCOMPARE(fastOrder.getIssued().timeSpec(), jsonOrder.getIssued().timeSpec());
+            QCOMPARE(fastOrder.getDuration(), jsonOrder.getDuration());
+        }
+    }
+
+    void ESIMarketOrderParserTest::rangesAndTimestampsAreDecoded()
+    {
+        const auto orders = parseFast(mPage);
+        const auto findOrder = [&](ExternalOrder::IdType id) {
+            const auto order = std::find_if(std::begin(orders), std::end(orders), [=](const auto &order) {
+                return order.getId() == id;
+            });
+            return (order == std::end(orders)) ? (nullptr) : (&*order);
+        };
+
+        const auto station = findOrder(5618513420);
+        QVERIFY(station != nullptr);
+        QCOMPARE(station->getRange(), ExternalOrder::rangeStation);
+
+        const auto solarSystem = findOrder(5619001244);
+        QVERIFY(solarSystem != nullptr);
+        QCOMPARE(solarSystem->getRange(), ExternalOrder::rangeSystem);
+
+        const auto region = findOrder(5618262373);
+        QVERIFY(region != nullptr);
+        QCOMPARE(region->getRange(), ExternalOrder::rangeRegion);
+
+        const auto jumps = findOrder(5618400004);
+        QVERIFY(jumps != nullptr);
+        QCOMPARE(jumps->getRange(), short{40});
+
+        const auto fractional = findOrder(5617770512);
+        QVERIFY(fractional != nullptr);
+        QCOMPARE(fractional->getIssued(), QDateTime(QDate{2020, 4, 27}, QTime{21, 30, 58, 123}, Qt::UTC));
+
+        // the offset is dropped and the wall time taken as UTC, as ESIManager always did
+        const auto offset = findOrder(5616032871);
+        QVERIFY(offset != nullptr);
+        QCOMPARE(offset->getIssued(), QDateTime(QDate{2020, 4, 25}, QTime{6, 18, 27}, Qt::UTC));
+
+        // citadel orders come without system
+        const auto citadel = findOrder(5619354712);
+        QVERIFY(citadel != nullptr);
+        QCOMPARE(citadel->getSolarSystemId(), 0u);
+    }
+
+    void ESIMarketOrderParserTest::reportParseTimeAndPeakMemory()
+    {
+        const auto page = makeLargePage();
+        const auto report = [&](const char *name, const auto &parse) {
+            QElapsedTimer timer;
+            timer.start();
+
+            const auto orders = parse(page);
+            const auto elapsed = timer.nsecsElapsed();
+
+            QCOMPARE(orders.size(), static_cast<std::size_t>(benchmarkCopies) * parseFast(mPage).size());
+
+            const auto peak = getPeakMemoryGrowth([&] {
+                parse(page);
+            });
+
+            qInfo("%s: %llu orders from %d bytes in %.2f ms, peak memory growth %ld KiB",
+                  name,
+                  static_cast<qulonglong>(orders.size()),
+                  page.size(),
+                  elapsed / 1000000.,
+                  peak);
+        };
+
+        report("ESIMarketOrderParser", [this](const auto &data) {
+            return parseFast(data);
+        });
+        report("QJsonDocument", [this](const auto &data) {
+            return parseJson(data);
+        });
+    }
+
+    std::vector<ExternalOrder> ESIMarketOrderParserTest::parseFast(const QByteArray &data) const
+    {
+        std::vector<ExternalOrder> orders;
+
+        ESIMarketOrderParser parser{regionId, mUpdateTime};
+        if (!parser.parse(data, orders))
+            qFatal("Recorded page rejected by ESIMarketOrderParser.");
+
+        return orders;
+    }
+
+    std::vector<ExternalOrder> ESIMarketOrderParserTest::parseJson(const QByteArray &data) const
+    {
+        std::vector<ExternalOrder> orders;
+
+        ESIMarketOrderParser parser{regionId, mUpdateTime};
+        parser.parseJson(data, orders);
+
+        return orders;
+    }
+
+    QByteArray ESIMarketOrderParserTest::makeLargePage() const
+    {
+        const auto items = mPage.trimmed().mid(1).chopped(1);
+
+        QByteArray page;
+        page.reserve((items.size() + 1) * benchmarkCopies + 2);
+        page.append('[');
+
+        for (auto i = 0; i < benchmarkCopies; ++i)
+        {
+            if (i != 0)
+                page.append(',');
+
+            page.append(items);
+        }
+
+        page.append(']');
+        return page;
+    }
+
+    // runs the parse in a forked child, so every path starts from the same resident set; -1 where unsupported
+    template<class Parse>
+    long ESIMarketOrderParserTest::getPeakMemoryGrowth(const Parse &parse)
+    {
+#ifdef Q_OS_LINUX
+        int fds[2];
+        if (pipe(fds) != 0)
+            return -1;
+
+        const auto pid = fork();
+        if (pid == 0)
+        {
+            close(fds[0]);
+
+            // the child starts with its high water mark at the current resident size
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            const auto baseline = usage.ru_maxrss;
+
+            parse();
+
+            getrusage(RUSAGE_SELF, &usage);
+            const long growth = usage.ru_maxrss - baseline;
+
+            const auto written = write(fds[1], &growth, sizeof(growth));
+            Q_UNUSED(written);
+
+            _exit(0);
+        }
+
+        close(fds[1]);
+
+        long growth = -1;
+        if (pid > 0)
+        {
+            if (read(fds[0], &growth, sizeof(growth)) != sizeof(growth))
+                growth = -1;
+
+            waitpid(pid, nullptr, 0);
+        }
+
+        close(fds[0]);
+        return growth;
+#else
+        Q_UNUSED(parse);
+        return -1;
+#endif
+    }
+}
+
+QTEST_APPLESS_MAIN(Evernus::ESIMarketOrderParserTest)
+
+#include "ESIMarketOrderParserTest.moc"
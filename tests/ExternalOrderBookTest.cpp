@@ -0,0 +1,135 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <memory>
+
+#include <QtTest>
+
+#include "ExternalOrderBook.h"
+
+namespace Evernus
+{
+    class ExternalOrderBookTest final
+        : public QObject
+    {
+        Q_OBJECT
+
+    private slots:
+        void depthAggregatesPriceLevelsBestFirst();
+        void depthIsLimitedAndSkipsExcluded();
+        void cumulativeVolumeStopsAtPriceLimit();
+        void excludedSideYieldsNothing();
+
+    private:
+        static const ExternalOrder::TypeIdType typeId = 34;
+        static const uint regionId = 10000002;
+
+        static ExternalOrderRepository::EntityPtr makeOrder(ExternalOrder::IdType id,
+                                                            ExternalOrder::Type type,
+                                                            double price,
+                                                            uint volume);
+        static ExternalOrderBook makeBook();
+    };
+
+    void ExternalOrderBookTest::depthAggregatesPriceLevelsBestFirst()
+    {
+        const auto book = makeBook();
+
+        const auto sell = book.getDepth(ExternalOrder::Type::Sell, 10, {});
+        QCOMPARE(sell.size(), std::size_t{3});
+        QCOMPARE(sell[0].mPrice, 5.);
+        QCOMPARE(sell[0].mVolume, quint64{300});
+        QCOMPARE(sell[1].mPrice, 6.);
+        QCOMPARE(sell[1].mVolume, quint64{50});
+        QCOMPARE(sell[2].mPrice, 8.);
+        QCOMPARE(sell[2].mVolume, quint64{1000});
+
+        const auto buy = book.getDepth(ExternalOrder::Type::Buy, 10, {});
+        QCOMPARE(buy.size(), std::size_t{2});
+        QCOMPARE(buy[0].mPrice, 4.5);
+        QCOMPARE(buy[0].mVolume, quint64{20});
+        QCOMPARE(buy[1].mPrice, 4.);
+        QCOMPARE(buy[1].mVolume, quint64{700});
+    }
+
+    void ExternalOrderBookTest::depthIsLimitedAndSkipsExcluded()
+    {
+        const auto book = makeBook();
+
+        const auto sell = book.getDepth(ExternalOrder::Type::Sell, 2, { 1 });
+        QCOMPARE(sell.size(), std::size_t{2});
+        QCOMPARE(sell[0].mPrice, 5.);
+        QCOMPARE(sell[0].mVolume, quint64{200});
+        QCOMPARE(sell[1].mPrice, 6.);
+
+        // excluding the only order of a level removes the level
+        const auto buy = book.getDepth(ExternalOrder::Type::Buy, 10, { 5 });
+        QCOMPARE(buy.size(), std::size_t{1});
+        QCOMPARE(buy[0].mPrice, 4.);
+    }
+
+    void ExternalOrderBookTest::cumulativeVolumeStopsAtPriceLimit()
+    {
+        const auto book = makeBook();
+
+        QCOMPARE(book.getCumulativeVolume(ExternalOrder::Type::Sell, 6., {}), quint64{350});
+        QCOMPARE(book.getCumulativeVolume(ExternalOrder::Type::Sell, 6., { 2 }), quint64{300});
+        QCOMPARE(book.getCumulativeVolume(ExternalOrder::Type::Sell, 4.99, {}), quint64{0});
+
+        QCOMPARE(book.getCumulativeVolume(ExternalOrder::Type::Buy, 4.5, {}), quint64{20});
+        QCOMPARE(book.getCumulativeVolume(ExternalOrder::Type::Buy, 0., {}), quint64{720});
+    }
+
+    void ExternalOrderBookTest::excludedSideYieldsNothing()
+    {
+        const auto book = makeBook();
+
+        QVERIFY(book.getDepth(ExternalOrder::Type::Sell, 10, { 1, 2, 3, 4 }).empty());
+        QCOMPARE(book.getCumulativeVolume(ExternalOrder::Type::Buy, 0., { 5, 6, 7 }), quint64{0});
+    }
+
+    ExternalOrderRepository::EntityPtr ExternalOrderBookTest::makeOrder(ExternalOrder::IdType id,
+                                                                        ExternalOrder::Type type,
+                                                                        double price,
+                                                                        uint volume)
+    {
+        auto order = std::make_shared<ExternalOrder>(id);
+        order->setType(type);
+        order->setTypeId(typeId);
+        order->setRegionId(regionId);
+        order->setStationId(60003760);
+        order->setPrice(price);
+        order->setVolumeEntered(volume);
+        order->setVolumeRemaining(volume);
+
+        return order;
+    }
+
+    ExternalOrderBook ExternalOrderBookTest::makeBook()
+    {
+        return ExternalOrderBook{ExternalOrderRepository::EntityList{
+            makeOrder(1, ExternalOrder::Type::Sell, 5., 100),
+            makeOrder(2, ExternalOrder::Type::Sell, 6., 50),
+            makeOrder(3, ExternalOrder::Type::Sell, 5., 200),
+            makeOrder(4, ExternalOrder::Type::Sell, 8., 1000),
+            makeOrder(5, ExternalOrder::Type::Buy, 4.5, 20),
+            makeOrder(6, ExternalOrder::Type::Buy, 4., 300),
+            makeOrder(7, ExternalOrder::Type::Buy, 4., 400),
+        }};
+    }
+}
+
+QTEST_APPLESS_MAIN(Evernus::ExternalOrderBookTest)
+
+#include "ExternalOrderBookTest.moc"